@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""Replay a corpus of input recordings with FS-UAE in benchmark mode.
+
+Each scenario in the corpus directory is an input recording (name.inp,
+saved together with the state file it links to), optionally accompanied by
+an FS-UAE configuration file with the same name (name.fs-uae). Every
+scenario is replayed --runs times. All runs must produce the same RAM and
+video checkpoints, otherwise the scenario is reported as non-deterministic.
+
+The combined results can be saved with --output and used as --reference for
+a later run (e.g. of a release candidate), which then fails if a scenario
+has become slower than --max-regression percent, or if its checkpoints no
+longer match (with --strict).
+
+Example:
+
+    benchmark-corpus.py --fs-uae ./fs-uae --output 2.9.0.json corpus/
+    benchmark-corpus.py --fs-uae ./fs-uae --reference 2.9.0.json corpus/
+"""
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def find_scenarios(corpus):
+    scenarios = []
+    for name in sorted(os.listdir(corpus)):
+        base, ext = os.path.splitext(name)
+        if ext.lower() != ".inp":
+            continue
+        config = os.path.join(corpus, base + ".fs-uae")
+        scenarios.append({
+            "name": base,
+            "recording": os.path.join(corpus, name),
+            "config": config if os.path.exists(config) else None,
+        })
+    return scenarios
+
+
+def run_scenario(args, scenario, temp_dir):
+    report_path = os.path.join(temp_dir, scenario["name"] + ".json")
+    if os.path.exists(report_path):
+        os.remove(report_path)
+    command = [args.fs_uae]
+    if scenario["config"]:
+        command.append(scenario["config"])
+    command.extend([
+        "--benchmark_recording=" + scenario["recording"],
+        "--benchmark_report=" + report_path,
+        "--benchmark_name=" + scenario["name"],
+        "--benchmark_checkpoint_frames={}".format(args.checkpoint_frames),
+    ])
+    if args.frames:
+        command.append("--benchmark_frames={}".format(args.frames))
+    command.extend(args.option)
+    process = subprocess.run(
+        command, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+        timeout=args.timeout)
+    if not os.path.exists(report_path):
+        return None
+    with open(report_path, "r", encoding="UTF-8") as f:
+        report = json.load(f)
+    report["exit_code"] = process.returncode
+    return report
+
+
+def mode_key(report):
+    return "{} {}".format(report.get("cpu", "?"), report.get("chipset", "?"))
+
+
+def geometric_mean(values):
+    values = [v for v in values if v > 0]
+    if not values:
+        return 0.0
+    return math.exp(sum(math.log(v) for v in values) / len(values))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Run the FS-UAE benchmark corpus")
+    parser.add_argument("corpus", help="directory with input recordings")
+    parser.add_argument("--fs-uae", default="fs-uae",
+                        help="FS-UAE executable")
+    parser.add_argument("--runs", type=int, default=2,
+                        help="runs per scenario (default 2)")
+    parser.add_argument("--frames", type=int, default=0,
+                        help="stop each scenario after this many frames")
+    parser.add_argument("--checkpoint-frames", type=int, default=250,
+                        help="frames between checkpoints (default 250)")
+    parser.add_argument("--timeout", type=int, default=3600,
+                        help="timeout in seconds per run")
+    parser.add_argument("--option", action="append", default=[],
+                        help="extra FS-UAE option, e.g. --option=--jit_compiler=1")
+    parser.add_argument("--output", help="write combined results here")
+    parser.add_argument("--reference",
+                        help="results from an earlier run to compare with")
+    parser.add_argument("--max-regression", type=float, default=5.0,
+                        help="allowed fps regression in percent (default 5)")
+    parser.add_argument("--strict", action="store_true",
+                        help="fail when checkpoints differ from reference")
+    args = parser.parse_args()
+
+    scenarios = find_scenarios(args.corpus)
+    if not scenarios:
+        print("No recordings found in", args.corpus)
+        return 1
+
+    reference = {}
+    if args.reference:
+        with open(args.reference, "r", encoding="UTF-8") as f:
+            for result in json.load(f)["scenarios"]:
+                reference[result["scenario"]] = result
+
+    failed = False
+    results = []
+    with tempfile.TemporaryDirectory(prefix="fs-uae-benchmark-") as temp_dir:
+        for scenario in scenarios:
+            reports = []
+            for _ in range(args.runs):
+                report = run_scenario(args, scenario, temp_dir)
+                if report is None or report["exit_code"] != 0:
+                    break
+                reports.append(report)
+            name = scenario["name"]
+            if len(reports) != args.runs:
+                print("{:<32} FAILED".format(name))
+                failed = True
+                continue
+            result = max(reports, key=lambda r: r["fps"])
+            del result["exit_code"]
+            result["runs"] = [r["fps"] for r in reports]
+            status = []
+            if any(r["checkpoints"] != reports[0]["checkpoints"]
+                   for r in reports):
+                status.append("NON-DETERMINISTIC")
+                failed = True
+            ref = reference.get(name)
+            if ref is not None:
+                if ref["fps"] > 0:
+                    change = (result["fps"] - ref["fps"]) * 100.0 / ref["fps"]
+                    status.append("{:+.1f}%".format(change))
+                    if change < -args.max_regression:
+                        status.append("REGRESSION")
+                        failed = True
+                if ref["checkpoints"] != result["checkpoints"]:
+                    status.append("CHANGED")
+                    if args.strict:
+                        failed = True
+            print("{:<32} {:>9.2f} fps  {:<24} {}".format(
+                name, result["fps"], mode_key(result), " ".join(status)))
+            results.append(result)
+
+    modes = {}
+    for result in results:
+        modes.setdefault(mode_key(result), []).append(result["fps"])
+    print()
+    for mode in sorted(modes):
+        print("{:<32} {:>9.2f} fps  ({} scenarios, geometric mean)".format(
+            mode, geometric_mean(modes[mode]), len(modes[mode])))
+
+    if args.output:
+        with open(args.output, "w", encoding="UTF-8") as f:
+            json.dump({"scenarios": results}, f, indent=2, sort_keys=True)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -116,6 +116,8 @@ typedef struct fs_emu_key_translation {
 } fs_emu_key_translation;
 
 int fs_emu_get_input_event();
+int fs_emu_get_input_event_timed(int64_t *time);
+int fs_emu_peek_input_event(int64_t *time);
 void fs_emu_queue_action(int action, int state);
 
 void fs_emu_set_custom_overlay_state(int overlay, int state);
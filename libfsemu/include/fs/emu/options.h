@@ -14,6 +14,7 @@
 #define OPTION_SUB_TITLE "sub_title"
 #define OPTION_TITLE "title"
 #define OPTION_VIDEO_DRIVER "video_driver"
+#define OPTION_VIDEO_SCALER "video_scaler"
 
 #include <fs/ml/options.h>
 
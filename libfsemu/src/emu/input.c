@@ -763,27 +763,151 @@ void fs_emu_reset_input_mapping()
     }
 }
 
-static fs_mutex* g_input_event_mutex;
-static GQueue* g_input_event_queue;
+/* Input events are passed from the UI (and netplay) threads to the
+ * emulation thread through a bounded lock-free ring. Each slot carries a
+ * sequence number (the usual bounded MPMC scheme) so that more than one
+ * thread can queue events safely, while the emulation thread remains the
+ * only consumer. Every event is stamped with the host monotonic time when
+ * it was queued, so the emulator can place it at the matching position
+ * within the emulated frame.
+ *
+ * Events are never dropped. When the ring is full, they are appended to
+ * an unbounded, mutex protected overflow queue instead, and later events
+ * follow them there (keeping the order) until the emulation thread has
+ * drained first the ring and then the overflow queue. */
+
+#define INPUT_EVENT_RING_SIZE 1024
+#define INPUT_EVENT_RING_MASK (INPUT_EVENT_RING_SIZE - 1)
+
+typedef struct input_event_slot {
+    volatile unsigned int sequence;
+    int input_event;
+    int64_t time;
+} input_event_slot;
+
+typedef struct input_event_overflow {
+    int input_event;
+    int64_t time;
+} input_event_overflow;
+
+static input_event_slot g_input_event_ring[INPUT_EVENT_RING_SIZE];
+static volatile unsigned int g_input_event_write;
+static volatile unsigned int g_input_event_read;
+
+static fs_mutex *g_input_event_overflow_mutex;
+static GQueue *g_input_event_overflow;
+static volatile int g_input_event_overflow_count;
+
+static void queue_input_event_overflow(int input_event, int64_t time)
+{
+    input_event_overflow *item = g_new(input_event_overflow, 1);
+    item->input_event = input_event;
+    item->time = time;
+    fs_mutex_lock(g_input_event_overflow_mutex);
+    g_queue_push_tail(g_input_event_overflow, item);
+    __atomic_add_fetch(&g_input_event_overflow_count, 1, __ATOMIC_RELEASE);
+    fs_mutex_unlock(g_input_event_overflow_mutex);
+}
 
-int fs_emu_get_input_event()
+static int fs_emu_input_event_head(int64_t *time, int remove)
 {
-    fs_mutex_lock(g_input_event_mutex);
-    int input_event = FS_POINTER_TO_INT(g_queue_pop_tail(
-            g_input_event_queue));
-    fs_mutex_unlock(g_input_event_mutex);
+    unsigned int pos = g_input_event_read;
+    input_event_slot *slot = &g_input_event_ring[pos & INPUT_EVENT_RING_MASK];
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) == pos + 1) {
+        int input_event = slot->input_event;
+        if (time) {
+            *time = slot->time;
+        }
+        if (remove) {
+            __atomic_store_n(&g_input_event_read, pos + 1, __ATOMIC_RELAXED);
+            /* Hand the slot back to the producers for the next lap. */
+            __atomic_store_n(&slot->sequence, pos + INPUT_EVENT_RING_SIZE,
+                    __ATOMIC_RELEASE);
+        }
+        return input_event;
+    }
+    /* The ring is empty; older events may still wait in the overflow
+     * queue. This is the only path taking the mutex, and only while the
+     * overflow queue is in use. */
+    if (__atomic_load_n(&g_input_event_overflow_count, __ATOMIC_ACQUIRE) == 0) {
+        return 0;
+    }
+    int input_event = 0;
+    fs_mutex_lock(g_input_event_overflow_mutex);
+    input_event_overflow *item = (input_event_overflow *) g_queue_peek_head(
+            g_input_event_overflow);
+    if (item) {
+        input_event = item->input_event;
+        if (time) {
+            *time = item->time;
+        }
+        if (remove) {
+            g_queue_pop_head(g_input_event_overflow);
+            __atomic_sub_fetch(&g_input_event_overflow_count, 1,
+                    __ATOMIC_RELEASE);
+            g_free(item);
+        }
+    }
+    fs_mutex_unlock(g_input_event_overflow_mutex);
     return input_event;
 }
 
+int fs_emu_peek_input_event(int64_t *time)
+{
+    return fs_emu_input_event_head(time, 0);
+}
+
+int fs_emu_get_input_event_timed(int64_t *time)
+{
+    return fs_emu_input_event_head(time, 1);
+}
+
+int fs_emu_get_input_event()
+{
+    return fs_emu_get_input_event_timed(NULL);
+}
+
 void fs_emu_queue_input_event_internal(int input_event)
 {
     if (input_event == 0) {
         fs_log("WARNING: tried to queue input event 0\n");
         return;
     }
-    fs_mutex_lock(g_input_event_mutex);
-    g_queue_push_head(g_input_event_queue, FS_INT_TO_POINTER(input_event));
-    fs_mutex_unlock(g_input_event_mutex);
+    int64_t now = fs_emu_monotonic_time();
+    if (__atomic_load_n(&g_input_event_overflow_count, __ATOMIC_ACQUIRE) > 0) {
+        /* Must not overtake the events already in the overflow queue. */
+        queue_input_event_overflow(input_event, now);
+        return;
+    }
+    unsigned int pos = __atomic_load_n(&g_input_event_write, __ATOMIC_RELAXED);
+    input_event_slot *slot;
+    while (1) {
+        slot = &g_input_event_ring[pos & INPUT_EVENT_RING_MASK];
+        unsigned int sequence = __atomic_load_n(
+                &slot->sequence, __ATOMIC_ACQUIRE);
+        int diff = (int) (sequence - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&g_input_event_write, &pos,
+                    pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+            /* pos was reloaded by the failed exchange */
+        } else if (diff < 0) {
+            static int warned = 0;
+            if (!warned) {
+                fs_log("WARNING: input event queue full, using overflow "
+                       "queue\n");
+                warned = 1;
+            }
+            queue_input_event_overflow(input_event, now);
+            return;
+        } else {
+            pos = __atomic_load_n(&g_input_event_write, __ATOMIC_RELAXED);
+        }
+    }
+    slot->input_event = input_event;
+    slot->time = now;
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
 }
 
 void fs_emu_queue_action(int action, int state)
@@ -1845,8 +1969,11 @@ void fs_emu_input_init_2(void)
 {
     fs_log("[INPUT] fs_emu_input_init\n");
 
-    g_input_event_mutex = fs_mutex_create();
-    g_input_event_queue = g_queue_new();
+    for (int i = 0; i < INPUT_EVENT_RING_SIZE; i++) {
+        g_input_event_ring[i].sequence = i;
+    }
+    g_input_event_overflow_mutex = fs_mutex_create();
+    g_input_event_overflow = g_queue_new();
 
     init_input_configs();
 
@@ -11,6 +11,18 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+/* Size of the asynchronous log queue (number of messages, must be a power
+ * of two) and the maximum number of bytes allowed to be queued. Messages
+ * logged when either limit is reached are dropped and counted. */
+#define LOG_QUEUE_SIZE 4096
+#define LOG_QUEUE_MAX_BYTES (4 * 1024 * 1024)
+
+typedef struct log_queue_cell {
+    volatile gint sequence;
+    char *message;
+} log_queue_cell;
 
 static struct {
     int use_stdout;
@@ -19,6 +31,24 @@ static struct {
     int initialized;
     fs_mutex *mutex;
     int flush;
+
+    /* Asynchronous logging: messages are formatted by the calling thread,
+     * pushed to a bounded lock-free queue and written by a background
+     * thread, so log I/O never happens on the emulation thread. */
+    int async;
+    fs_thread *thread;
+    fs_semaphore *semaphore;
+    log_queue_cell queue[LOG_QUEUE_SIZE];
+    volatile gint enqueue_pos;
+    gint dequeue_pos;
+    volatile gint queued_bytes;
+    volatile gint dropped;
+    volatile gint writer_idle;
+    volatile gint quit;
+
+    /* Owned by the writer thread, used to collapse repeated messages. */
+    char *last_message;
+    int repeat_count;
 } log;
 
 static void initialize()
@@ -46,6 +76,201 @@ static void initialize()
     g_free(dir);
 }
 
+static void log_write_unlocked(const char *str)
+{
+    if (log.use_stdout) {
+        printf("%s", str);
+        fflush(stdout);
+    }
+    if (log.file) {
+        fprintf(log.file, "%s", str);
+    }
+}
+
+static int log_queue_push(char *message)
+{
+    guint pos = (guint) g_atomic_int_get(&log.enqueue_pos);
+    log_queue_cell *cell;
+    while (1) {
+        cell = &log.queue[pos & (LOG_QUEUE_SIZE - 1)];
+        guint sequence = (guint) g_atomic_int_get(&cell->sequence);
+        gint diff = (gint) (sequence - pos);
+        if (diff == 0) {
+            if (g_atomic_int_compare_and_exchange(
+                    &log.enqueue_pos, (gint) pos, (gint) (pos + 1))) {
+                break;
+            }
+            pos = (guint) g_atomic_int_get(&log.enqueue_pos);
+        } else if (diff < 0) {
+            /* Queue is full. */
+            return 0;
+        } else {
+            pos = (guint) g_atomic_int_get(&log.enqueue_pos);
+        }
+    }
+    cell->message = message;
+    g_atomic_int_set(&cell->sequence, (gint) (pos + 1));
+    return 1;
+}
+
+static char *log_queue_pop(void)
+{
+    /* Only called from the writer thread (single consumer). */
+    guint pos = (guint) log.dequeue_pos;
+    log_queue_cell *cell = &log.queue[pos & (LOG_QUEUE_SIZE - 1)];
+    guint sequence = (guint) g_atomic_int_get(&cell->sequence);
+    if ((gint) (sequence - (pos + 1)) < 0) {
+        return NULL;
+    }
+    char *message = cell->message;
+    cell->message = NULL;
+    g_atomic_int_set(&cell->sequence, (gint) (pos + LOG_QUEUE_SIZE));
+    log.dequeue_pos = (gint) (pos + 1);
+    return message;
+}
+
+static void log_write_repeat_count_unlocked(void)
+{
+    if (log.repeat_count > 0) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer),
+                 "[LOG] last message repeated %d times\n", log.repeat_count);
+        log_write_unlocked(buffer);
+        log.repeat_count = 0;
+    }
+}
+
+static void log_write_queued_unlocked(char *message)
+{
+    if (log.last_message && strcmp(message, log.last_message) == 0) {
+        log.repeat_count += 1;
+        g_free(message);
+        return;
+    }
+    log_write_repeat_count_unlocked();
+    log_write_unlocked(message);
+    g_free(log.last_message);
+    log.last_message = message;
+}
+
+static int log_drain(void)
+{
+    int count = 0;
+    fs_mutex_lock(log.mutex);
+    char *message;
+    while ((message = log_queue_pop())) {
+        g_atomic_int_add(&log.queued_bytes, -((gint) strlen(message) + 1));
+        log_write_queued_unlocked(message);
+        count += 1;
+    }
+    int dropped = g_atomic_int_get(&log.dropped);
+    if (dropped > 0) {
+        g_atomic_int_add(&log.dropped, -dropped);
+        log_write_repeat_count_unlocked();
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer),
+                 "[LOG] %d messages dropped (queue full)\n", dropped);
+        log_write_unlocked(buffer);
+        g_free(log.last_message);
+        log.last_message = NULL;
+    }
+    if (count > 0 && log.flush && log.file) {
+        fflush(log.file);
+    }
+    fs_mutex_unlock(log.mutex);
+    return count;
+}
+
+static void *log_thread(void *data)
+{
+    while (1) {
+        log_drain();
+        if (g_atomic_int_get(&log.quit)) {
+            break;
+        }
+        g_atomic_int_set(&log.writer_idle, 1);
+        /* Re-check the queue after announcing that we are idle, so we do
+         * not miss a message pushed just before the flag was set. */
+        if (log_drain() > 0 || g_atomic_int_get(&log.quit)) {
+            if (g_atomic_int_compare_and_exchange(&log.writer_idle, 1, 0)) {
+                continue;
+            }
+        }
+        fs_semaphore_wait(log.semaphore);
+    }
+    fs_mutex_lock(log.mutex);
+    log_write_repeat_count_unlocked();
+    if (log.file) {
+        fflush(log.file);
+    }
+    fs_mutex_unlock(log.mutex);
+    return NULL;
+}
+
+static void log_wake_writer(void)
+{
+    if (g_atomic_int_compare_and_exchange(&log.writer_idle, 1, 0)) {
+        fs_semaphore_post(log.semaphore);
+    }
+}
+
+static void log_stop_async(void)
+{
+    if (!log.async) {
+        return;
+    }
+    g_atomic_int_set(&log.quit, 1);
+    g_atomic_int_set(&log.writer_idle, 0);
+    fs_semaphore_post(log.semaphore);
+    fs_thread_wait(log.thread);
+    fs_thread_free(log.thread);
+    log.thread = NULL;
+    log.async = 0;
+    /* Anything logged while the thread was shutting down. */
+    log_drain();
+}
+
+static void log_start_async(void)
+{
+    if (log.async) {
+        return;
+    }
+    for (int i = 0; i < LOG_QUEUE_SIZE; i++) {
+        log.queue[i].sequence = i;
+        log.queue[i].message = NULL;
+    }
+    log.enqueue_pos = 0;
+    log.dequeue_pos = 0;
+    log.semaphore = fs_semaphore_create(0);
+    log.thread = fs_thread_create("log", log_thread, NULL);
+    if (log.thread == NULL) {
+        fs_semaphore_destroy(log.semaphore);
+        log.semaphore = NULL;
+        return;
+    }
+    log.async = 1;
+    atexit(log_stop_async);
+}
+
+static void log_string_async(char *str)
+{
+    gint size = strlen(str) + 1;
+    if (g_atomic_int_add(&log.queued_bytes, size) + size
+            > LOG_QUEUE_MAX_BYTES) {
+        g_atomic_int_add(&log.queued_bytes, -size);
+        g_atomic_int_inc(&log.dropped);
+        g_free(str);
+        return;
+    }
+    if (!log_queue_push(str)) {
+        g_atomic_int_add(&log.queued_bytes, -size);
+        g_atomic_int_inc(&log.dropped);
+        g_free(str);
+        return;
+    }
+    log_wake_writer();
+}
+
 void fs_log_enable_stdout()
 {
     log.use_stdout = 1;
@@ -89,6 +314,13 @@ void fs_config_set_log_file(const char *path)
     if (log.flush) {
         fs_log_string("flush_log: will flush log after each log line\n");
     }
+
+    if (fs_config_get_boolean("log_async") == 1) {
+        log_start_async();
+        if (log.async) {
+            fs_log_string("log_async: logging from background thread\n");
+        }
+    }
 }
 
 void fs_log_string(const char *str)
@@ -96,15 +328,13 @@ void fs_log_string(const char *str)
     if (!log.initialized) {
         initialize();
     }
-    fs_mutex_lock(log.mutex);
-    if (log.use_stdout) {
-        printf("%s", str);
-        fflush(stdout);
-    }
-    if (log.file) {
-        fprintf(log.file, "%s", str);
+    if (log.async) {
+        log_string_async(g_strdup(str));
+        return;
     }
-    if (log.flush) {
+    fs_mutex_lock(log.mutex);
+    log_write_unlocked(str);
+    if (log.flush && log.file) {
         fflush(log.file);
     }
     fs_mutex_unlock(log.mutex);
@@ -116,6 +346,11 @@ void fs_log(const char *format, ...)
     va_start(ap, format);
     char *buffer = g_strdup_vprintf(format, ap);
     va_end(ap);
+    if (log.async) {
+        /* The queue takes ownership of the formatted buffer. */
+        log_string_async(buffer);
+        return;
+    }
     fs_log_string(buffer);
     g_free(buffer);
 }
@@ -0,0 +1,527 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#define FSE_INTERNAL_API
+#include <fs/emu/buffer.h>
+#include <fs/glib.h>
+#include <fs/log.h>
+#include <fs/thread.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef WINDOWS
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "scaler.h"
+
+#define MAX_THREADS 8
+#define MIN_BAND_ROWS 16
+
+struct fse_scaler {
+    int filter;
+
+    uint32_t *pixels;
+    int width;
+    int height;
+
+    /* source rectangle the tables are built for */
+    int src_x;
+    int src_y;
+    int src_w;
+    int src_h;
+    /* pixel aspect ratio of the source (fs_emu_buffer.aspect) */
+    double aspect;
+
+    /* scaled area in the output image, centered with black borders */
+    int area_x;
+    int area_y;
+    int area_w;
+    int area_h;
+
+    /* for each column / row of the area, the first source pixel and the
+     * weight (0 - 256) of the pixel following it */
+    int *x_index;
+    uint16_t *x_weight;
+    int *y_index;
+    uint16_t *y_weight;
+    /* all columns use a single source pixel (and weight zero) */
+    int x_nearest;
+    /* every source pixel is repeated exactly x_factor times, or 0 */
+    int x_factor;
+
+    bool valid;
+    int last_seq;
+
+    /* area rows to scale this frame */
+    int *rows;
+    int num_rows;
+    /* one line of vertically blended source pixels per band */
+    uint32_t *temp[MAX_THREADS];
+
+    const uint8_t *src;
+    int src_stride;
+};
+
+typedef struct scaler_worker {
+    fs_semaphore *go;
+    int band;
+    int first;
+    int last;
+} scaler_worker;
+
+static scaler_worker g_workers[MAX_THREADS - 1];
+static int g_num_workers = -1;
+static fs_semaphore *g_job_done;
+static fse_scaler *g_job;
+
+static inline uint32_t blend(uint32_t a, uint32_t b, unsigned int w)
+{
+    uint32_t rb = ((a & 0x00ff00ff) * (256 - w) +
+                   (b & 0x00ff00ff) * w) >> 8;
+    uint32_t ag = ((a >> 8) & 0x00ff00ff) * (256 - w) +
+                  ((b >> 8) & 0x00ff00ff) * w;
+    return (rb & 0x00ff00ff) | (ag & 0xff00ff00);
+}
+
+static void blend_rows(uint32_t *dst, const uint32_t *a, const uint32_t *b,
+        int n, int w)
+{
+    int i = 0;
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128();
+    __m128i wa = _mm_set1_epi16(256 - w);
+    __m128i wb = _mm_set1_epi16(w);
+    for (; i + 4 <= n; i += 4) {
+        __m128i va = _mm_loadu_si128((const __m128i *) (a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *) (b + i));
+        __m128i lo = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+        __m128i hi = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(
+                _mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = blend(a[i], b[i], w);
+    }
+}
+
+static void blend_columns(uint32_t *dst, const uint32_t *src,
+        const int *index, const uint16_t *weight, int n)
+{
+    int i = 0;
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128();
+    __m128i full = _mm_set1_epi16(256);
+    for (; i + 4 <= n; i += 4) {
+        const int *x = index + i;
+        const uint16_t *w = weight + i;
+        __m128i va = _mm_set_epi32(src[x[3]], src[x[2]], src[x[1]],
+                                   src[x[0]]);
+        __m128i vb = _mm_set_epi32(src[x[3] + 1], src[x[2] + 1],
+                                   src[x[1] + 1], src[x[0] + 1]);
+        __m128i wlo = _mm_set_epi16(w[1], w[1], w[1], w[1],
+                                    w[0], w[0], w[0], w[0]);
+        __m128i whi = _mm_set_epi16(w[3], w[3], w[3], w[3],
+                                    w[2], w[2], w[2], w[2]);
+        __m128i lo = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpacklo_epi8(va, zero),
+                                _mm_sub_epi16(full, wlo)),
+                _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wlo));
+        __m128i hi = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpackhi_epi8(va, zero),
+                                _mm_sub_epi16(full, whi)),
+                _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), whi));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(
+                _mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = blend(src[index[i]], src[index[i] + 1], weight[i]);
+    }
+}
+
+static void nearest_columns(uint32_t *dst, const uint32_t *src,
+        const int *index, int n)
+{
+    for (int i = 0; i < n; i++) {
+        dst[i] = src[index[i]];
+    }
+}
+
+static void repeat_columns(uint32_t *dst, const uint32_t *src, int n,
+        int factor)
+{
+    int i = 0;
+    if (factor == 1) {
+        memcpy(dst, src, n * 4);
+        return;
+    }
+#ifdef __SSE2__
+    if (factor == 2) {
+        for (; i + 4 <= n; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+            _mm_storeu_si128((__m128i *) (dst + i * 2),
+                             _mm_unpacklo_epi32(v, v));
+            _mm_storeu_si128((__m128i *) (dst + i * 2 + 4),
+                             _mm_unpackhi_epi32(v, v));
+        }
+    }
+#endif
+    dst += i * factor;
+    for (; i < n; i++) {
+        uint32_t p = src[i];
+        for (int j = 0; j < factor; j++) {
+            *dst++ = p;
+        }
+    }
+}
+
+static inline const uint32_t *source_row(fse_scaler *s, int y)
+{
+    return (const uint32_t *) (s->src + y * s->src_stride);
+}
+
+static void scale_rows(fse_scaler *s, int band, int first, int last)
+{
+    for (int r = first; r < last; r++) {
+        int y = s->rows[r];
+        int y0 = s->y_index[y];
+        int w = s->y_weight[y];
+        const uint32_t *line;
+        if (w == 0) {
+            line = source_row(s, y0);
+        } else if (w == 256) {
+            line = source_row(s, y0 + 1);
+        } else {
+            blend_rows(s->temp[band], source_row(s, y0),
+                       source_row(s, y0 + 1), s->src_w, w);
+            line = s->temp[band];
+        }
+        uint32_t *out = s->pixels + (s->area_y + y) * s->width + s->area_x;
+        if (s->x_factor) {
+            repeat_columns(out, line, s->src_w, s->x_factor);
+        } else if (s->x_nearest) {
+            nearest_columns(out, line, s->x_index, s->area_w);
+        } else {
+            blend_columns(out, line, s->x_index, s->x_weight, s->area_w);
+        }
+    }
+}
+
+static void *worker_thread(void *data)
+{
+    scaler_worker *w = (scaler_worker *) data;
+    while (true) {
+        fs_semaphore_wait(w->go);
+        scale_rows(g_job, w->band, w->first, w->last);
+        fs_semaphore_post(g_job_done);
+    }
+    return NULL;
+}
+
+static int host_cpus(void)
+{
+#ifdef WINDOWS
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+#endif
+}
+
+static void init_workers(void)
+{
+    int count = host_cpus();
+    if (count > MAX_THREADS) {
+        count = MAX_THREADS;
+    }
+    g_job_done = fs_semaphore_create(0);
+    g_num_workers = 0;
+    for (int i = 0; i < count - 1; i++) {
+        scaler_worker *w = g_workers + i;
+        w->go = fs_semaphore_create(0);
+        if (!fs_thread_create("scaler", worker_thread, w)) {
+            fs_semaphore_destroy(w->go);
+            break;
+        }
+        g_num_workers++;
+    }
+    fs_log("[VIDEO] CPU scaler using %d thread(s)\n", g_num_workers + 1);
+}
+
+/* Only called from the video thread, there is one job at a time. */
+static void run_bands(fse_scaler *s)
+{
+    int rows = s->num_rows;
+    int bands = g_num_workers + 1;
+    if (rows / MIN_BAND_ROWS < bands) {
+        bands = rows / MIN_BAND_ROWS;
+    }
+    if (bands <= 1) {
+        scale_rows(s, 0, 0, rows);
+        return;
+    }
+    g_job = s;
+    for (int i = 0; i < bands - 1; i++) {
+        scaler_worker *w = g_workers + i;
+        w->band = i + 1;
+        w->first = rows * i / bands;
+        w->last = rows * (i + 1) / bands;
+        fs_semaphore_post(w->go);
+    }
+    scale_rows(s, 0, rows * (bands - 1) / bands, rows);
+    for (int i = 0; i < bands - 1; i++) {
+        fs_semaphore_wait(g_job_done);
+    }
+}
+
+static void build_axis(int filter, int src, int dst, int *index,
+        uint16_t *weight)
+{
+    double scale = (double) dst / src;
+    int prescale = (int) scale;
+    if (prescale < 1) {
+        prescale = 1;
+    }
+    for (int i = 0; i < dst; i++) {
+        if (filter == FSE_SCALER_INTEGER) {
+            /* dst is a multiple of src here */
+            index[i] = i / (dst / src);
+            weight[i] = 0;
+            continue;
+        }
+        double texel = (i + 0.5) / scale;
+        if (filter == FSE_SCALER_SHARP_BILINEAR) {
+            /* Nearest neighbour scaling by the integer factor, and
+             * bilinear filtering only across the seams between the
+             * resulting blocks. */
+            double t = floor(texel);
+            double d = texel - t - 0.5;
+            double region = 0.5 - 0.5 / prescale;
+            if (d < -region) {
+                d += region;
+            } else if (d > region) {
+                d -= region;
+            } else {
+                d = 0.0;
+            }
+            texel = t + d * prescale + 0.5;
+        }
+        double pos = texel - 0.5;
+        if (pos < 0.0) {
+            pos = 0.0;
+        }
+        int x = (int) pos;
+        int w = (int) ((pos - x) * 256.0 + 0.5);
+        if (w == 256) {
+            x += 1;
+            w = 0;
+        }
+        /* the following pixel must exist */
+        if (x >= src - 1) {
+            x = src > 1 ? src - 2 : 0;
+            w = src > 1 ? 256 : 0;
+        }
+        index[i] = x;
+        weight[i] = w;
+    }
+}
+
+static void configure(fse_scaler *s, int src_w, int src_h, double aspect,
+        int width, int height)
+{
+    if (width != s->width || height != s->height) {
+        g_free(s->pixels);
+        s->pixels = g_malloc(width * height * 4);
+        s->width = width;
+        s->height = height;
+    }
+    memset(s->pixels, 0, width * height * 4);
+
+    s->src_w = src_w;
+    s->src_h = src_h;
+    s->aspect = aspect;
+    int filter = s->filter;
+    int factor = MIN(width / src_w, height / src_h);
+    if (filter == FSE_SCALER_INTEGER && factor >= 1) {
+        /* largest integer factor that fits both axes */
+        s->area_w = src_w * factor;
+        s->area_h = src_h * factor;
+    } else {
+        /* fit the source with its aspect ratio, integer scaling falls
+         * back to bilinear when the source is larger than the output */
+        if (filter == FSE_SCALER_INTEGER) {
+            filter = FSE_SCALER_BILINEAR;
+        }
+        double source_aspect = (double) src_w / src_h * aspect;
+        if ((double) width / height > source_aspect) {
+            s->area_h = height;
+            s->area_w = (int) (height * source_aspect + 0.5);
+        } else {
+            s->area_w = width;
+            s->area_h = (int) (width / source_aspect + 0.5);
+        }
+        s->area_w = CLAMP(s->area_w, 1, width);
+        s->area_h = CLAMP(s->area_h, 1, height);
+    }
+    s->area_x = (width - s->area_w) / 2;
+    s->area_y = (height - s->area_h) / 2;
+
+    g_free(s->x_index);
+    g_free(s->x_weight);
+    g_free(s->y_index);
+    g_free(s->y_weight);
+    g_free(s->rows);
+    s->x_index = g_new(int, s->area_w);
+    s->x_weight = g_new(uint16_t, s->area_w);
+    s->y_index = g_new(int, s->area_h);
+    s->y_weight = g_new(uint16_t, s->area_h);
+    s->rows = g_new(int, s->area_h);
+    build_axis(filter, src_w, s->area_w, s->x_index, s->x_weight);
+    build_axis(filter, src_h, s->area_h, s->y_index, s->y_weight);
+
+    s->x_nearest = 1;
+    for (int i = 0; i < s->area_w; i++) {
+        if (s->x_weight[i] != 0 && s->x_weight[i] != 256) {
+            s->x_nearest = 0;
+            break;
+        }
+    }
+    if (s->x_nearest) {
+        for (int i = 0; i < s->area_w; i++) {
+            if (s->x_weight[i]) {
+                s->x_index[i] += 1;
+                s->x_weight[i] = 0;
+            }
+        }
+    }
+    /* integer scaling, and sharp bilinear scaling by an integer factor,
+     * just repeat every source pixel */
+    s->x_factor = 0;
+    if (s->x_nearest && s->area_w % src_w == 0) {
+        int factor = s->area_w / src_w;
+        s->x_factor = factor;
+        for (int i = 0; i < s->area_w; i++) {
+            if (s->x_index[i] != i / factor) {
+                s->x_factor = 0;
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i <= g_num_workers; i++) {
+        g_free(s->temp[i]);
+        s->temp[i] = g_new(uint32_t, src_w);
+    }
+
+    fs_log("[VIDEO] CPU scaler %dx%d -> %dx%d (area %dx%d)%s\n",
+           src_w, src_h, width, height, s->area_w, s->area_h,
+           s->x_factor ? " repeating pixels" : "");
+}
+
+static inline bool line_updated(fs_emu_buffer *buffer, int y)
+{
+    /* a set line flag means that the line is unchanged */
+    return y >= FS_EMU_MAX_LINES || !buffer->line[y];
+}
+
+bool fse_scaler_scale(fse_scaler *s, fs_emu_buffer *buffer,
+        int width, int height, int *first_row, int *last_row)
+{
+    fs_emu_rect crop = buffer->crop;
+    if (crop.w <= 0 || crop.h <= 0) {
+        crop.x = 0;
+        crop.y = 0;
+        crop.w = buffer->width;
+        crop.h = buffer->height;
+    }
+    if (buffer->bpp != 4 || buffer->data == NULL || width <= 0 ||
+            height <= 0 || crop.w <= 0 || crop.h <= 0) {
+        return false;
+    }
+
+    double aspect = buffer->aspect > 0.0 ? buffer->aspect : 1.0;
+    bool full = !s->valid || buffer->seq != s->last_seq + 1 ||
+            crop.x != s->src_x || crop.y != s->src_y;
+    if (!s->valid || width != s->width || height != s->height ||
+            crop.w != s->src_w || crop.h != s->src_h ||
+            aspect != s->aspect) {
+        configure(s, crop.w, crop.h, aspect, width, height);
+        full = true;
+    }
+    s->valid = true;
+    s->last_seq = buffer->seq;
+    s->src_x = crop.x;
+    s->src_y = crop.y;
+    s->src = (const uint8_t *) buffer->data + crop.y * buffer->stride +
+            crop.x * 4;
+    s->src_stride = buffer->stride;
+
+    s->num_rows = 0;
+    for (int y = 0; y < s->area_h; y++) {
+        int y0 = crop.y + s->y_index[y];
+        if (full || line_updated(buffer, y0) ||
+                (s->y_weight[y] && line_updated(buffer, y0 + 1))) {
+            s->rows[s->num_rows++] = y;
+        }
+    }
+    if (s->num_rows == 0) {
+        return false;
+    }
+    run_bands(s);
+
+    if (full) {
+        *first_row = 0;
+        *last_row = s->height - 1;
+    } else {
+        *first_row = s->area_y + s->rows[0];
+        *last_row = s->area_y + s->rows[s->num_rows - 1];
+    }
+    return true;
+}
+
+const uint32_t *fse_scaler_pixels(fse_scaler *s, int *stride)
+{
+    *stride = s->width * 4;
+    return s->pixels;
+}
+
+fse_scaler *fse_scaler_create(int filter)
+{
+    if (g_num_workers < 0) {
+        init_workers();
+    }
+    fse_scaler *s = g_new0(fse_scaler, 1);
+    s->filter = filter;
+    return s;
+}
+
+void fse_scaler_destroy(fse_scaler *s)
+{
+    if (s == NULL) {
+        return;
+    }
+    g_free(s->pixels);
+    g_free(s->x_index);
+    g_free(s->x_weight);
+    g_free(s->y_index);
+    g_free(s->y_weight);
+    g_free(s->rows);
+    for (int i = 0; i < MAX_THREADS; i++) {
+        g_free(s->temp[i]);
+    }
+    g_free(s);
+}
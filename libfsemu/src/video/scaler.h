@@ -0,0 +1,32 @@
+#ifndef LIBFSEMU_VIDEO_SCALER_H_
+#define LIBFSEMU_VIDEO_SCALER_H_
+
+#include <fs/emu.h>
+#include <fs/emu/buffer.h>
+#include <stdint.h>
+
+/* CPU scaler for the SDL video drivers. Scales the crop rectangle of a
+ * 32-bit video buffer to a centered, aspect-correct area of the output
+ * with black borders, split in row bands over a pool of worker threads.
+ * Only output rows depending on source lines updated since the previous
+ * frame (see fs_emu_buffer.line) are scaled again. */
+
+#define FSE_SCALER_NONE 0
+#define FSE_SCALER_INTEGER 1
+#define FSE_SCALER_BILINEAR 2
+#define FSE_SCALER_SHARP_BILINEAR 3
+
+typedef struct fse_scaler fse_scaler;
+
+fse_scaler *fse_scaler_create(int filter);
+void fse_scaler_destroy(fse_scaler *scaler);
+
+/* Returns false if no output rows changed, otherwise the changed rows are
+ * first_row to last_row (inclusive). */
+bool fse_scaler_scale(fse_scaler *scaler, fs_emu_buffer *buffer,
+        int width, int height, int *first_row, int *last_row);
+
+/* Output image, width * height pixels as given to fse_scaler_scale. */
+const uint32_t *fse_scaler_pixels(fse_scaler *scaler, int *stride);
+
+#endif // LIBFSEMU_VIDEO_SCALER_H_
@@ -5,9 +5,13 @@
 #define FSE_INTERNAL_API
 #include <fs/emu/video.h>
 #include <fs/emu/buffer.h>
+#include <fs/emu/options.h>
+#include <fs/conf.h>
 #include <fs/log.h>
+#include <string.h>
 
 #include "SDL.h"
+#include "scaler.h"
 
 #define MAX_BUFFERS 3
 
@@ -26,6 +30,12 @@ static int g_buffer_width;
 static int g_buffer_height;
 static int g_buffer_bpp;
 
+/* Used instead of letting SDL scale when video_scaler is set */
+static fse_scaler *g_scaler;
+static SDL_Texture *g_scaler_texture;
+static int g_scaler_width;
+static int g_scaler_height;
+
 static void sdl_buffer_configure(int width, int height)
 {
     fs_log("[VIDEO] sdl_buffer_configure width=%d height=%d\n", width, height);
@@ -119,17 +129,77 @@ static void sdl_video_create_window(int width, int height)
     }
 
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
-    SDL_RenderSetLogicalSize(g_renderer, width, height);
+    /* the CPU scaler renders at the output size and letterboxes the
+     * frame itself */
+    if (!g_scaler) {
+        SDL_RenderSetLogicalSize(g_renderer, width, height);
+    }
 
     SDL_RenderClear(g_renderer);
     SDL_RenderPresent(g_renderer);
 }
 
+/* Scales the buffer to the window size on the CPU and uploads only the
+ * changed rows. Returns false if the buffer cannot be scaled this way. */
+static bool sdl_video_render_scaled(sdl_buffer *buffer)
+{
+    if (buffer->streaming || buffer->buffer.bpp != 4) {
+        return false;
+    }
+    int width, height;
+    if (SDL_GetRendererOutputSize(g_renderer, &width, &height) != 0) {
+        return false;
+    }
+    if (width != g_scaler_width || height != g_scaler_height) {
+        if (g_scaler_texture) {
+            SDL_DestroyTexture(g_scaler_texture);
+        }
+        g_scaler_texture = SDL_CreateTexture(
+                g_renderer, SDL_PIXELFORMAT_ARGB8888,
+                SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (g_scaler_texture == NULL) {
+            fs_log("[VIDEO] Could not create %dx%d texture for the CPU "
+                   "scaler\n", width, height);
+            g_scaler_width = 0;
+            g_scaler_height = 0;
+            return false;
+        }
+        SDL_SetTextureBlendMode(g_scaler_texture, SDL_BLENDMODE_NONE);
+        g_scaler_width = width;
+        g_scaler_height = height;
+    }
+
+    int first_row, last_row;
+    bool updated = fse_scaler_scale(g_scaler, &buffer->buffer, width,
+                                    height, &first_row, &last_row);
+    fs_emu_buffer_unlock();
+    if (updated) {
+        int stride;
+        const uint32_t *pixels = fse_scaler_pixels(g_scaler, &stride);
+        SDL_Rect rect;
+        rect.x = 0;
+        rect.y = first_row;
+        rect.w = width;
+        rect.h = last_row - first_row + 1;
+        SDL_UpdateTexture(g_scaler_texture, &rect,
+                          (const uint8_t *) pixels + first_row * stride,
+                          stride);
+    }
+
+    SDL_RenderClear(g_renderer);
+    SDL_RenderCopy(g_renderer, g_scaler_texture, NULL, NULL);
+    SDL_RenderPresent(g_renderer);
+    return true;
+}
+
 static void sdl_video_render(void)
 {
     int index = fs_emu_buffer_lock();
 
     sdl_buffer *buffer = g_buffers + index;
+    if (g_scaler && sdl_video_render_scaled(buffer)) {
+        return;
+    }
     SDL_Texture *texture = g_textures[index];
     // printf("size %d %d\n", buffer->buffer.width, buffer->buffer.height);
     // printf("crop %d %d %d %d\n", buffer->buffer.crop.x, buffer->buffer.crop.y,
@@ -174,6 +244,26 @@ static void sdl_video_render(void)
     }
 }
 
+static void init_scaler(void)
+{
+    const char *value = fs_config_get_const_string(OPTION_VIDEO_SCALER);
+    int filter = FSE_SCALER_NONE;
+    if (value == NULL || strcmp(value, "sdl") == 0) {
+        return;
+    } else if (strcmp(value, "integer") == 0) {
+        filter = FSE_SCALER_INTEGER;
+    } else if (strcmp(value, "bilinear") == 0) {
+        filter = FSE_SCALER_BILINEAR;
+    } else if (strcmp(value, "sharp-bilinear") == 0) {
+        filter = FSE_SCALER_SHARP_BILINEAR;
+    } else {
+        fs_log("[VIDEO] Unknown video scaler \"%s\"\n", value);
+        return;
+    }
+    fs_log("[VIDEO] Using CPU scaler (%s)\n", value);
+    g_scaler = fse_scaler_create(filter);
+}
+
 static void register_functions(void)
 {
     fse_video.create_window = sdl_video_create_window;
@@ -192,5 +282,6 @@ void fs_emu_video_sdl_init(void)
 {
     fs_log("[VIDEO] Initialize SDL video\n");
 #endif
+    init_scaler();
     register_functions();
 }
@@ -33,6 +33,7 @@
 #include "scsi.h"
 #include "threaddep/thread.h"
 #include "a2091.h"
+#include "ioqueue.h"
 #include "blkdev.h"
 #include "gui.h"
 #include "zfile.h"
@@ -278,6 +279,8 @@ static void freencrunit(struct wd_state *wd)
 {
 	if (!wd)
 		return;
+	ioqueue_destroy (wd->queue);
+	wd->queue = NULL;
 	for (int i = 0; i < MAX_SCSI_UNITS; i++) {
 		if (scsi_units[i] == wd) {
 			scsi_units[i] = NULL;
@@ -1434,6 +1437,16 @@ static uae_u32 makecmd (struct scsi_data *s, int msg, uae_u8 cmd)
 	return v;
 }
 
+static void scsi_process (void *wdv, uae_u32 v);
+
+/* The WD33C93 executes one command at a time, so each controller has a
+ * single lane. Controllers and other storage devices still run in
+ * parallel, and requests are counted per SCSI target. */
+static void wd_submit (struct wd_state *wds, uae_u32 v)
+{
+	ioqueue_submit (wds->queue, (v >> 24) & 0xff, scsi_process, wds, v);
+}
+
 static void writewdreg (struct wd_chip_state *wd, int sasr, uae_u8 val)
 {
 	switch (sasr)
@@ -1486,11 +1499,11 @@ void wdscsi_put (struct wd_chip_state *wd, struct wd_state *wds, uae_u8 d)
 		wd->wd_data_avail = 1;
 		if (scsi_send_data (wd->scsi, wd->wdregs[wd->sasr]) || gettc (wd) == 0) {
 			wd->wd_data_avail = 0;
-			write_comm_pipe_u32 (&wds->requests, makecmd (wd->scsi, 2, 0), 1);
+			wd_submit (wds, makecmd (wd->scsi, 2, 0));
 		}
 	} else if (wd->sasr == WD_COMMAND) {
 		wd->wd_busy = true;
-		write_comm_pipe_u32(&wds->requests, makecmd(wds->scsis[wd->wdregs[WD_DESTINATION_ID] & 7], 0, d), 1);
+		wd_submit (wds, makecmd (wds->scsis[wd->wdregs[WD_DESTINATION_ID] & 7], 0, d));
 		if (wd->scsi && wd->scsi->cd_emu_unit >= 0)
 			gui_flicker_led (LED_CD, wd->scsi->id, 1);
 	}
@@ -1531,7 +1544,7 @@ uae_u8 wdscsi_get (struct wd_chip_state *wd, struct wd_state *wds)
 		wd->wd_data_avail = 1;
 		if (status || gettc (wd) == 0) {
 			wd->wd_data_avail = 0;
-			write_comm_pipe_u32 (&wds->requests, makecmd (wd->scsi, 3, 0), 1);
+			wd_submit (wds, makecmd (wd->scsi, 3, 0));
 		}
 	} else if (wd->sasr == WD_SCSI_STATUS) {
 		wd->auxstatus &= ~0x80;
@@ -3204,71 +3217,64 @@ static void ew (struct wd_state *wd, int addr, uae_u32 value)
 	}
 }
 
-static void *scsi_thread (void *wdv)
+static void scsi_process (void *wdv, uae_u32 v)
 {
 	struct wd_state *wds = (struct wd_state*)wdv;
 	struct wd_chip_state *wd = &wds->wc;
-	for (;;) {
-		uae_u32 v = read_comm_pipe_u32_blocking (&wds->requests);
-		if (wds->scsi_thread_running == 0 || v == 0xfffffff)
-			break;
-		int cmd = v & 0x7f;
-		int msg = (v >> 8) & 0xff;
-		int unit = (v >> 24) & 0xff;
-		wd->scsi = wds->scsis[unit];
-		//write_log (_T("scsi_thread got msg=%d cmd=%d\n"), msg, cmd);
-		if (msg == 0) {
-			if (WD33C93_DEBUG > 0)
-				write_log (_T("%s command %02X\n"), WD33C93, cmd);
-			switch (cmd)
-			{
-			case WD_CMD_RESET:
-				wd_cmd_reset(wd, true);
-				break;
-			case WD_CMD_ABORT:
-				wd_cmd_abort (wd);
-				break;
-			case WD_CMD_SEL:
-				wd_cmd_sel (wd, wds, false);
-				break;
-			case WD_CMD_SEL_ATN:
-				wd_cmd_sel (wd, wds, true);
-				break;
-			case WD_CMD_SEL_ATN_XFER:
-				wd_cmd_sel_xfer (wd, wds, true);
-				break;
-			case WD_CMD_SEL_XFER:
-				wd_cmd_sel_xfer (wd, wds, false);
-				break;
-			case WD_CMD_TRANS_INFO:
-				wd_cmd_trans_info (wds, wd->scsi, false);
-				break;
-			case WD_CMD_TRANS_ADDR:
-				wd_cmd_trans_addr(wd, wds);
-				break;
-			case WD_CMD_NEGATE_ACK:
-				if (wd->wd_phase == CSR_MSGIN && wd->wd_selected)
-					wd_do_transfer_in(wd, wd->scsi, false);
-				break;
-			case WD_CMD_TRANSFER_PAD:
-				wd_cmd_trans_info (wds, wd->scsi, true);
-				break;
-			default:
-				wd->wd_busy = false;
-				write_log (_T("%s unimplemented/unknown command %02X\n"), WD33C93, cmd);
-				set_status (wd, CSR_INVALID, 10);
-				break;
-			}
-		} else if (msg == 1) {
-			wd_do_transfer_in (wd, wd->scsi, false);
-		} else if (msg == 2) {
-			wd_do_transfer_out (wd, wd->scsi);
-		} else if (msg == 3) {
-			wd_do_transfer_in (wd, wd->scsi, true);
+	int cmd = v & 0x7f;
+	int msg = (v >> 8) & 0xff;
+	int unit = (v >> 24) & 0xff;
+	wd->scsi = wds->scsis[unit];
+	//write_log (_T("scsi_thread got msg=%d cmd=%d\n"), msg, cmd);
+	if (msg == 0) {
+		if (WD33C93_DEBUG > 0)
+			write_log (_T("%s command %02X\n"), WD33C93, cmd);
+		switch (cmd)
+		{
+		case WD_CMD_RESET:
+			wd_cmd_reset(wd, true);
+			break;
+		case WD_CMD_ABORT:
+			wd_cmd_abort (wd);
+			break;
+		case WD_CMD_SEL:
+			wd_cmd_sel (wd, wds, false);
+			break;
+		case WD_CMD_SEL_ATN:
+			wd_cmd_sel (wd, wds, true);
+			break;
+		case WD_CMD_SEL_ATN_XFER:
+			wd_cmd_sel_xfer (wd, wds, true);
+			break;
+		case WD_CMD_SEL_XFER:
+			wd_cmd_sel_xfer (wd, wds, false);
+			break;
+		case WD_CMD_TRANS_INFO:
+			wd_cmd_trans_info (wds, wd->scsi, false);
+			break;
+		case WD_CMD_TRANS_ADDR:
+			wd_cmd_trans_addr(wd, wds);
+			break;
+		case WD_CMD_NEGATE_ACK:
+			if (wd->wd_phase == CSR_MSGIN && wd->wd_selected)
+				wd_do_transfer_in(wd, wd->scsi, false);
+			break;
+		case WD_CMD_TRANSFER_PAD:
+			wd_cmd_trans_info (wds, wd->scsi, true);
+			break;
+		default:
+			wd->wd_busy = false;
+			write_log (_T("%s unimplemented/unknown command %02X\n"), WD33C93, cmd);
+			set_status (wd, CSR_INVALID, 10);
+			break;
 		}
+	} else if (msg == 1) {
+		wd_do_transfer_in (wd, wd->scsi, false);
+	} else if (msg == 2) {
+		wd_do_transfer_out (wd, wd->scsi);
+	} else if (msg == 3) {
+		wd_do_transfer_in (wd, wd->scsi, true);
 	}
-	wds->scsi_thread_running = -1;
-	return 0;
 }
 
 void init_wd_scsi (struct wd_state *wd)
@@ -3281,11 +3287,8 @@ void init_wd_scsi (struct wd_state *wd)
 	if (wd == wd_cdtv) {
 		wd->cdtv = true;
 	}
-	if (!wd->scsi_thread_running) {
-		wd->scsi_thread_running = 1;
-		init_comm_pipe (&wd->requests, 100, 1);
-		uae_start_thread (_T("scsi"), scsi_thread, wd, NULL);
-	}
+	if (!wd->queue)
+		wd->queue = ioqueue_create (_T("scsi"), 1, 1);
 }
 
 void a3000_add_scsi_unit (int ch, struct uaedev_config_info *ci, struct romconfig *rc)
@@ -3316,13 +3319,6 @@ void a3000scsi_free (void)
 	if (!wd)
 		return;
 	freencrunit(wd);
-	if (wd->scsi_thread_running > 0) {
-		wd->scsi_thread_running = 0;
-		write_comm_pipe_u32 (&wd->requests, 0xffffffff, 1);
-		while(wd->scsi_thread_running == 0)
-			sleep_millis (10);
-		wd->scsi_thread_running = 0;
-	}
 }
 
 void a2090_add_scsi_unit(int ch, struct uaedev_config_info *ci, struct romconfig *rc)
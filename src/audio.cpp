@@ -78,9 +78,9 @@ STATIC_INLINE bool usehacks(void)
 
 #include "sinctable.cpp"
 
-typedef struct {
-	int time, output;
-} sinc_queue_t;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 struct audio_channel_data {
 	unsigned int adk_mask;
@@ -101,7 +101,10 @@ struct audio_channel_data {
 	uae_u16 dat, dat2;
 	int sample_accum, sample_accum_time;
 	int sinc_output_state;
-	sinc_queue_t sinc_queue[SINC_QUEUE_LENGTH];
+	/* Queue entries are stored twice (at i and i + SINC_QUEUE_LENGTH) so
+	 * that the entries starting at the head are always contiguous. */
+	int sinc_queue_times[SINC_QUEUE_LENGTH * 2];
+	int sinc_queue_outputs[SINC_QUEUE_LENGTH * 2];
     int sinc_queue_time;
     int sinc_queue_head;
 #if TEST_AUDIO > 0
@@ -532,9 +535,12 @@ static void sinc_prehandler_paula (unsigned long best_evtime)
 		/* if output state changes, record the state change and also
 		 * write data into sinc queue for mixing in the BLEP */
 		if (acd->sinc_output_state != output) {
-			acd->sinc_queue_head = (acd->sinc_queue_head - 1) & (SINC_QUEUE_LENGTH - 1);
-			acd->sinc_queue[acd->sinc_queue_head].time = acd->sinc_queue_time;
-			acd->sinc_queue[acd->sinc_queue_head].output = output - acd->sinc_output_state;
+			int head = (acd->sinc_queue_head - 1) & (SINC_QUEUE_LENGTH - 1);
+			acd->sinc_queue_head = head;
+			acd->sinc_queue_times[head] = acd->sinc_queue_time;
+			acd->sinc_queue_times[head + SINC_QUEUE_LENGTH] = acd->sinc_queue_time;
+			acd->sinc_queue_outputs[head] = output - acd->sinc_output_state;
+			acd->sinc_queue_outputs[head + SINC_QUEUE_LENGTH] = output - acd->sinc_output_state;
 			acd->sinc_output_state = output;
 		}
 
@@ -542,6 +548,95 @@ static void sinc_prehandler_paula (unsigned long best_evtime)
 	}
 }
 
+/* Reference BLEP mixer, one queue entry at a time. The result must stay
+ * identical to sinc_mix_blocked, and is used when sound_sinc_reference is
+ * set. */
+static int sinc_mix_reference (struct audio_channel_data *acd, int const *winsinc)
+{
+	int j;
+	/* The sum rings with harmonic components up to infinity... */
+	int sum = acd->sinc_output_state << 17;
+	/* ...but we cancel them through mixing in BLEPs instead */
+	int offsetpos = acd->sinc_queue_head & (SINC_QUEUE_LENGTH - 1);
+	for (j = 0; j < SINC_QUEUE_LENGTH; j += 1) {
+		int age = acd->sinc_queue_time - acd->sinc_queue_times[offsetpos];
+		if (age >= SINC_QUEUE_MAX_AGE || age < 0)
+			break;
+		sum -= winsinc[age] * acd->sinc_queue_outputs[offsetpos];
+		offsetpos = (offsetpos + 1) & (SINC_QUEUE_LENGTH - 1);
+	}
+	return sum;
+}
+
+/* Returns the number of queue entries (starting at the head) which are
+ * young enough to contribute to the output. SINC_QUEUE_MAX_AGE is a power
+ * of two, so an age is out of range (including negative) exactly when any
+ * bit above the low bits is set. */
+static int sinc_queue_active (const int *times, int now)
+{
+	int n = 0;
+#if defined(__SSE2__)
+	__m128i vnow = _mm_set1_epi32 (now);
+	__m128i zero = _mm_setzero_si128 ();
+	for (; n < SINC_QUEUE_LENGTH; n += 4) {
+		__m128i age = _mm_sub_epi32 (vnow, _mm_loadu_si128 ((const __m128i *) (times + n)));
+		__m128i high = _mm_andnot_si128 (_mm_set1_epi32 (SINC_QUEUE_MAX_AGE - 1), age);
+		int valid = _mm_movemask_ps (_mm_castsi128_ps (_mm_cmpeq_epi32 (high, zero)));
+		if (valid != 0xf) {
+			while (valid & 1) {
+				valid >>= 1;
+				n++;
+			}
+			return n;
+		}
+	}
+#else
+	for (; n < SINC_QUEUE_LENGTH; n++) {
+		if ((unsigned int) (now - times[n]) >= SINC_QUEUE_MAX_AGE)
+			break;
+	}
+#endif
+	return n;
+}
+
+/* Blocked BLEP mixer. The number of contributing entries is found first,
+ * and the entries are then summed in blocks of four without a data
+ * dependent branch per entry. All arithmetic wraps modulo 2^32, so the
+ * summation order does not change the result. */
+static int sinc_mix_blocked (struct audio_channel_data *acd, int const *winsinc)
+{
+	int head = acd->sinc_queue_head & (SINC_QUEUE_LENGTH - 1);
+	const int *times = acd->sinc_queue_times + head;
+	const int *outputs = acd->sinc_queue_outputs + head;
+	int now = acd->sinc_queue_time;
+	int n = sinc_queue_active (times, now);
+	uae_u32 sum = (uae_u32) acd->sinc_output_state << 17;
+	int j = 0;
+#if defined(__SSE2__)
+	__m128i acc = _mm_setzero_si128 ();
+	for (; j + 4 <= n; j += 4) {
+		__m128i w = _mm_set_epi32 (
+			winsinc[now - times[j + 3]], winsinc[now - times[j + 2]],
+			winsinc[now - times[j + 1]], winsinc[now - times[j + 0]]);
+		__m128i o = _mm_loadu_si128 ((const __m128i *) (outputs + j));
+		/* SSE2 has no 32-bit multiply keeping the low half, so multiply
+		 * even and odd lanes separately and interleave the results. */
+		__m128i even = _mm_mul_epu32 (w, o);
+		__m128i odd = _mm_mul_epu32 (_mm_srli_epi64 (w, 32), _mm_srli_epi64 (o, 32));
+		__m128i prod = _mm_unpacklo_epi32 (
+			_mm_shuffle_epi32 (even, _MM_SHUFFLE (0, 0, 2, 0)),
+			_mm_shuffle_epi32 (odd, _MM_SHUFFLE (0, 0, 2, 0)));
+		acc = _mm_add_epi32 (acc, prod);
+	}
+	acc = _mm_add_epi32 (acc, _mm_shuffle_epi32 (acc, _MM_SHUFFLE (1, 0, 3, 2)));
+	acc = _mm_add_epi32 (acc, _mm_shuffle_epi32 (acc, _MM_SHUFFLE (2, 3, 0, 1)));
+	sum -= (uae_u32) _mm_cvtsi128_si32 (acc);
+#endif
+	for (; j < n; j++)
+		sum -= (uae_u32) winsinc[now - times[j]] * (uae_u32) outputs[j];
+	return (int) sum;
+}
+
 /* this interpolator performs BLEP mixing (bleps are shaped like integrated sinc
 * functions) with a type of BLEP that matches the filtering configuration. */
 static void samplexx_sinc_handler (int *datasp, int ch_start, int ch_num)
@@ -558,28 +653,20 @@ static void samplexx_sinc_handler (int *datasp, int ch_start, int ch_num)
 	}
 	winsinc = winsinc_integral[n];
 
-
 	for (i = ch_start, k = 0; k < ch_num; i++, k++) {
-		int j, v;
+		int v, sum;
 		struct audio_channel_data *acd = &audio_channel[i];
-		/* The sum rings with harmonic components up to infinity... */
-		int sum = acd->sinc_output_state << 17;
-		/* ...but we cancel them through mixing in BLEPs instead */
-		int offsetpos = acd->sinc_queue_head & (SINC_QUEUE_LENGTH - 1);
-		for (j = 0; j < SINC_QUEUE_LENGTH; j += 1) {
-			int age = acd->sinc_queue_time - acd->sinc_queue[offsetpos].time;
-			if (age >= SINC_QUEUE_MAX_AGE || age < 0)
-				break;
-			sum -= winsinc[age] * acd->sinc_queue[offsetpos].output;
-			offsetpos = (offsetpos + 1) & (SINC_QUEUE_LENGTH - 1);
-		}
+		if (currprefs.sound_sinc_reference)
+			sum = sinc_mix_reference (acd, winsinc);
+		else
+			sum = sinc_mix_blocked (acd, winsinc);
 		v = sum >> 15;
 		if (v > 32767)
 			v = 32767;
 		else if (v < -32768)
 			v = -32768;
 		datasp[k] = v;
-    }
+	}
 }
 
 static void do_filter(int *data, int num)
@@ -1669,6 +1756,7 @@ static int sound_prefs_changed (void)
 		|| changed_prefs.sound_stereo_swap_paula != currprefs.sound_stereo_swap_paula
 		|| changed_prefs.sound_stereo_swap_ahi != currprefs.sound_stereo_swap_ahi
 		|| changed_prefs.sound_cdaudio != currprefs.sound_cdaudio
+		|| changed_prefs.sound_sinc_reference != currprefs.sound_sinc_reference
 		|| changed_prefs.sound_filter != currprefs.sound_filter
 		|| changed_prefs.sound_filter_type != currprefs.sound_filter_type)
 		return -1;
@@ -1756,6 +1844,7 @@ void set_audio (void)
 	currprefs.sound_cdaudio = changed_prefs.sound_cdaudio;
 	currprefs.sound_stereo_swap_paula = changed_prefs.sound_stereo_swap_paula;
 	currprefs.sound_stereo_swap_ahi = changed_prefs.sound_stereo_swap_ahi;
+	currprefs.sound_sinc_reference = changed_prefs.sound_sinc_reference;
 
 	sound_cd_volume[0] = sound_cd_volume[1] = (100 - (currprefs.sound_volume_cd < 0 ? 0 : currprefs.sound_volume_cd)) * 32768 / 100;
 	sound_paula_volume[0] = sound_paula_volume[1] = (100 - currprefs.sound_volume_paula) * 32768 / 100;
@@ -1938,6 +2027,10 @@ void update_audio (void)
 						extrasamples++;
 					}
 				}
+#endif
+#ifdef SAVESTATE
+				/* run-ahead frames are discarded, and so is their sound */
+				if (!savestate_runahead_ahead ())
 #endif
 				(*sample_handler) ();
 #if SOUNDSTUFF > 1
@@ -23,6 +23,9 @@
 #include "blit.h"
 #include "savestate.h"
 #include "debug.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // 1 = logging
 // 2 = no wait detection
@@ -447,15 +450,357 @@ STATIC_INLINE void chipmem_agnus_wput2 (uaecptr addr, uae_u32 w)
 	}
 }
 
+/* Wide-word engine for immediate/fast blits. Instead of one word per
+ * iteration through the chip memory handlers it works on whole rows:
+ * rows are fetched straight from chip RAM, A and B are shifted with the
+ * carry word of the previous row, the minterm is evaluated for any of
+ * the 256 functions in one pass (8 words at a time with SSE2) and fill
+ * mode propagates its carry with the same table as the word loop.
+ *
+ * The word loop writes D one word late, which matters only if D
+ * overlaps a source channel. The engine is therefore used only when
+ * every source is either disjoint from D or reads exactly what D
+ * writes (same pointer and modulo, rows not overlapping), and when all
+ * channels stay inside chip RAM. Everything else, and blits with the
+ * debugger's memory watch points active, take the word loop. With
+ * BLITWIDE_VERIFY the engine runs into a scratch buffer before every
+ * word loop blit and both results are compared, and a random blit
+ * self-test runs at the first blitter reset. */
+
+#define BLITWIDE 1
+#define BLITWIDE_VERIFY 0
+
+struct blitwide_result
+{
+	uae_u16 adat, bdat, cdat, ddat, bhold;
+	int fc;
+	bool zero;
+};
+
+static uae_u16 bw_a[BLITTER_MAX_WORDS + 1], bw_b[BLITTER_MAX_WORDS + 1];
+static uae_u16 bw_ah[BLITTER_MAX_WORDS], bw_bh[BLITTER_MAX_WORDS];
+static uae_u16 bw_c[BLITTER_MAX_WORDS], bw_d[BLITTER_MAX_WORDS];
+
+static void bw_read_row (uae_u16 *dst, uaecptr p, int h, int dir)
+{
+	uae_u8 *mem = chipmem_bank.baseaddr;
+	for (int i = 0; i < h; i++, p += dir)
+		dst[i] = do_get_mem_word ((uae_u16*)(mem + p));
+}
+
+static void bw_write_row (const uae_u16 *src, uaecptr p, int h, int dir)
+{
+	uae_u8 *mem = chipmem_bank.baseaddr;
+	for (int i = 0; i < h; i++, p += dir)
+		do_put_mem_word ((uae_u16*)(mem + p), src[i]);
+}
+
+static void bw_fill_row (uae_u16 *dst, uae_u16 v, int h)
+{
+	for (int i = 0; i < h; i++)
+		dst[i] = v;
+}
+
+/* in[-1] is the carry word from the previous row */
+static void bw_shift (uae_u16 *out, const uae_u16 *in, int h, int shift, bool desc)
+{
+	int i = 0;
+	if (!shift) {
+		memcpy (out, in, h * sizeof (uae_u16));
+		return;
+	}
+#ifdef __SSE2__
+	__m128i s1 = _mm_cvtsi32_si128 (shift);
+	__m128i s2 = _mm_cvtsi32_si128 (16 - shift);
+	for (; i + 8 <= h; i += 8) {
+		__m128i cur = _mm_loadu_si128 ((const __m128i*)(in + i));
+		__m128i prev = _mm_loadu_si128 ((const __m128i*)(in + i - 1));
+		__m128i v;
+		if (desc)
+			v = _mm_or_si128 (_mm_srl_epi16 (prev, s1), _mm_sll_epi16 (cur, s2));
+		else
+			v = _mm_or_si128 (_mm_srl_epi16 (cur, s1), _mm_sll_epi16 (prev, s2));
+		_mm_storeu_si128 ((__m128i*)(out + i), v);
+	}
+#endif
+	for (; i < h; i++) {
+		if (desc)
+			out[i] = (uae_u16)((((uae_u32)in[i] << 16) | in[i - 1]) >> shift);
+		else
+			out[i] = (uae_u16)((((uae_u32)in[i - 1] << 16) | in[i]) >> shift);
+	}
+}
+
+/* Minterm bit n selects the term with A = n & 4, B = n & 2, C = n & 1. */
+static void bw_minterm (uae_u16 *d, const uae_u16 *a, const uae_u16 *b, const uae_u16 *c, int h, uae_u8 mt)
+{
+	int i = 0;
+#ifdef __SSE2__
+	__m128i ones = _mm_set1_epi16 (-1);
+	for (; i + 8 <= h; i += 8) {
+		__m128i va = _mm_loadu_si128 ((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128 ((const __m128i*)(b + i));
+		__m128i vc = _mm_loadu_si128 ((const __m128i*)(c + i));
+		__m128i na = _mm_xor_si128 (va, ones);
+		__m128i nb = _mm_xor_si128 (vb, ones);
+		__m128i nc = _mm_xor_si128 (vc, ones);
+		__m128i v = _mm_setzero_si128 ();
+		for (int n = 0; n < 8; n++) {
+			if (!(mt & (1 << n)))
+				continue;
+			__m128i t = _mm_and_si128 (n & 4 ? va : na, n & 2 ? vb : nb);
+			v = _mm_or_si128 (v, _mm_and_si128 (t, n & 1 ? vc : nc));
+		}
+		_mm_storeu_si128 ((__m128i*)(d + i), v);
+	}
+#endif
+	for (; i < h; i++) {
+		uae_u32 va = a[i], vb = b[i], vc = c[i];
+		uae_u32 v = 0;
+		for (int n = 0; n < 8; n++) {
+			if (mt & (1 << n))
+				v |= (n & 4 ? va : ~va) & (n & 2 ? vb : ~vb) & (n & 1 ? vc : ~vc);
+		}
+		d[i] = (uae_u16)v;
+	}
+}
+
+static bool bw_range_ok (uaecptr p, int mod, int dir, uae_s64 *lo, uae_s64 *hi)
+{
+	int h2 = blt_info.hblitsize * 2;
+	uae_s64 last = (uae_s64)p + (uae_s64)dir * (blt_info.vblitsize - 1) * (h2 + mod);
+	uae_s64 a = p < last ? (uae_s64)p : last;
+	uae_s64 b = p < last ? last : (uae_s64)p;
+	if (dir > 0) {
+		*lo = a;
+		*hi = b + h2;
+	} else {
+		*lo = a - h2 + 2;
+		*hi = b + 2;
+	}
+	return *lo >= 0 && *hi <= (uae_s64)chipmem_bank.allocated - 2;
+}
+
+static bool blitwide_possible (bool desc, uaecptr pta, uaecptr ptb, uaecptr ptc, uaecptr ptd)
+{
+	int dir = desc ? -1 : 1;
+	uae_s64 dlo = 0, dhi = 0, lo, hi;
+	uaecptr ptr[3] = { pta, ptb, ptc };
+	int mod[3] = { blt_info.bltamod, blt_info.bltbmod, blt_info.bltcmod };
+
+	if (currprefs.z3chipmem_size || (log_blitter & 4))
+		return false;
+#ifdef DEBUGGER
+	if (memwatch_enabled)
+		return false;
+#endif
+	if (blt_info.hblitsize > BLITTER_MAX_WORDS)
+		return false;
+	if (ptd && !bw_range_ok (ptd, blt_info.bltdmod, dir, &dlo, &dhi))
+		return false;
+	for (int i = 0; i < 3; i++) {
+		if (!ptr[i])
+			continue;
+		if (!bw_range_ok (ptr[i], mod[i], dir, &lo, &hi))
+			return false;
+		if (!ptd || hi <= dlo || lo >= dhi)
+			continue;
+		if (ptr[i] == ptd && mod[i] == blt_info.bltdmod && mod[i] >= 0)
+			continue;
+		return false;
+	}
+	return true;
+}
+
+/* capture != NULL: D goes to capture instead of chip RAM */
+static void blitwide_run (bool desc, uaecptr pta, uaecptr ptb, uaecptr ptc, uaecptr ptd, uae_u16 *capture, struct blitwide_result *r)
+{
+	int h = blt_info.hblitsize;
+	int dir = desc ? -2 : 2;
+	int ashift = desc ? blt_info.blitdownashift : blt_info.blitashift;
+	int bshift = desc ? blt_info.blitdownbshift : blt_info.blitbshift;
+	uae_u8 mt = bltcon0 & 0xff;
+	int ifemode = blitife ? 2 : 0;
+	uae_u16 carrya = 0, carryb = 0;
+	uae_u16 dor = 0;
+	int fc = blitfc;
+
+	r->adat = blt_info.bltadat;
+	r->bdat = blt_info.bltbdat;
+	r->cdat = blt_info.bltcdat;
+	r->ddat = blt_info.bltddat;
+	r->bhold = blt_info.bltbhold;
+
+	if (!ptb)
+		bw_fill_row (bw_bh, r->bhold, h);
+	if (!ptc)
+		bw_fill_row (bw_c, r->cdat, h);
+
+	for (int j = 0; j < blt_info.vblitsize; j++) {
+		if (pta) {
+			bw_read_row (bw_a + 1, pta, h, dir);
+			r->adat = bw_a[h];
+			pta += dir * h + (desc ? -blt_info.bltamod : blt_info.bltamod);
+		} else {
+			bw_fill_row (bw_a + 1, r->adat, h);
+		}
+		bw_a[1] &= blt_info.bltafwm;
+		bw_a[h] &= blt_info.bltalwm;
+		bw_a[0] = carrya;
+		carrya = bw_a[h];
+		bw_shift (bw_ah, bw_a + 1, h, ashift, desc);
+
+		if (ptb) {
+			bw_read_row (bw_b + 1, ptb, h, dir);
+			r->bdat = bw_b[h];
+			bw_b[0] = carryb;
+			carryb = bw_b[h];
+			bw_shift (bw_bh, bw_b + 1, h, bshift, desc);
+			r->bhold = bw_bh[h - 1];
+			ptb += dir * h + (desc ? -blt_info.bltbmod : blt_info.bltbmod);
+		}
+
+		if (ptc) {
+			bw_read_row (bw_c, ptc, h, dir);
+			r->cdat = bw_c[h - 1];
+			/* the descending word loop also stores C in bltbdat */
+			if (desc)
+				r->bdat = r->cdat;
+			ptc += dir * h + (desc ? -blt_info.bltcmod : blt_info.bltcmod);
+		}
+
+		bw_minterm (bw_d, bw_ah, bw_bh, bw_c, h, mt);
+
+		fc = !!(bltcon1 & 0x4);
+		if (blitfill) {
+			for (int i = 0; i < h; i++) {
+				uae_u16 d = bw_d[i];
+				int fc1 = blit_filltable[d & 255][ifemode + fc][1];
+				bw_d[i] = blit_filltable[d & 255][ifemode + fc][0]
+					+ (blit_filltable[d >> 8][ifemode + fc1][0] << 8);
+				fc = blit_filltable[d >> 8][ifemode + fc1][1];
+			}
+		}
+		for (int i = 0; i < h; i++)
+			dor |= bw_d[i];
+		r->ddat = bw_d[h - 1];
+
+		if (ptd) {
+			if (capture) {
+				memcpy (capture, bw_d, h * sizeof (uae_u16));
+				capture += h;
+			} else {
+				bw_write_row (bw_d, ptd, h, dir);
+			}
+			ptd += dir * h + (desc ? -blt_info.bltdmod : blt_info.bltdmod);
+		}
+	}
+	r->fc = fc;
+	r->zero = dor == 0;
+}
+
+static void blitwide_apply (const struct blitwide_result *r)
+{
+	blt_info.bltadat = r->adat;
+	blt_info.bltbdat = r->bdat;
+	blt_info.bltcdat = r->cdat;
+	blt_info.bltddat = r->ddat;
+	blt_info.bltbhold = r->bhold;
+	if (!r->zero)
+		blt_info.blitzero = 0;
+	blitfc = r->fc;
+}
+
+#if BLITWIDE_VERIFY
+
+#define BLITWIDE_VERIFY_WORDS 65536
+
+static uae_u16 bw_capture[BLITWIDE_VERIFY_WORDS];
+static struct blitwide_result bw_verify_result;
+static uaecptr bw_verify_ptd;
+static bool bw_verify_desc, bw_verify_pending;
+static int bw_verify_zero;
+static int bw_verify_blits, bw_verify_failed;
+
+static void blitwide_verify (void)
+{
+	const struct blitwide_result *r = &bw_verify_result;
+	int h = blt_info.hblitsize;
+	int dir = bw_verify_desc ? -2 : 2;
+	int mod = bw_verify_desc ? -blt_info.bltdmod : blt_info.bltdmod;
+	uaecptr p = bw_verify_ptd;
+	int errors = 0;
+
+	if (!bw_verify_pending)
+		return;
+	bw_verify_pending = false;
+	bw_verify_blits++;
+	int vsize = blt_info.vblitsize;
+	int stride = dir * h + mod;
+	for (int j = 0; p && j < vsize; j++, p += mod) {
+		/* with a negative modulo, D rows can overlap and later rows win */
+		int lo = INT_MAX, hi = INT_MIN;
+		if (j < vsize - 1 && abs (stride) < 2 * h) {
+			int ends[4] = {
+				(int)bw_verify_ptd + (j + 1) * stride, (int)bw_verify_ptd + (j + 1) * stride + dir * (h - 1),
+				(int)bw_verify_ptd + (vsize - 1) * stride, (int)bw_verify_ptd + (vsize - 1) * stride + dir * (h - 1)
+			};
+			for (int k = 0; k < 4; k++) {
+				lo = ends[k] < lo ? ends[k] : lo;
+				hi = ends[k] > hi ? ends[k] : hi;
+			}
+		}
+		for (int i = 0; i < h; i++, p += dir) {
+			if ((int)p >= lo && (int)p <= hi)
+				continue;
+			uae_u16 v = chipmem_wget_indirect (p);
+			if (v != bw_capture[j * h + i] && errors++ < 4)
+				write_log (_T("BLITWIDE: D %08x row %d word %d: %04x != %04x\n"), p, j, i, bw_capture[j * h + i], v);
+		}
+	}
+	if (r->ddat != blt_info.bltddat || r->bhold != blt_info.bltbhold || r->fc != blitfc
+		|| r->adat != blt_info.bltadat || r->bdat != blt_info.bltbdat || r->cdat != blt_info.bltcdat
+		|| (r->zero ? bw_verify_zero : 0) != blt_info.blitzero) {
+		write_log (_T("BLITWIDE: state mismatch D=%04x/%04x BH=%04x/%04x FC=%d/%d Z=%d/%d\n"),
+			r->ddat, blt_info.bltddat, r->bhold, blt_info.bltbhold, r->fc, blitfc, r->zero, blt_info.blitzero);
+		errors++;
+	}
+	if (errors) {
+		write_log (_T("BLITWIDE: %dx%d %s blit CON0=%04x CON1=%04x: %d mismatches\n"),
+			h, blt_info.vblitsize, bw_verify_desc ? _T("desc") : _T("asc"), bltcon0, bltcon1, errors);
+		bw_verify_failed++;
+	}
+}
+#endif
+
+/* Returns true when the blit has been done by the wide engine. */
+static bool blitter_dofast_wide (bool desc, uaecptr pta, uaecptr ptb, uaecptr ptc, uaecptr ptd)
+{
+	if (!blitwide_possible (desc, pta, ptb, ptc, ptd))
+		return false;
+#if BLITWIDE_VERIFY
+	if (blt_info.hblitsize * blt_info.vblitsize <= BLITWIDE_VERIFY_WORDS) {
+		blitwide_run (desc, pta, ptb, ptc, ptd, bw_capture, &bw_verify_result);
+		bw_verify_ptd = ptd;
+		bw_verify_desc = desc;
+		bw_verify_zero = blt_info.blitzero;
+		bw_verify_pending = true;
+	}
+	return false;
+#else
+	struct blitwide_result r;
+	blitwide_run (desc, pta, ptb, ptc, ptd, NULL, &r);
+	blitwide_apply (&r);
+	return true;
+#endif
+}
+
 static void blitter_dofast (void)
 {
 	int i,j;
 	uaecptr bltadatptr = 0, bltbdatptr = 0, bltcdatptr = 0, bltddatptr = 0;
 	uae_u8 mt = bltcon0 & 0xFF;
 
-	blit_masktable[0] = blt_info.bltafwm;
-	blit_masktable[blt_info.hblitsize - 1] &= blt_info.bltalwm;
-
 	if (bltcon0 & 0x800) {
 		bltadatptr = bltapt;
 		bltapt += (blt_info.hblitsize * 2 + blt_info.bltamod) * blt_info.vblitsize;
@@ -473,6 +818,16 @@ static void blitter_dofast (void)
 		bltdpt += (blt_info.hblitsize * 2 + blt_info.bltdmod) * blt_info.vblitsize;
 	}
 
+#if BLITWIDE
+	if (blitter_dofast_wide (false, bltadatptr, bltbdatptr, bltcdatptr, bltddatptr)) {
+		bltstate = BLT_done;
+		return;
+	}
+#endif
+
+	blit_masktable[0] = blt_info.bltafwm;
+	blit_masktable[blt_info.hblitsize - 1] &= blt_info.bltalwm;
+
 #if SPEEDUP
 	if (blitfunc_dofast[mt] && !blitfill) {
 		(*blitfunc_dofast[mt])(bltadatptr, bltbdatptr, bltcdatptr, bltddatptr, &blt_info);
@@ -543,6 +898,9 @@ static void blitter_dofast (void)
 	}
 	blit_masktable[0] = 0xFFFF;
 	blit_masktable[blt_info.hblitsize - 1] = 0xFFFF;
+#if BLITWIDE_VERIFY
+	blitwide_verify ();
+#endif
 
 	bltstate = BLT_done;
 }
@@ -553,9 +911,6 @@ static void blitter_dofast_desc (void)
 	uaecptr bltadatptr = 0, bltbdatptr = 0, bltcdatptr = 0, bltddatptr = 0;
 	uae_u8 mt = bltcon0 & 0xFF;
 
-	blit_masktable[0] = blt_info.bltafwm;
-	blit_masktable[blt_info.hblitsize - 1] &= blt_info.bltalwm;
-
 	if (bltcon0 & 0x800) {
 		bltadatptr = bltapt;
 		bltapt -= (blt_info.hblitsize * 2 + blt_info.bltamod) * blt_info.vblitsize;
@@ -572,6 +927,16 @@ static void blitter_dofast_desc (void)
 		bltddatptr = bltdpt;
 		bltdpt -= (blt_info.hblitsize * 2 + blt_info.bltdmod) * blt_info.vblitsize;
 	}
+#if BLITWIDE
+	if (blitter_dofast_wide (true, bltadatptr, bltbdatptr, bltcdatptr, bltddatptr)) {
+		bltstate = BLT_done;
+		return;
+	}
+#endif
+
+	blit_masktable[0] = blt_info.bltafwm;
+	blit_masktable[blt_info.hblitsize - 1] &= blt_info.bltalwm;
+
 #if SPEEDUP
 	if (blitfunc_dofast_desc[mt] && !blitfill) {
 		(*blitfunc_dofast_desc[mt])(bltadatptr, bltbdatptr, bltcdatptr, bltddatptr, &blt_info);
@@ -642,6 +1007,9 @@ static void blitter_dofast_desc (void)
 	}
 	blit_masktable[0] = 0xFFFF;
 	blit_masktable[blt_info.hblitsize - 1] = 0xFFFF;
+#if BLITWIDE_VERIFY
+	blitwide_verify ();
+#endif
 
 	bltstate = BLT_done;
 }
@@ -1764,9 +2132,139 @@ void blitter_slowdown (int ddfstrt, int ddfstop, int totalcycles, int freecycles
 	blit_misscyclecounter += slow;
 }
 
+#if BLITWIDE_VERIFY
+
+/* Differential self-test: random immediate blits (any minterm, shifts,
+ * masks, modulos, fill modes, both directions, some of them in place)
+ * are done through blitter_dofast () and blitter_dofast_desc (), which
+ * compare the wide engine with the word loop. The chip RAM used and the
+ * blitter state are restored afterwards. */
+
+#define BLITWIDE_SELFTEST_BLITS 4000
+#define BLITWIDE_SELFTEST_SIZE 65536
+
+/* A channel spans at most 32 * (2 * 64 + 64) bytes in either direction */
+static uaecptr blitwide_selftest_ptr (void)
+{
+	uaecptr p = 8192 + (uaerand () % (BLITWIDE_SELFTEST_SIZE - 16384));
+	return p & ~1;
+}
+
+static void blitwide_selftest (void)
+{
+	uae_u8 *mem = chipmem_bank.baseaddr;
+	uae_u8 *save;
+	struct bltinfo blt_info_save = blt_info;
+	uae_u16 con0 = bltcon0, con1 = bltcon1;
+	uae_u32 apt = bltapt, bpt = bltbpt, cpt = bltcpt, dpt = bltdpt;
+	int fc = blitfc, fill = blitfill, ife = blitife;
+	enum blitter_states state = bltstate;
+
+	if (!mem || chipmem_bank.allocated < BLITWIDE_SELFTEST_SIZE)
+		return;
+	save = xmalloc (uae_u8, BLITWIDE_SELFTEST_SIZE);
+	memcpy (save, mem, BLITWIDE_SELFTEST_SIZE);
+	bw_verify_blits = bw_verify_failed = 0;
+
+	for (int n = 0; n < BLITWIDE_SELFTEST_BLITS; n++) {
+		for (int i = 0; i < BLITWIDE_SELFTEST_SIZE; i += 2)
+			do_put_mem_word ((uae_u16*)(mem + i), uaerand ());
+
+		int h = 1 + uaerand () % 64;
+		int v = 1 + uaerand () % 32;
+		bool desc = (uaerand () & 1) != 0;
+		int mods[4];
+		for (int i = 0; i < 4; i++)
+			mods[i] = ((int)(uaerand () % 65) - 32) * 2;
+
+		bltcon0 = uaerand () & 0xffff;
+		bltcon1 = (uaerand () & 0xf000) | (desc ? 2 : 0);
+		switch (uaerand () % 4)
+		{
+			case 1: bltcon1 |= 0x08; break;
+			case 2: bltcon1 |= 0x10; break;
+		}
+		if (uaerand () & 1)
+			bltcon1 |= 0x04;
+
+		blt_info.hblitsize = h;
+		blt_info.vblitsize = v;
+		blt_info.bltamod = mods[0];
+		blt_info.bltbmod = mods[1];
+		blt_info.bltcmod = mods[2];
+		blt_info.bltdmod = mods[3];
+		blt_info.bltafwm = uaerand ();
+		blt_info.bltalwm = uaerand ();
+		blt_info.bltadat = uaerand ();
+		blt_info.bltbdat = uaerand ();
+		blt_info.bltcdat = uaerand ();
+		blt_info.bltbhold = uaerand ();
+		blt_info.blitzero = 1;
+		blt_info.blitashift = bltcon0 >> 12;
+		blt_info.blitdownashift = 16 - blt_info.blitashift;
+		blt_info.blitbshift = bltcon1 >> 12;
+		blt_info.blitdownbshift = 16 - blt_info.blitbshift;
+		blitfill = !!(bltcon1 & 0x18);
+		blitife = !!(bltcon1 & 0x08);
+		blitfc = !!(bltcon1 & 0x04);
+
+		bltapt = blitwide_selftest_ptr ();
+		bltbpt = blitwide_selftest_ptr ();
+		bltcpt = blitwide_selftest_ptr ();
+		bltdpt = blitwide_selftest_ptr ();
+		/* in place blits, source reads what D writes */
+		switch (uaerand () % 4)
+		{
+			case 1:
+				bltapt = bltdpt;
+				blt_info.bltamod = blt_info.bltdmod;
+				break;
+			case 2:
+				bltbpt = bltdpt;
+				blt_info.bltbmod = blt_info.bltdmod;
+				break;
+			case 3:
+				bltcpt = bltdpt;
+				blt_info.bltcmod = blt_info.bltdmod;
+				break;
+		}
+
+		if (desc)
+			blitter_dofast_desc ();
+		else
+			blitter_dofast ();
+	}
+
+	write_log (_T("BLITWIDE: self-test %d blits, %d checked, %d failed\n"),
+		BLITWIDE_SELFTEST_BLITS, bw_verify_blits, bw_verify_failed);
+
+	memcpy (mem, save, BLITWIDE_SELFTEST_SIZE);
+	xfree (save);
+	blt_info = blt_info_save;
+	bltcon0 = con0;
+	bltcon1 = con1;
+	bltapt = apt;
+	bltbpt = bpt;
+	bltcpt = cpt;
+	bltdpt = dpt;
+	blitfc = fc;
+	blitfill = fill;
+	blitife = ife;
+	bltstate = state;
+}
+
+#endif
+
 void blitter_reset (void)
 {
 	bltptxpos = -1;
+#if BLITWIDE_VERIFY
+	static bool selftest_done;
+	if (!selftest_done) {
+		selftest_done = true;
+		blitwide_selftest ();
+	}
+#endif
 }
 
 #ifdef SAVESTATE
@@ -247,6 +247,7 @@ struct cl450_videoram
 	int width;
 	int height;
 	int depth;
+	uae_u64 pts;
 	uae_u8 data[CL450_VIDEO_BUFFER_SIZE];
 };
 static struct cl450_videoram *videoram;
@@ -271,8 +272,28 @@ static int cl450_video_hsync_wait;
 static int cl450_videoram_read;
 static int cl450_videoram_write;
 static int cl450_videoram_cnt;
+static int cl450_videoram_queue[CL450_VIDEO_BUFFERS];
 static int cl450_frame_cnt;
 
+/* MPEG decoding runs in its own thread. The emulation thread copies
+ * bitstream data to the decode buffer and queues it as packets, the
+ * decoder thread converts pictures directly into videoram slots and
+ * queues events (sequence, GOP and decoded frames) back. Free slots are
+ * returned to the decoder through a third pipe. */
+#define CL450_DECODE_PACKETS 4
+#define CL450_DECODE_QUIT 0xffffffff
+#define CL450_DECODE_RESET 0xfffffffe
+#define CL450_EVENT_SEQUENCE 1
+#define CL450_EVENT_GOP 2
+#define CL450_EVENT_FRAME 3
+static smp_comm_pipe cl450_packet_pipe;
+static smp_comm_pipe cl450_event_pipe;
+static smp_comm_pipe cl450_free_pipe;
+static uae_sem_t cl450_decoder_ack;
+static volatile int cl450_decoder_running;
+static volatile int cl450_decode_consumed;
+static int cl450_decode_fed;
+
 static uae_u16 l64111_regs[32];
 static uae_u16 l64111intmask[2], l64111intstatus[2];
 #define L64111_CHANNEL_BUFFERS 128
@@ -816,81 +837,295 @@ static void cl450_write_dram(int addr, uae_u16 w)
 static struct zfile *videodump;
 #endif
 
-static void cl450_parse_frame(void)
-{
 #ifdef WITH_LIBMPEG2
+
+/* Decoder thread state. A videoram slot can be reused only after
+ * libmpeg2 has discarded it and the emulation thread has displayed it
+ * (or the frame was dropped without being displayed). */
+#define CL450_SLOT_DECODER 1
+#define CL450_SLOT_DISPLAY 2
+static uae_u8 cl450_slot_busy[CL450_VIDEO_BUFFERS];
+static int cl450_slot_next;
+static bool cl450_decoder_aborting;
+
+static int cl450_decoder_find_slot(void)
+{
+	for (int i = 0; i < CL450_VIDEO_BUFFERS; i++) {
+		int slot = (cl450_slot_next + i) & (CL450_VIDEO_BUFFERS - 1);
+		if (!cl450_slot_busy[slot]) {
+			cl450_slot_next = (slot + 1) & (CL450_VIDEO_BUFFERS - 1);
+			return slot;
+		}
+	}
+	return -1;
+}
+
+/* Returns a free videoram slot, waiting for the emulation thread to
+ * release one if needed. Returns -1 if the decoder is being reset. */
+static int cl450_decoder_get_slot(void)
+{
+	for (;;) {
+		while (comm_pipe_has_data(&cl450_free_pipe)) {
+			int slot = read_comm_pipe_int_blocking(&cl450_free_pipe);
+			if (slot < 0)
+				return -1;
+			cl450_slot_busy[slot] &= ~CL450_SLOT_DISPLAY;
+		}
+		int slot = cl450_decoder_find_slot();
+		if (slot >= 0)
+			return slot;
+		slot = read_comm_pipe_int_blocking(&cl450_free_pipe);
+		if (slot < 0)
+			return -1;
+		cl450_slot_busy[slot] &= ~CL450_SLOT_DISPLAY;
+	}
+}
+
+static void cl450_decoder_reset(void)
+{
+	mpeg2_reset(mpeg_decoder, 1);
+	while (comm_pipe_has_data(&cl450_free_pipe))
+		read_comm_pipe_int_blocking(&cl450_free_pipe);
+	memset(cl450_slot_busy, 0, sizeof cl450_slot_busy);
+	cl450_slot_next = 0;
+	cl450_decoder_aborting = false;
+}
+
+static int cl450_fbuf_slot(const mpeg2_fbuf_t *fbuf)
+{
+	if (!fbuf || !fbuf->id)
+		return -1;
+	return (int)(uintptr_t)fbuf->id - 1;
+}
+
+/* Decodes until libmpeg2 needs more data */
+static void cl450_parse_packet(void)
+{
 	for (;;) {
 		mpeg2_state_t mpeg_state = mpeg2_parse(mpeg_decoder);
 		switch (mpeg_state)
 		{
 			case STATE_BUFFER:
+				return;
+			case STATE_SEQUENCE:
 			{
-				int bufsize = cl450_buffer_offset;
-				if (bufsize == 0)
+				int pixbytes = currprefs.color_mode != 5 ? 2 : 4;
+				int width = mpeg_info->sequence->width;
+				int height = mpeg_info->sequence->height;
+				mpeg2_convert(mpeg_decoder, pixbytes == 2 ? mpeg2convert_rgb16 : mpeg2convert_rgb32, NULL);
+				/* pictures which would not fit a videoram slot are not decoded */
+				mpeg2_skip(mpeg_decoder, width * height * pixbytes > CL450_VIDEO_BUFFER_SIZE);
+				write_comm_pipe_u32(&cl450_event_pipe, CL450_EVENT_SEQUENCE, 0);
+				write_comm_pipe_u32(&cl450_event_pipe, mpeg_info->sequence->frame_period ? 27000000 / mpeg_info->sequence->frame_period : 0, 0);
+				write_comm_pipe_u32(&cl450_event_pipe, width, 0);
+				write_comm_pipe_u32(&cl450_event_pipe, height, 0);
+				write_comm_pipe_u32(&cl450_event_pipe, pixbytes, 1);
+				break;
+			}
+			case STATE_PICTURE:
+			{
+				int slot = cl450_decoder_get_slot();
+				if (slot < 0) {
+					cl450_decoder_aborting = true;
 					return;
-				while (bufsize > 0 && cl450_newpacket_mode) {
-					struct cl450_newpacket *np = &cl450_newpacket_buffer[cl450_newpacket_offset_read];
-					if (cl450_newpacket_offset_read == cl450_newpacket_offset_write)
-						return;
-					int size = np->length > bufsize ? bufsize : np->length;
-
-					if (np->length == 0) {
-						write_log(_T("CL450 no matching newpacket!?\n"));
-						return;
-					}
-
-					np->length -= size;
-					bufsize -= size;
-					if (np->length > 0)
-						break;
-					//write_log(_T("CL450: NewPacket %d done\n"), cl450_newpacket_offset_read);
-					cl450_newpacket_offset_read++;
-					cl450_newpacket_offset_read &= CL450_NEWPACKET_BUFFER_SIZE - 1;
 				}
-#if DUMP_VIDEO
-				if (!videodump)
-					videodump = zfile_fopen(_T("c:\\temp\\1.mpg"), _T("wb"));
-				zfile_fwrite(&ram[CL450_MPEG_BUFFER], 1, cl450_buffer_offset, videodump);
-#endif
-				memcpy(&fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + libmpeg_offset, &fmv_ram_bank.baseaddr[CL450_MPEG_BUFFER], cl450_buffer_offset);
-				mpeg2_buffer(mpeg_decoder, &fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + libmpeg_offset, &fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + libmpeg_offset + cl450_buffer_offset);
-				libmpeg_offset += cl450_buffer_offset;
-				if (libmpeg_offset >= CL450_MPEG_DECODE_BUFFER_SIZE - CL450_MPEG_BUFFER_SIZE)
-					libmpeg_offset = 0;
-				cl450_buffer_offset = 0;
+				uint8_t *buf[3] = { videoram[slot].data, NULL, NULL };
+				mpeg2_set_buf(mpeg_decoder, buf, (void*)(uintptr_t)(slot + 1));
+				cl450_slot_busy[slot] = CL450_SLOT_DECODER;
+				break;
 			}
+			case STATE_GOP:
+				write_comm_pipe_u32(&cl450_event_pipe, CL450_EVENT_GOP, 0);
+				write_comm_pipe_u32(&cl450_event_pipe, (mpeg_info->gop->hours << 6) | (mpeg_info->gop->minutes), 0);
+				write_comm_pipe_u32(&cl450_event_pipe, (mpeg_info->gop->seconds << 6) | (mpeg_info->gop->pictures), 1);
+				break;
+			case STATE_SLICE:
+			case STATE_END:
+			case STATE_INVALID_END:
+			{
+				int slot = cl450_fbuf_slot(mpeg_info->display_fbuf);
+				if (slot >= 0) {
+					struct cl450_videoram *vr = &videoram[slot];
+					const mpeg2_picture_t *pic = mpeg_info->display_picture;
+					vr->width = mpeg_info->sequence->width;
+					vr->height = mpeg_info->sequence->height;
+					vr->depth = currprefs.color_mode != 5 ? 2 : 4;
+					vr->pts = 0;
+					if (pic && (pic->flags & PIC_FLAG_TAGS))
+						vr->pts = ((uae_u64)pic->tag << 32) | pic->tag2;
+					cl450_slot_busy[slot] |= CL450_SLOT_DISPLAY;
+					write_comm_pipe_u32(&cl450_event_pipe, CL450_EVENT_FRAME, 0);
+					write_comm_pipe_u32(&cl450_event_pipe, slot, 1);
+				}
+				slot = cl450_fbuf_slot(mpeg_info->discard_fbuf);
+				if (slot >= 0)
+					cl450_slot_busy[slot] &= ~CL450_SLOT_DECODER;
+				break;
+			}
+			default:
+				break;
+		}
+	}
+}
+
+static void *cl450_decoder_thread(void *v)
+{
+	cl450_decoder_reset();
+	cl450_decoder_running = 1;
+	uae_sem_post(&cl450_decoder_ack);
+	for (;;) {
+		uae_u32 cmd = read_comm_pipe_u32_blocking(&cl450_packet_pipe);
+		if (cmd == CL450_DECODE_QUIT)
 			break;
-			case STATE_SEQUENCE:
-				cl450_frame_pixbytes = currprefs.color_mode != 5 ? 2 : 4;
-				mpeg2_convert(mpeg_decoder, cl450_frame_pixbytes == 2 ? mpeg2convert_rgb16 : mpeg2convert_rgb32, NULL);
+		if (cmd == CL450_DECODE_RESET) {
+			cl450_decoder_reset();
+			uae_sem_post(&cl450_decoder_ack);
+			continue;
+		}
+		uae_u32 len = read_comm_pipe_u32_blocking(&cl450_packet_pipe);
+		uae_u32 pts_hi = read_comm_pipe_u32_blocking(&cl450_packet_pipe);
+		uae_u32 pts_lo = read_comm_pipe_u32_blocking(&cl450_packet_pipe);
+		if (!cl450_decoder_aborting) {
+			uae_u8 *p = &fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + cmd;
+			/* libmpeg2 attaches the tag to the first picture starting in this packet */
+			if (pts_hi || pts_lo)
+				mpeg2_tag_picture(mpeg_decoder, pts_hi, pts_lo);
+			mpeg2_buffer(mpeg_decoder, p, p + len);
+			cl450_parse_packet();
+		}
+		cl450_decode_consumed++;
+	}
+	cl450_decoder_running = 0;
+	uae_sem_post(&cl450_decoder_ack);
+	return NULL;
+}
+
+static void cl450_decoder_start(void)
+{
+	if (cl450_decoder_running)
+		return;
+	init_comm_pipe(&cl450_packet_pipe, CL450_DECODE_PACKETS * 4 + 8, 1);
+	init_comm_pipe(&cl450_event_pipe, 256, 1);
+	init_comm_pipe(&cl450_free_pipe, CL450_VIDEO_BUFFERS * 2, 1);
+	uae_sem_init(&cl450_decoder_ack, 0, 0);
+	cl450_decode_fed = cl450_decode_consumed = 0;
+	uae_start_thread(_T("cl450"), cl450_decoder_thread, NULL, NULL);
+	uae_sem_wait(&cl450_decoder_ack);
+}
+
+static void cl450_decoder_stop(void)
+{
+	if (!cl450_decoder_running)
+		return;
+	write_comm_pipe_int(&cl450_free_pipe, -1, 1);
+	write_comm_pipe_u32(&cl450_packet_pipe, CL450_DECODE_QUIT, 1);
+	uae_sem_wait(&cl450_decoder_ack);
+	destroy_comm_pipe(&cl450_packet_pipe);
+	destroy_comm_pipe(&cl450_event_pipe);
+	destroy_comm_pipe(&cl450_free_pipe);
+	uae_sem_destroy(&cl450_decoder_ack);
+}
+
+#endif
+
+/* Discards all queued bitstream data and decoded frames */
+static void cl450_decoder_flush(void)
+{
+#ifdef WITH_LIBMPEG2
+	if (cl450_decoder_running) {
+		/* wakes up the decoder if it waits for a free slot */
+		write_comm_pipe_int(&cl450_free_pipe, -1, 1);
+		write_comm_pipe_u32(&cl450_packet_pipe, CL450_DECODE_RESET, 1);
+		uae_sem_wait(&cl450_decoder_ack);
+		while (comm_pipe_has_data(&cl450_event_pipe))
+			read_comm_pipe_u32_blocking(&cl450_event_pipe);
+		cl450_decode_fed = cl450_decode_consumed = 0;
+	}
+#endif
+	libmpeg_offset = 0;
+	cl450_videoram_write = 0;
+	cl450_videoram_read = 0;
+	cl450_videoram_cnt = 0;
+}
+
+/* Moves the bitstream data written by the CPU to the decode buffer and
+ * queues it for the decoder thread. */
+static void cl450_feed_decoder(void)
+{
+#ifdef WITH_LIBMPEG2
+	int bufsize = cl450_buffer_offset;
+	uae_u64 pts = 0;
+	if (bufsize == 0)
+		return;
+	while (bufsize > 0 && cl450_newpacket_mode) {
+		struct cl450_newpacket *np = &cl450_newpacket_buffer[cl450_newpacket_offset_read];
+		if (cl450_newpacket_offset_read == cl450_newpacket_offset_write)
+			return;
+		int size = np->length > bufsize ? bufsize : np->length;
+
+		if (np->length == 0) {
+			write_log(_T("CL450 no matching newpacket!?\n"));
+			return;
+		}
+		if (np->pts_valid && !pts)
+			pts = np->pts;
+
+		np->length -= size;
+		bufsize -= size;
+		if (np->length > 0)
+			break;
+		//write_log(_T("CL450: NewPacket %d done\n"), cl450_newpacket_offset_read);
+		cl450_newpacket_offset_read++;
+		cl450_newpacket_offset_read &= CL450_NEWPACKET_BUFFER_SIZE - 1;
+	}
+#if DUMP_VIDEO
+	if (!videodump)
+		videodump = zfile_fopen(_T("c:\\temp\\1.mpg"), _T("wb"));
+	zfile_fwrite(&ram[CL450_MPEG_BUFFER], 1, cl450_buffer_offset, videodump);
+#endif
+	/* At most CL450_DECODE_PACKETS packets are in flight, so data still
+	 * being decoded is never overwritten. */
+	memcpy(&fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + libmpeg_offset, &fmv_ram_bank.baseaddr[CL450_MPEG_BUFFER], cl450_buffer_offset);
+	write_comm_pipe_u32(&cl450_packet_pipe, libmpeg_offset, 0);
+	write_comm_pipe_u32(&cl450_packet_pipe, cl450_buffer_offset, 0);
+	write_comm_pipe_u32(&cl450_packet_pipe, (uae_u32)(pts >> 32), 0);
+	write_comm_pipe_u32(&cl450_packet_pipe, (uae_u32)pts, 1);
+	cl450_decode_fed++;
+	libmpeg_offset += cl450_buffer_offset;
+	if (libmpeg_offset >= CL450_MPEG_DECODE_BUFFER_SIZE - CL450_MPEG_BUFFER_SIZE)
+		libmpeg_offset = 0;
+	cl450_buffer_offset = 0;
+#endif
+}
+
+/* Handles events queued by the decoder thread */
+static void cl450_decoder_events(void)
+{
+#ifdef WITH_LIBMPEG2
+	while (comm_pipe_has_data(&cl450_event_pipe)) {
+		uae_u32 type = read_comm_pipe_u32_blocking(&cl450_event_pipe);
+		switch (type)
+		{
+			case CL450_EVENT_SEQUENCE:
+				cl450_frame_rate = read_comm_pipe_u32_blocking(&cl450_event_pipe);
+				cl450_frame_width = read_comm_pipe_u32_blocking(&cl450_event_pipe);
+				cl450_frame_height = read_comm_pipe_u32_blocking(&cl450_event_pipe);
+				cl450_frame_pixbytes = read_comm_pipe_u32_blocking(&cl450_event_pipe);
 				cl450_set_status(CL_INT_SEQ_V);
-				cl450_frame_rate = mpeg_info->sequence->frame_period ? 27000000 / mpeg_info->sequence->frame_period : 0;
-				cl450_frame_width = mpeg_info->sequence->width;
-				cl450_frame_height = mpeg_info->sequence->height;
 				cl450_write_dram(CL_DRAM_PICTURE_RATE, cl450_frame_rate);
 				cl450_write_dram(CL_DRAM_H_SIZE, cl450_frame_width);
 				cl450_write_dram(CL_DRAM_V_SIZE, cl450_frame_height);
 				break;
-			case STATE_PICTURE:
+			case CL450_EVENT_GOP:
+				cl450_write_dram(CL_DRAM_TIME_CODE_0, read_comm_pipe_u32_blocking(&cl450_event_pipe));
+				cl450_write_dram(CL_DRAM_TIME_CODE_1, read_comm_pipe_u32_blocking(&cl450_event_pipe));
 				break;
-			case STATE_GOP:
-				cl450_write_dram(CL_DRAM_TIME_CODE_0, (mpeg_info->gop->hours << 6) | (mpeg_info->gop->minutes));
-				cl450_write_dram(CL_DRAM_TIME_CODE_1, (mpeg_info->gop->seconds << 6) | (mpeg_info->gop->pictures));
-				break;
-			case STATE_SLICE:
-			case STATE_END:
-				if (mpeg_info->display_fbuf) {
-					memcpy(videoram[cl450_videoram_write].data, mpeg_info->display_fbuf->buf[0], cl450_frame_width * cl450_frame_height * cl450_frame_pixbytes);
-					videoram[cl450_videoram_write].width = cl450_frame_width;
-					videoram[cl450_videoram_write].height = cl450_frame_height;
-					videoram[cl450_videoram_write].depth = cl450_frame_pixbytes;
-					cl450_videoram_write++;
-					cl450_videoram_write &= CL450_VIDEO_BUFFERS - 1;
-					cl450_videoram_cnt++;
-					//write_log(_T("%d\n"), cl450_videoram_cnt);
-				}
-				return;
-			default:
+			case CL450_EVENT_FRAME:
+				cl450_videoram_queue[cl450_videoram_write] = read_comm_pipe_u32_blocking(&cl450_event_pipe);
+				cl450_videoram_write++;
+				cl450_videoram_write &= CL450_VIDEO_BUFFERS - 1;
+				cl450_videoram_cnt++;
+				//write_log(_T("%d\n"), cl450_videoram_cnt);
 				break;
 		}
 	}
@@ -907,18 +1142,11 @@ static void cl450_reset(void)
 	cl450_threshold = 4096;
 	cl450_buffer_offset = 0;
 	cl450_buffer_empty_cnt = 0;
-	libmpeg_offset = 0;
 	cl450_newpacket_mode = false;
 	cl450_newpacket_offset_write = 0;
 	cl450_newpacket_offset_read = 0;
-	cl450_videoram_write = 0;
-	cl450_videoram_read = 0;
-	cl450_videoram_cnt = 0;
 	memset(cl450_regs, 0, sizeof cl450_regs);
-#ifdef WITH_LIBMPEG2
-	if (mpeg_decoder)
-		mpeg2_reset(mpeg_decoder, 1);
-#endif
+	cl450_decoder_flush();
 	if (fmv_ram_bank.baseaddr) {
 		memset(fmv_ram_bank.baseaddr, 0, 0x100);
 		write_log(_T("CL450 reset\n"));
@@ -1480,6 +1708,18 @@ static void cd32_fmv_audio_handler(void)
 	l64111_regs[A_CB_STATUS] -= PCM_SECTORS;
 }
 
+/* Frames with a PTS are held back until the system clock reaches it.
+ * PTS more than a second ahead means the clock was not set, those and
+ * untagged frames are shown on the next picture period. */
+static bool cl450_frame_due(int slot)
+{
+	uae_u64 pts = videoram[slot].pts;
+	if (!pts || cl450_play <= 0)
+		return true;
+	uae_s64 ahead = (uae_s64)(pts - (uae_u64)cl450_scr);
+	return ahead <= 0 || ahead > 90000;
+}
+
 void cd32_fmv_hsync_handler(void)
 {
 	if (!fmv_ram_bank.baseaddr)
@@ -1490,14 +1730,20 @@ void cd32_fmv_hsync_handler(void)
 
 	if (cl450_video_hsync_wait > 0)
 		cl450_video_hsync_wait--;
+	cl450_decoder_events();
+
 	if (cl450_video_hsync_wait == 0) {
 		cl450_set_status(CL_INT_PIC_D);
-		if (cl450_videoram_cnt > 0) {
-			cd32_fmv_new_image(videoram[cl450_videoram_read].width, videoram[cl450_videoram_read].height, 
-				videoram[cl450_videoram_read].depth, cl450_blank ? NULL : videoram[cl450_videoram_read].data);
+		if (cl450_videoram_cnt > 0 && cl450_frame_due(cl450_videoram_queue[cl450_videoram_read])) {
+			int slot = cl450_videoram_queue[cl450_videoram_read];
+			cd32_fmv_new_image(videoram[slot].width, videoram[slot].height,
+				videoram[slot].depth, cl450_blank ? NULL : videoram[slot].data);
 			cl450_videoram_read++;
 			cl450_videoram_read &= CL450_VIDEO_BUFFERS - 1;
 			cl450_videoram_cnt--;
+#ifdef WITH_LIBMPEG2
+			write_comm_pipe_int(&cl450_free_pipe, slot, 1);
+#endif
 		}
 		cl450_video_hsync_wait = max_sync_vpos;
 		while (remaining_sync_vpos >= 1.0) {
@@ -1524,8 +1770,9 @@ void cd32_fmv_hsync_handler(void)
 				cl450_set_status(CL_INT_RDY);
 		}
 
-		if (cl450_buffer_offset >= 512 && cl450_videoram_cnt < CL450_VIDEO_BUFFERS - 1) {
-			cl450_parse_frame();
+		if (cl450_buffer_offset >= 512 && cl450_videoram_cnt < CL450_VIDEO_BUFFERS - 1 &&
+			cl450_decode_fed - cl450_decode_consumed < CL450_DECODE_PACKETS) {
+			cl450_feed_decoder();
 		}
 	}
 }
@@ -1533,6 +1780,7 @@ void cd32_fmv_hsync_handler(void)
 
 void cd32_fmv_reset(void)
 {
+	cl450_decoder_flush();
 	if (fmv_ram_bank.baseaddr)
 		memset(fmv_ram_bank.baseaddr, 0, fmv_ram_bank.allocated);
 	cd32_fmv_state(0);
@@ -1540,6 +1788,9 @@ void cd32_fmv_reset(void)
 
 void cd32_fmv_free(void)
 {
+#ifdef WITH_LIBMPEG2
+	cl450_decoder_stop();
+#endif
 	mapped_free(&fmv_rom_bank);
 	mapped_free(&fmv_ram_bank);
 	xfree(audioram);
@@ -1625,7 +1876,9 @@ addrbank *cd32_fmv_init (uaecptr start)
 	if (!mpeg_decoder) {
 		mpeg_decoder = mpeg2_init();
 		mpeg_info = mpeg2_info(mpeg_decoder);
+		mpeg2_custom_fbuf(mpeg_decoder, 1);
 	}
+	cl450_decoder_start();
 #endif
 	fmv_bank.mask = fmv_board_size - 1;
 	map_banks(&fmv_rom_bank, (fmv_start + ROM_BASE) >> 16, fmv_rom_size >> 16, 0);
@@ -1388,6 +1388,8 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 		cfgfile_write_str (f, _T("statefile"), p->statefile);
 	if (p->quitstatefile[0])
 		cfgfile_write_str (f, _T("statefile_quit"), p->quitstatefile);
+	if (p->cpuharnessfile[0])
+		cfgfile_write_str (f, _T("cpu_harness"), p->cpuharnessfile);
 
 	cfgfile_write (f, _T("nr_floppies"), _T("%d"), p->nr_floppies);
 	cfgfile_dwrite_bool (f, _T("floppy_write_protect"), p->floppy_read_only);
@@ -1423,6 +1425,7 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 	cfgfile_write_bool (f, _T("sound_cdaudio"), p->sound_cdaudio);
 	cfgfile_write_bool (f, _T("sound_stereo_swap_paula"), p->sound_stereo_swap_paula);
 	cfgfile_write_bool (f, _T("sound_stereo_swap_ahi"), p->sound_stereo_swap_ahi);
+	cfgfile_dwrite_bool (f, _T("sound_sinc_reference"), p->sound_sinc_reference);
 	cfgfile_dwrite (f, _T("sampler_frequency"), _T("%d"), p->sampler_freq);
 	cfgfile_dwrite (f, _T("sampler_buffer"), _T("%d"), p->sampler_buffer);
 	cfgfile_dwrite_bool (f, _T("sampler_stereo"), p->sampler_stereo);
@@ -1434,6 +1437,9 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 	cfgfile_write_bool (f, _T("comp_nf"), p->compnf);
 	cfgfile_write_bool (f, _T("comp_constjump"), p->comp_constjump);
 	cfgfile_write_str (f, _T("comp_flushmode"), flushmode[p->comp_hardflush]);
+	cfgfile_dwrite_bool (f, _T("comp_stats"), p->comp_stats);
+	cfgfile_dwrite_bool (f, _T("comp_perfmap"), p->comp_perfmap);
+	cfgfile_dwrite_bool (f, _T("comp_fpu_sse2"), p->comp_fpu_sse2);
 #ifdef USE_JIT_FPU
 	cfgfile_write_bool (f, _T("compfpu"), p->compfpu);
 #endif
@@ -1867,6 +1873,7 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 	}
 	cfgfile_write (f, _T("cpu_throttle"), _T("%.1f"), p->m68k_speed_throttle);
 	cfgfile_dwrite(f, _T("cpu_x86_throttle"), _T("%.1f"), p->x86_speed_throttle);
+	cfgfile_dwrite(f, _T("cpu_x86_thread"), _T("%d"), p->x86_thread_quantum);
 
 	/* do not reorder start */
 	write_compatibility_cpu(f, p);
@@ -1938,6 +1945,7 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 
 	cfgfile_dwrite (f, _T("state_replay_rate"), _T("%d"), p->statecapturerate);
 	cfgfile_dwrite (f, _T("state_replay_buffers"), _T("%d"), p->statecapturebuffersize);
+	cfgfile_dwrite (f, _T("runahead"), _T("%d"), p->runahead);
 	cfgfile_dwrite_bool (f, _T("state_replay_autoplay"), p->inprec_autoplay);
 	cfgfile_dwrite_bool (f, _T("warp"), p->turbo_emulation);
 	cfgfile_dwrite (f, _T("warp_limit"), _T("%d"), p->turbo_emulation_limit);
@@ -1957,6 +1965,7 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 #endif
 
 	cfgfile_dwrite(f, _T("uaeboard_mode"),  _T("%d"), p->uaeboard);
+	cfgfile_dwrite(f, _T("hardfile_cache_size"), _T("%d"), p->hardfile_cache_size);
 
 	write_inputdevice_config (p, f);
 }
@@ -2533,6 +2542,7 @@ static int cfgfile_parse_host (struct uae_prefs *p, TCHAR *option, TCHAR *value)
 		|| cfgfile_intval (option, value, _T("sound_max_buff"), &p->sound_maxbsiz, 1)
 		|| cfgfile_intval (option, value, _T("state_replay_rate"), &p->statecapturerate, 1)
 		|| cfgfile_intval (option, value, _T("state_replay_buffers"), &p->statecapturebuffersize, 1)
+		|| cfgfile_intval (option, value, _T("runahead"), &p->runahead, 1)
 		|| cfgfile_yesno (option, value, _T("state_replay_autoplay"), &p->inprec_autoplay)
 		|| cfgfile_intval (option, value, _T("sound_frequency"), &p->sound_freq, 1)
 		|| cfgfile_intval (option, value, _T("sound_volume"), &p->sound_volume_master, 1)
@@ -2613,6 +2623,7 @@ static int cfgfile_parse_host (struct uae_prefs *p, TCHAR *option, TCHAR *value)
 		|| cfgfile_yesno(option, value, _T("sound_cdaudio"), &p->sound_cdaudio)
 		|| cfgfile_yesno(option, value, _T("sound_stereo_swap_paula"), &p->sound_stereo_swap_paula)
 		|| cfgfile_yesno(option, value, _T("sound_stereo_swap_ahi"), &p->sound_stereo_swap_ahi)
+		|| cfgfile_yesno(option, value, _T("sound_sinc_reference"), &p->sound_sinc_reference)
 		|| cfgfile_yesno(option, value, _T("log_illegal_mem"), &p->illegal_mem)
 		|| cfgfile_yesno(option, value, _T("filesys_no_fsdb"), &p->filesys_no_uaefsdb)
 		|| cfgfile_yesno(option, value, _T("gfx_blacker_than_black"), &p->gfx_blackerthanblack)
@@ -3104,6 +3115,9 @@ static int cfgfile_parse_host (struct uae_prefs *p, TCHAR *option, TCHAR *value)
 		return 1;
 	}
 
+	if (cfgfile_path (option, value, _T("cpu_harness"), p->cpuharnessfile, sizeof p->cpuharnessfile / sizeof (TCHAR)))
+		return 1;
+
 #ifdef SAVESTATE
 
 	if (cfgfile_path (option, value, _T("statefile_quit"), p->quitstatefile, sizeof p->quitstatefile / sizeof (TCHAR)))
@@ -4395,6 +4409,9 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
 		|| cfgfile_yesno (option, value, _T("fpu_softfloat"), &p->fpu_softfloat)
 		|| cfgfile_yesno (option, value, _T("comp_nf"), &p->compnf)
 		|| cfgfile_yesno (option, value, _T("comp_constjump"), &p->comp_constjump)
+		|| cfgfile_yesno (option, value, _T("comp_stats"), &p->comp_stats)
+		|| cfgfile_yesno (option, value, _T("comp_perfmap"), &p->comp_perfmap)
+		|| cfgfile_yesno (option, value, _T("comp_fpu_sse2"), &p->comp_fpu_sse2)
 #ifdef USE_JIT_FPU
 		|| cfgfile_yesno (option, value, _T("compfpu"), &p->compfpu)
 #endif
@@ -4466,6 +4483,7 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
 		|| cfgfile_intval(option, value, _T("kickstart_ext_rom_file2addr"), &p->romextfile2addr, 1)
 		|| cfgfile_intval(option, value, _T("genlock_mix"), &p->genlock_mix, 1)
 		|| cfgfile_intval(option, value, _T("uaeboard_mode"), &p->uaeboard, 1)
+		|| cfgfile_intval(option, value, _T("hardfile_cache_size"), &p->hardfile_cache_size, 1)
 		|| cfgfile_intval (option, value, _T("catweasel"), &p->catweasel, 1))
 		return 1;
 
@@ -4707,6 +4725,11 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
 	if (cfgfile_doubleval(option, value, _T("cpu_x86_throttle"), &p->x86_speed_throttle)) {
 		return 1;
 	}
+	if (cfgfile_intval(option, value, _T("cpu_x86_thread"), &p->x86_thread_quantum, 1)) {
+		if (p->x86_thread_quantum < 0)
+			p->x86_thread_quantum = 0;
+		return 1;
+	}
 	if (cfgfile_intval (option, value, _T("finegrain_cpu_speed"), &p->m68k_speed, 1)) {
 		if (OFFICIAL_CYCLE_UNIT > CYCLE_UNIT) {
 			int factor = OFFICIAL_CYCLE_UNIT / CYCLE_UNIT;
@@ -6168,6 +6191,7 @@ void default_prefs (struct uae_prefs *p, int type)
 	p->sound_filter_type = 0;
 	p->sound_auto = 1;
 	p->sound_cdaudio = false;
+	p->sound_sinc_reference = false;
 	p->sampler_stereo = false;
 	p->sampler_buffer = 0;
 	p->sampler_freq = 0;
@@ -6179,6 +6203,9 @@ void default_prefs (struct uae_prefs *p, int type)
 	p->compnf = 1;
 	p->comp_hardflush = 0;
 	p->comp_constjump = 1;
+	p->comp_stats = 0;
+	p->comp_perfmap = 0;
+	p->comp_fpu_sse2 = 0;
 #ifdef USE_JIT_FPU
 	p->compfpu = 1;
 #else
@@ -6237,6 +6264,7 @@ void default_prefs (struct uae_prefs *p, int type)
 	p->boot_rom = 0;
 	p->filesys_no_uaefsdb = 0;
 	p->filesys_custom_uaefsdb = 1;
+	p->hardfile_cache_size = 8;
 	p->picasso96_nocustom = 1;
 	p->cart_internal = 1;
 	p->sana2 = 0;
@@ -6316,6 +6344,7 @@ void default_prefs (struct uae_prefs *p, int type)
 	p->fpu_model = 0;
 	p->cpu_model = 68000;
 	p->m68k_speed_throttle = 0;
+	p->x86_thread_quantum = 0;
 	p->cpu_clock_multiplier = 0;
 	p->cpu_frequency = 0;
 	p->mmu_model = 0;
@@ -6377,6 +6406,7 @@ void default_prefs (struct uae_prefs *p, int type)
 
 	p->statecapturebuffersize = 100;
 	p->statecapturerate = 5 * 50;
+	p->runahead = 0;
 	p->inprec_autoplay = true;
 
 #ifdef UAE_MINI
@@ -0,0 +1,487 @@
+/*
+* UAE - The Un*x Amiga Emulator
+*
+* CPU core harness: instruction streams run on every core variant of the
+* configured CPU, results compared against the fast core and throughput
+* measured per opcode class.
+*
+*/
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include "options.h"
+#include "uae/memory.h"
+#include "uae/time.h"
+#include "uae/io.h"
+#include "events.h"
+#include "newcpu.h"
+#include "readcpu.h"
+#include "cpuharness.h"
+
+/* Chip RAM layout. Every exception vector points to a STOP instruction,
+ * so exceptions end the stream like the STOP appended to the stream does.
+ * Extension words are generated in the range 0x1000-0x7ffe, so absolute
+ * short addresses and 16-bit displacements from the address registers
+ * (0x3000-0x5ffc) always land in the data area. */
+#define HARNESS_EXCEPTION 0x000400
+#define HARNESS_DATA 0x001000
+#define HARNESS_DATA_SIZE 0x013000
+#define HARNESS_CODE 0x040000
+#define HARNESS_CHIPMEM 0x080000
+
+#define HARNESS_INSNS 64
+#define HARNESS_MAX_WORDS (HARNESS_INSNS * 5 + 2)
+#define HARNESS_STREAMS 32
+#define HARNESS_ATTEMPTS 50
+#define HARNESS_MAX_STEPS 100000
+#define HARNESS_RANDOM_REPEAT 2000
+#define HARNESS_CURATED_REPEAT 200
+#define HARNESS_MAX_MISMATCHES 100
+
+enum {
+	CLASS_MOVE, CLASS_ALU, CLASS_SHIFT, CLASS_MULDIV, CLASS_BIT, CLASS_BCD,
+	CLASS_MIXED, RANDOM_CLASSES
+};
+
+struct harness_state
+{
+	uae_u32 regs[16];
+	uae_u32 pc;
+	uae_u16 sr;
+	uae_u32 datahash;
+};
+
+struct harness_stream
+{
+	uae_u16 code[HARNESS_MAX_WORDS];
+	int words;
+	int insns;
+	uae_u32 regs[16];
+	struct harness_state expected;
+};
+
+struct harness_class
+{
+	const TCHAR *name;
+	/* curated streams: opcode words, terminated by the final STOP */
+	const uae_u16 *curated;
+	int curated_words;
+	struct harness_stream *streams;
+	int nstreams;
+	int repeat;
+};
+
+struct harness_variant
+{
+	const TCHAR *name;
+	bool compatible;
+	bool cycle_exact;
+	bool mmu;
+	bool jit;
+};
+
+struct harness_result
+{
+	uae_u64 insns;
+	uae_u64 time;
+	int mismatches;
+	int failures;
+};
+
+/* MOVE.W #255,D0 / MOVE.L (A0)+,(A1)+ / DBRA D0 */
+static const uae_u16 curated_copy[] = {
+	0x41f8, 0x2000, 0x43f8, 0x4000, 0x303c, 0x00ff,
+	0x22d8, 0x51c8, 0xfffc,
+	0x4e72, 0x2700
+};
+/* ADD.L (A0)+,D1 / ROL.L #1,D1 */
+static const uae_u16 curated_checksum[] = {
+	0x41f8, 0x2000, 0x303c, 0x00ff, 0x7200,
+	0xd298, 0xe399, 0x51c8, 0xfffa,
+	0x4e72, 0x2700
+};
+/* MOVE.L D1,D2 / MULU.W D1,D2 / DIVU.W D3,D2 / ADD.L D2,D1 */
+static const uae_u16 curated_muldiv[] = {
+	0x303c, 0x00ff, 0x7607, 0x727b,
+	0x2401, 0xc4c1, 0x84c3, 0xd282, 0x51c8, 0xfff6,
+	0x4e72, 0x2700
+};
+/* LSL.L #3,D1 / ROR.L D3,D4 / EOR.L D1,D4 */
+static const uae_u16 curated_shift[] = {
+	0x303c, 0x00ff, 0x7605, 0x7201,
+	0xe789, 0xe6bc, 0xb384, 0x51c8, 0xfff8,
+	0x4e72, 0x2700
+};
+
+static struct harness_class harness_classes[] = {
+	{ _T("move") },
+	{ _T("alu") },
+	{ _T("shift") },
+	{ _T("muldiv") },
+	{ _T("bit") },
+	{ _T("bcd") },
+	{ _T("mixed") },
+	{ _T("copy-loop"), curated_copy, sizeof curated_copy / sizeof (uae_u16) },
+	{ _T("checksum-loop"), curated_checksum, sizeof curated_checksum / sizeof (uae_u16) },
+	{ _T("muldiv-loop"), curated_muldiv, sizeof curated_muldiv / sizeof (uae_u16) },
+	{ _T("shift-loop"), curated_shift, sizeof curated_shift / sizeof (uae_u16) },
+};
+#define HARNESS_CLASSES ((int)(sizeof harness_classes / sizeof (struct harness_class)))
+
+static uae_u32 harness_seed;
+static uae_u16 *harness_pool[RANDOM_CLASSES];
+static int harness_poolsize[RANDOM_CLASSES];
+static uae_u8 *harness_data;
+static FILE *harness_report;
+static int harness_reported;
+
+static uae_u32 harness_rand (void)
+{
+	/* xorshift32, the streams must not depend on uaerand () */
+	harness_seed ^= harness_seed << 13;
+	harness_seed ^= harness_seed >> 17;
+	harness_seed ^= harness_seed << 5;
+	return harness_seed;
+}
+
+static int harness_class_of (int mnemo)
+{
+	switch (mnemo)
+	{
+	case i_MOVE: case i_MVPRM: case i_MVPMR: case i_MVMLE: case i_CLR:
+	case i_SWAP: case i_EXT: case i_Scc: case i_PEA: case i_MVSR2:
+	case i_MV2SR: case i_NOP: case i_TST:
+		return CLASS_MOVE;
+	case i_OR: case i_AND: case i_EOR: case i_SUB: case i_SUBX: case i_ADD:
+	case i_ADDX: case i_NEG: case i_NEGX: case i_NOT: case i_CMP: case i_CMPM:
+	case i_CMPA: case i_CAS:
+		return CLASS_ALU;
+	case i_ASR: case i_ASL: case i_LSR: case i_LSL: case i_ROL: case i_ROR:
+	case i_ROXL: case i_ROXR: case i_ASRW: case i_ASLW: case i_LSRW:
+	case i_LSLW: case i_ROLW: case i_RORW: case i_ROXLW: case i_ROXRW:
+		return CLASS_SHIFT;
+	case i_MULU: case i_MULS: case i_DIVU: case i_DIVS: case i_MULL: case i_DIVL:
+		return CLASS_MULDIV;
+	case i_BTST: case i_BCHG: case i_BCLR: case i_BSET: case i_TAS:
+	case i_BFTST: case i_BFEXTU: case i_BFCHG: case i_BFEXTS: case i_BFCLR:
+	case i_BFFFO: case i_BFSET: case i_BFINS:
+		return CLASS_BIT;
+	case i_ABCD: case i_SBCD: case i_NBCD: case i_PACK: case i_UNPK:
+		return CLASS_BCD;
+	}
+	return -1;
+}
+
+static bool harness_mode_ok (int mode)
+{
+	/* index registers and 32-bit addresses can't be kept inside the
+	 * data area */
+	return mode != Ad8r && mode != PC8r && mode != absl;
+}
+
+static int harness_usable (uae_u16 opcode)
+{
+	struct instr *in = &table68k[opcode];
+	int len;
+
+	if (in->mnemo == i_ILLG || in->plev || in->isjmp)
+		return -1;
+	len = m68k_harness_opcode_length (opcode);
+	if (len < 2 || len > 10)
+		return -1;
+	/* address registers must stay inside the data area */
+	if (in->duse && in->dmode == Areg)
+		return -1;
+	if ((in->suse && !harness_mode_ok (in->smode)) || (in->duse && !harness_mode_ok (in->dmode)))
+		return -1;
+	if (in->mnemo >= i_BFTST && in->mnemo <= i_BFINS && in->dmode != Dreg)
+		return -1;
+	return harness_class_of (in->mnemo);
+}
+
+static void harness_build_pools (void)
+{
+	for (int i = 0; i < RANDOM_CLASSES; i++) {
+		harness_pool[i] = xmalloc (uae_u16, 65536);
+		harness_poolsize[i] = 0;
+	}
+	for (int opcode = 0; opcode < 65536; opcode++) {
+		int c = harness_usable (opcode);
+		if (c < 0)
+			continue;
+		harness_pool[c][harness_poolsize[c]++] = opcode;
+		harness_pool[CLASS_MIXED][harness_poolsize[CLASS_MIXED]++] = opcode;
+	}
+}
+
+static void harness_generate (struct harness_stream *st, int c)
+{
+	const uae_u16 *pool = harness_pool[c];
+	int words = 0;
+
+	for (int i = 0; i < HARNESS_INSNS; i++) {
+		uae_u16 opcode = pool[harness_rand () % harness_poolsize[c]];
+		int len = m68k_harness_opcode_length (opcode) / 2;
+		st->code[words++] = opcode;
+		for (int j = 1; j < len; j++)
+			st->code[words++] = 0x1000 + (harness_rand () & 0x6ffe);
+	}
+	st->code[words++] = 0x4e72;
+	st->code[words++] = 0x2700;
+	st->words = words;
+	for (int i = 0; i < 8; i++) {
+		st->regs[i] = harness_rand ();
+		st->regs[i + 8] = (0x3000 + harness_rand () % 0x3000) & ~3;
+	}
+}
+
+static void harness_set_regs (const struct harness_stream *st)
+{
+	regs.sr = 0x2700;
+	MakeFromSR ();
+	regs.vbr = 0;
+	memcpy (regs.regs, st->regs, sizeof regs.regs);
+}
+
+static void harness_setup (const struct harness_stream *st)
+{
+	for (int i = 0; i < 256; i++)
+		put_long (i * 4, HARNESS_EXCEPTION);
+	put_word (HARNESS_EXCEPTION, 0x4e72);
+	put_word (HARNESS_EXCEPTION + 2, 0x2700);
+	memcpy (get_real_address (HARNESS_DATA), harness_data, HARNESS_DATA_SIZE);
+	for (int i = 0; i < st->words; i++)
+		put_word (HARNESS_CODE + i * 2, st->code[i]);
+	flush_icache (0, 3);
+	harness_set_regs (st);
+}
+
+static void harness_capture (struct harness_state *hs)
+{
+	const uae_u8 *p = get_real_address (HARNESS_DATA);
+	uae_u32 hash = 2166136261u;
+
+	MakeSR ();
+	memcpy (hs->regs, regs.regs, sizeof hs->regs);
+	hs->pc = m68k_getpc ();
+	hs->sr = regs.sr;
+	for (int i = 0; i < HARNESS_DATA_SIZE; i++)
+		hash = (hash ^ p[i]) * 16777619u;
+	hs->datahash = hash;
+}
+
+static bool harness_equal (const struct harness_state *a, const struct harness_state *b)
+{
+	return !memcmp (a->regs, b->regs, sizeof a->regs) && a->pc == b->pc &&
+		a->sr == b->sr && a->datahash == b->datahash;
+}
+
+static void harness_mismatch (const struct harness_variant *v, const struct harness_class *hc,
+	int stream, const struct harness_state *exp, const struct harness_state *got)
+{
+	TCHAR what[8];
+	uae_u32 e, g;
+
+	if (exp->pc != got->pc) {
+		_tcscpy (what, _T("PC"));
+		e = exp->pc;
+		g = got->pc;
+	} else if (exp->sr != got->sr) {
+		_tcscpy (what, _T("SR"));
+		e = exp->sr;
+		g = got->sr;
+	} else if (exp->datahash != got->datahash) {
+		_tcscpy (what, _T("memory"));
+		e = exp->datahash;
+		g = got->datahash;
+	} else {
+		int i;
+		for (i = 0; i < 15; i++) {
+			if (exp->regs[i] != got->regs[i])
+				break;
+		}
+		_stprintf (what, _T("%c%d"), i < 8 ? 'D' : 'A', i & 7);
+		e = exp->regs[i];
+		g = got->regs[i];
+	}
+	write_log (_T("CPU harness: %s %s #%d: %s %08x, expected %08x\n"),
+		v->name, hc->name, stream, what, g, e);
+	if (harness_reported >= HARNESS_MAX_MISMATCHES)
+		return;
+	fprintf (harness_report, "%s\n    {\"variant\": \"%s\", \"class\": \"%s\", \"stream\": %d, "
+		"\"what\": \"%s\", \"expected\": \"%08x\", \"actual\": \"%08x\"}",
+		harness_reported ? "," : "", v->name, hc->name, stream, what, e, g);
+	harness_reported++;
+}
+
+/* Runs the stream once in the fast core. Streams that don't reach the
+ * final STOP (exceptions, odd addresses on the 68000) are rejected. */
+static bool harness_reference (struct harness_stream *st)
+{
+	harness_setup (st);
+	st->insns = m68k_harness_run (HARNESS_CODE, HARNESS_MAX_STEPS);
+	if (st->insns <= 0)
+		return false;
+	harness_capture (&st->expected);
+	return st->expected.pc == HARNESS_CODE + st->words * 2;
+}
+
+static void harness_prepare_classes (void)
+{
+	for (int c = 0; c < HARNESS_CLASSES; c++) {
+		struct harness_class *hc = &harness_classes[c];
+		if (hc->curated) {
+			hc->streams = xcalloc (struct harness_stream, 1);
+			memcpy (hc->streams[0].code, hc->curated, hc->curated_words * sizeof (uae_u16));
+			hc->streams[0].words = hc->curated_words;
+			for (int i = 0; i < 8; i++) {
+				hc->streams[0].regs[i] = harness_rand ();
+				hc->streams[0].regs[i + 8] = 0x3000;
+			}
+			hc->nstreams = harness_reference (&hc->streams[0]) ? 1 : 0;
+			hc->repeat = HARNESS_CURATED_REPEAT;
+			continue;
+		}
+		hc->streams = xcalloc (struct harness_stream, HARNESS_STREAMS);
+		hc->repeat = HARNESS_RANDOM_REPEAT;
+		if (!harness_poolsize[c])
+			continue;
+		for (int attempt = 0; attempt < HARNESS_STREAMS * HARNESS_ATTEMPTS && hc->nstreams < HARNESS_STREAMS; attempt++) {
+			struct harness_stream *st = &hc->streams[hc->nstreams];
+			harness_generate (st, c);
+			if (harness_reference (st))
+				hc->nstreams++;
+		}
+	}
+}
+
+static void harness_apply (const struct harness_variant *v, const struct uae_prefs *p)
+{
+	currprefs.cpu_compatible = changed_prefs.cpu_compatible = v->compatible;
+	currprefs.cpu_cycle_exact = changed_prefs.cpu_cycle_exact = v->cycle_exact;
+	currprefs.cpu_memory_cycle_exact = changed_prefs.cpu_memory_cycle_exact = v->cycle_exact;
+	currprefs.mmu_model = changed_prefs.mmu_model = v->mmu ? p->mmu_model : 0;
+	currprefs.cachesize = changed_prefs.cachesize = v->jit ? p->cachesize : 0;
+	m68k_harness_rebuild ();
+}
+
+static void harness_run_variant (const struct harness_variant *v, bool compare, struct harness_result *res)
+{
+	for (int c = 0; c < HARNESS_CLASSES; c++) {
+		struct harness_class *hc = &harness_classes[c];
+		struct harness_result *r = &res[c];
+		memset (r, 0, sizeof *r);
+		for (int s = 0; s < hc->nstreams; s++) {
+			struct harness_stream *st = &hc->streams[s];
+			struct harness_state got;
+
+			harness_setup (st);
+			if (m68k_harness_run (HARNESS_CODE, HARNESS_MAX_STEPS) < 0) {
+				r->failures++;
+				continue;
+			}
+			harness_capture (&got);
+			if (compare && !harness_equal (&got, &st->expected)) {
+				r->mismatches++;
+				harness_mismatch (v, hc, s, &st->expected, &got);
+			}
+			/* Memory is not restored between repetitions, only the
+			 * registers, so the addresses stay inside the data area. */
+			frame_time_t t = read_processor_time ();
+			for (int i = 0; i < hc->repeat; i++) {
+				harness_set_regs (st);
+				if (m68k_harness_run (HARNESS_CODE, HARNESS_MAX_STEPS) < 0)
+					break;
+			}
+			r->time += (uae_u32)(read_processor_time () - t);
+			r->insns += (uae_u64)st->insns * hc->repeat;
+		}
+	}
+}
+
+void cpu_harness_run (const TCHAR *path)
+{
+	struct harness_variant variants[5];
+	struct harness_result results[5][HARNESS_CLASSES];
+	struct uae_prefs *saved;
+	int nvariants = 0;
+
+	if (currprefs.chipmem_size < HARNESS_CHIPMEM) {
+		write_log (_T("CPU harness: needs at least 512K chip memory\n"));
+		return;
+	}
+	harness_report = uae_tfopen (path, _T("w"));
+	if (!harness_report) {
+		write_log (_T("CPU harness: can't open '%s'\n"), path);
+		return;
+	}
+	saved = xmalloc (struct uae_prefs, 1);
+	memcpy (saved, &currprefs, sizeof (struct uae_prefs));
+
+	variants[nvariants++] = { _T("fast"), false, false, false, false };
+	variants[nvariants++] = { _T("prefetch"), true, false, false, false };
+	variants[nvariants++] = { _T("cycle-exact"), true, true, false, false };
+	if (saved->mmu_model)
+		variants[nvariants++] = { _T("mmu"), saved->cpu_compatible, false, true, false };
+#ifdef JIT
+	if (saved->cachesize && saved->cpu_model >= 68020)
+		variants[nvariants++] = { _T("jit"), false, false, false, true };
+#endif
+
+	write_log (_T("CPU harness: %d, %d variants, report '%s'\n"), saved->cpu_model, nvariants, path);
+	map_overlay (1);
+	harness_seed = 0x2545f491;
+	harness_data = xmalloc (uae_u8, HARNESS_DATA_SIZE);
+	for (int i = 0; i < HARNESS_DATA_SIZE; i++)
+		harness_data[i] = harness_rand () >> 24;
+
+	harness_apply (&variants[0], saved);
+	harness_build_pools ();
+	harness_prepare_classes ();
+
+	fprintf (harness_report, "{\n  \"cpu\": %d,\n  \"mismatches\": [", saved->cpu_model);
+	harness_reported = 0;
+	for (int v = 0; v < nvariants; v++) {
+		harness_apply (&variants[v], saved);
+		harness_run_variant (&variants[v], v > 0, results[v]);
+	}
+	fprintf (harness_report, "%s],\n  \"variants\": [", harness_reported ? "\n  " : "");
+
+	for (int v = 0; v < nvariants; v++) {
+		fprintf (harness_report, "%s\n    {\"name\": \"%s\", \"classes\": [", v ? "," : "", variants[v].name);
+		for (int c = 0; c < HARNESS_CLASSES; c++) {
+			struct harness_result *r = &results[v][c];
+			double seconds = (double)r->time / syncbase;
+			double ips = seconds > 0 ? r->insns / seconds : 0;
+			fprintf (harness_report, "%s\n      {\"class\": \"%s\", \"streams\": %d, \"instructions\": %llu, "
+				"\"seconds\": %.3f, \"ips\": %.0f, \"mismatches\": %d, \"failures\": %d}",
+				c ? "," : "", harness_classes[c].name, harness_classes[c].nstreams,
+				(unsigned long long)r->insns, seconds, ips, r->mismatches, r->failures);
+			write_log (_T("CPU harness: %-12s %-14s %2d streams %8.2f MIPS %d mismatches %d failures\n"),
+				variants[v].name, harness_classes[c].name, harness_classes[c].nstreams,
+				ips / 1000000.0, r->mismatches, r->failures);
+		}
+		fprintf (harness_report, "\n    ]}");
+	}
+	fprintf (harness_report, "\n  ]\n}\n");
+	fclose (harness_report);
+	harness_report = NULL;
+
+	for (int c = 0; c < HARNESS_CLASSES; c++) {
+		xfree (harness_classes[c].streams);
+		harness_classes[c].streams = NULL;
+		harness_classes[c].nstreams = 0;
+	}
+	for (int i = 0; i < RANDOM_CLASSES; i++)
+		xfree (harness_pool[i]);
+	xfree (harness_data);
+
+	currprefs.cpu_compatible = changed_prefs.cpu_compatible = saved->cpu_compatible;
+	currprefs.cpu_cycle_exact = changed_prefs.cpu_cycle_exact = saved->cpu_cycle_exact;
+	currprefs.cpu_memory_cycle_exact = changed_prefs.cpu_memory_cycle_exact = saved->cpu_memory_cycle_exact;
+	currprefs.mmu_model = changed_prefs.mmu_model = saved->mmu_model;
+	currprefs.cachesize = changed_prefs.cachesize = saved->cachesize;
+	m68k_harness_rebuild ();
+	xfree (saved);
+}
@@ -7431,6 +7431,22 @@ static bool framewait (void)
 	return status != 0;
 }
 
+/* Frames emulated ahead are not paced, and only the last one is shown */
+static bool framewait_runahead (void)
+{
+	frame_time_t curr_time = read_processor_time ();
+
+	if (!frame_rendered && !picasso_on)
+		frame_rendered = render_screen (false);
+	if (frame_rendered && !frame_shown) {
+		show_screen (0);
+		frame_shown = true;
+	}
+	vsyncmintime = curr_time;
+	vsyncmaxtime = vsyncwaittime = curr_time + vsynctimebase;
+	return true;
+}
+
 #ifdef FSUAE // NL
 
 static bool framewait (void)
@@ -7567,10 +7583,17 @@ static void fpscounter (bool frameok)
 // vsync functions that are not hardware timing related
 static void vsync_handler_pre (void)
 {
+	bool events = true;
+
 	if (bogusframe > 0)
 		bogusframe--;
 
-	while (handle_events ()) {
+#ifdef SAVESTATE
+	savestate_runahead_vsync ();
+	events = savestate_runahead_events ();
+#endif
+
+	while (events && handle_events ()) {
 		// we are paused, do all config checks but don't do any emulation
 		if (vsync_handle_check ()) {
 			redraw_frame ();
@@ -7611,7 +7634,7 @@ static void vsync_handler_pre (void)
 		frameskiptime += end - start;
 	}
 
-	bool frameok = framewait ();
+	bool frameok = events ? framewait () : framewait_runahead ();
 	
 	if (!picasso_on) {
 		if (!frame_rendered && vblank_hz_state) {
@@ -8072,6 +8095,10 @@ static void hsync_handler_pre (bool onvsync)
 		vsync_counter++;
 #ifdef FSUAE
 	g_uae_vsync_counter++;
+#endif
+#if EVENT_STATS
+		if (event_stats_enabled)
+			events_stats_vsync ();
 #endif
 	}
 	set_hpos ();
@@ -8477,9 +8504,7 @@ void init_eventtab (void)
 		eventtab[i].active = 0;
 		eventtab[i].oldcycles = get_cycles ();
 	}
-	for (i = 0; i < ev2_max; i++) {
-		eventtab2[i].active = 0;
-	}
+	event2_reset ();
 
 	eventtab[ev_cia].handler = CIA_handler;
 	eventtab[ev_hsync].handler = hsync_handler;
@@ -9257,14 +9282,7 @@ static void REGPARAM2 custom_lput (uaecptr addr, uae_u32 value)
 
 void custom_prepare_savestate (void)
 {
-	int i;
-
-	for (i = 0; i < ev2_max; i++) {
-		if (eventtab2[i].active) {
-			eventtab2[i].active = 0;
-			eventtab2[i].handler (eventtab2[i].data);
-		}
-	}
+	event2_flush ();
 }
 
 #define RB restore_u8 ()
@@ -9813,9 +9831,9 @@ uae_u8 *save_custom_event_delay (int *len, uae_u8 *dstptr)
 	uae_u8 *dstbak, *dst;
 	int cnt = 0;
 
-	for (int i = ev2_misc; i < ev2_max; i++) {
-		struct ev2 *e = &eventtab2[i];
-		if (e->active && e->handler == send_interrupt_do) {
+	for (int i = 0; i < eventtab2_misc_count; i++) {
+		struct ev2 *e = &eventtab2_misc[i];
+		if (e->handler == send_interrupt_do && cnt < 255) {
 			cnt++;
 		}
 	}
@@ -9825,13 +9843,14 @@ uae_u8 *save_custom_event_delay (int *len, uae_u8 *dstptr)
 	if (dstptr)
 		dstbak = dst = dstptr;
 	else
-		dstbak = dst = xmalloc (uae_u8, 1000);
+		dstbak = dst = xmalloc (uae_u8, 5 + cnt * 13);
 
 	save_u32 (1);
 	save_u8 (cnt);
-	for (int i = ev2_misc; i < ev2_max; i++) {
-		struct ev2 *e = &eventtab2[i];
-		if (e->active && e->handler == send_interrupt_do) {
+	for (int i = 0; i < eventtab2_misc_count && cnt > 0; i++) {
+		struct ev2 *e = &eventtab2_misc[i];
+		if (e->handler == send_interrupt_do) {
+			cnt--;
 			save_u8 (1);
 			save_u64 (e->evtime - get_cycles ());
 			save_u32 (e->data);
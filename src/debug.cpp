@@ -38,11 +38,15 @@
 #include "calc.h"
 #include "uae/debuginfo.h"
 #include "uae/segtracker.h"
+#include "uae/segprofiler.h"
 #include "cpummu.h"
 #include "cpummu030.h"
 #include "ar.h"
 #include "pci.h"
 #include "uae/io.h"
+#ifdef JIT
+#include "jit/compemu.h"
+#endif
 #ifdef WITH_PPC
 #include "ppc/ppcd.h"
 #include "uae/ppc.h"
@@ -139,6 +143,14 @@ static TCHAR help[] = {
 	_T("  fS <val> <mask>       Break when (SR & mask) = val.\n")                   
 	_T("  f <addr1> <addr2>     Step forward until <addr1> <= PC <= <addr2>.\n")
 	_T("  e                     Dump contents of all custom registers, ea = AGA colors.\n")
+#if EVENT_STATS
+	_T("  es [r|+|-]            Show event scheduler statistics, r = reset, +/- = enable/disable.\n")
+#endif
+#ifdef JIT
+	_T("  J [<n>]               Show JIT statistics and the <n> hottest blocks.\n")
+	_T("  Jr                    Reset JIT statistics.\n")
+	_T("  Jj <file>             Write JIT statistics as JSON.\n")
+#endif
 	_T("  i [<addr>]            Dump contents of interrupt and trap vectors.\n")
 	_T("  il [<mask>]           Exception breakpoint.\n")
 	_T("  o <0-2|addr> [<lines>]View memory as Copper instructions.\n")
@@ -181,6 +193,8 @@ static TCHAR help[] = {
 	_T("  Zf 'hostfile'         load debug info from given executable file.\n")
 	_T("  Zy 'symbol'           find symbol address.\n")
 	_T("  Zc 'file' <line>      find source code line address.\n")
+	_T("  Zp [<lines>]          start sampling profiler every <lines> scanlines, 0 = stop.\n")
+	_T("  Zw 'hostfile'         write profiler samples as folded stacks (flamegraph).\n")
 #endif /* WITH_SEGTRACKER */
 	_T("  ?<value>              Hex ($ and 0x)/Bin (%)/Dec (!) converter.\n")
 	_T("  vh [<ratio> <lines>]  \"Heat map\"\n")
@@ -1000,6 +1014,45 @@ static void dump_custom_regs (int aga)
 	free (p2);
 }
 
+#if EVENT_STATS
+static void dump_event_stats (TCHAR **inptr)
+{
+	struct event_stat st[EVENT_STATS_MAX];
+	uae_u32 frames;
+	int num;
+
+	if (**inptr == 'r') {
+		events_reset_stats ();
+		console_out_f (_T("Event statistics reset\n"));
+		return;
+	}
+	if (**inptr == '+' || **inptr == '-') {
+		event_stats_enabled = **inptr == '+';
+		console_out_f (_T("Event statistics %s\n"), event_stats_enabled ? _T("enabled") : _T("disabled"));
+		return;
+	}
+	if (!event_stats_enabled)
+		console_out_f (_T("Event statistics are disabled, use 'es +' to enable\n"));
+	num = events_get_stats (st, EVENT_STATS_MAX, &frames);
+	console_out_f (_T("Event statistics, %u frames, %d pending misc events\n"), frames, eventtab2_misc_count);
+	console_out_f (_T("%-16s %12s %8s %8s %10s\n"), _T("event"), _T("fires"), _T("/frame"), _T("peak"), _T("host ms"));
+	for (int i = 0; i < num; i++) {
+		TCHAR name[32];
+		if (!st[i].fires)
+			continue;
+		if (st[i].name)
+			_tcscpy (name, st[i].name);
+		else
+			_stprintf (name, _T("ev2 %p"), st[i].handler);
+		console_out_f (_T("%-16s %12llu %8.1f %8u %10.1f\n"), name,
+			(unsigned long long)st[i].fires,
+			frames ? (double)st[i].fires / frames : 0.0,
+			st[i].peak_frame_fires,
+			syncbase ? st[i].time * 1000.0 / syncbase : 0.0);
+	}
+}
+#endif
+
 static void dump_vectors (uaecptr addr)
 {
 	int i = 0, j = 0;
@@ -4773,6 +4826,34 @@ static void segtracker(TCHAR **inptr)
 				}
 			}
 			break;
+		case 'p': /* 'Zp' [<lines>]: start/stop sampling profiler */
+			ignore_ws(inptr);
+			if(more_params(inptr)) {
+				int lines = readint(inptr);
+				segprofiler_start(lines);
+			} else if(!segprofiler_interval) {
+				segprofiler_start(16);
+			}
+			segprofiler_status();
+			break;
+		case 'w': /* 'Zw' 'hostfile': write profile */
+			{
+				TCHAR str[256];
+				int len = parse_string(inptr, str, 256);
+				if(len > 0) {
+					char *cstr = au(str);
+					int num = segprofiler_write_folded(cstr);
+					if(num >= 0) {
+						console_out_f(_T("Wrote %d stacks to '%s'\n"), num, cstr);
+					} else {
+						console_out_f(_T("Error writing '%s'\n"), cstr);
+					}
+					xfree(cstr);
+				} else {
+					console_out_f(_T("No output file given!\n"));
+				}
+			}
+			break;
 		}
 	} else {
 		/* only 'Z': show tracker status */
@@ -4846,7 +4927,40 @@ static bool debug_line (TCHAR *input)
 			}
 			break;
 		}
-		case 'e': dump_custom_regs (tolower(*inptr) == 'a'); break;
+#ifdef JIT
+		case 'J':
+			if (*inptr == 'r') {
+				jit_stats_reset ();
+				console_out_f (_T("JIT statistics reset\n"));
+			} else if (*inptr == 'j') {
+				TCHAR name[MAX_DPATH];
+				inptr++;
+				ignore_ws (&inptr);
+				if (!next_string (&inptr, name, MAX_DPATH, 0))
+					break;
+				if (jit_stats_write_json (name))
+					console_out_f (_T("Wrote JIT statistics to '%s'\n"), name);
+				else
+					console_out_f (_T("Couldn't open '%s'\n"), name);
+			} else {
+				int top = 20;
+				if (more_params (&inptr))
+					top = readint (&inptr);
+				jit_stats_dump (top);
+			}
+			break;
+#endif
+		case 'e':
+#if EVENT_STATS
+			if (*inptr == 's') {
+				inptr++;
+				ignore_ws (&inptr);
+				dump_event_stats (&inptr);
+				break;
+			}
+#endif
+			dump_custom_regs (tolower(*inptr) == 'a');
+			break;
 		case 'r':
 			{
 				if (*inptr == 'c')
@@ -60,6 +60,7 @@
 #include "ethernet.h"
 #include "uae/debuginfo.h"
 #include "uae/segtracker.h"
+#include "uae/segprofiler.h"
 #ifdef RETROPLATFORM
 #include "rp.h"
 #endif
@@ -187,6 +188,9 @@ void devices_hsync(void)
 #ifdef A2091
 	scsi_hsync ();
 #endif
+#ifdef WITH_SEGTRACKER
+	segprofiler_hsync();
+#endif
 }
 
 void devices_rethink(void)
@@ -362,6 +366,7 @@ void do_leave_program (void)
 	gfxboard_free();
 #ifdef SAVESTATE
 	savestate_free ();
+	savestate_runahead_free ();
 #endif
 	memory_cleanup ();
 	free_shm ();
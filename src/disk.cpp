@@ -36,6 +36,7 @@ int disk_debug_track = -1;
 #include "savestate.h"
 #include "cia.h"
 #include "debug.h"
+#include "threaddep/thread.h"
 #ifdef FDI2RAW
 #include "fdi2raw.h"
 #endif
@@ -60,6 +61,9 @@ int disk_debug_track = -1;
 #include "fsdb.h"
 #include "statusline.h"
 #include "rommgr.h"
+#ifdef WITH_X86
+#include "x86.h"
+#endif
 
 #ifdef FSUAE // NL
 #include "uae/fs.h"
@@ -764,7 +768,40 @@ static void update_drive_gui (int num, bool force)
 
 static void drive_fill_bigbuf (drive * drv,int);
 
-int DISK_validate_filename (struct uae_prefs *p, const TCHAR *fname, int leave_open, bool *wrprot, uae_u32 *crc32, struct zfile **zf)
+/* Floppy images are opened (and DMS/ADZ/archive containers unpacked) by
+ * a background thread while a delayed insert counts down, the drive
+ * stays empty until the image is ready. The unpackers are not reentrant,
+ * so all image opens are serialized with disk_image_sem. */
+
+#define DISK_PRELOAD_NONE 0
+#define DISK_PRELOAD_LOADING 1
+#define DISK_PRELOAD_READY 2
+
+struct disk_preload
+{
+	TCHAR name[256];
+	int state;
+	bool wrprot;
+	uae_u32 crc32;
+	struct zfile *zf;
+};
+
+static struct disk_preload disk_preload[MAX_FLOPPY_DRIVES];
+static uae_sem_t disk_image_sem, disk_preload_sem;
+static bool disk_sem_init;
+static smp_comm_pipe disk_preload_requests;
+static bool disk_preload_thread_running;
+
+static void disk_init_sem (void)
+{
+	if (disk_sem_init)
+		return;
+	uae_sem_init (&disk_image_sem, 0, 1);
+	uae_sem_init (&disk_preload_sem, 0, 1);
+	disk_sem_init = true;
+}
+
+static int DISK_validate_filename_2 (struct uae_prefs *p, const TCHAR *fname, int leave_open, bool *wrprot, uae_u32 *crc32, struct zfile **zf)
 {
 	if (zf)
 		*zf = NULL;
@@ -805,6 +842,124 @@ int DISK_validate_filename (struct uae_prefs *p, const TCHAR *fname, int leave_o
 	}
 }
 
+int DISK_validate_filename (struct uae_prefs *p, const TCHAR *fname, int leave_open, bool *wrprot, uae_u32 *crc32, struct zfile **zf)
+{
+	disk_init_sem ();
+	uae_sem_wait (&disk_image_sem);
+	int v = DISK_validate_filename_2 (p, fname, leave_open, wrprot, crc32, zf);
+	uae_sem_post (&disk_image_sem);
+	return v;
+}
+
+static void *disk_preload_thread (void *v)
+{
+	for (;;) {
+		int num = read_comm_pipe_int_blocking (&disk_preload_requests);
+		struct disk_preload *pl = &disk_preload[num];
+		TCHAR name[256];
+		bool wrprot;
+		uae_u32 crc32;
+		struct zfile *zf;
+
+		uae_sem_wait (&disk_preload_sem);
+		if (pl->state != DISK_PRELOAD_LOADING) {
+			uae_sem_post (&disk_preload_sem);
+			continue;
+		}
+		_tcscpy (name, pl->name);
+		uae_sem_post (&disk_preload_sem);
+
+		DISK_validate_filename (&currprefs, name, 1, &wrprot, &crc32, &zf);
+
+		uae_sem_wait (&disk_preload_sem);
+		if (pl->state == DISK_PRELOAD_LOADING && !_tcscmp (pl->name, name)) {
+			pl->state = DISK_PRELOAD_READY;
+			pl->wrprot = wrprot;
+			pl->crc32 = crc32;
+			pl->zf = zf;
+			zf = NULL;
+		}
+		uae_sem_post (&disk_preload_sem);
+		zfile_fclose (zf);
+		if (disk_debug_logging > 0)
+			write_log (_T("DF%d: '%s' preloaded\n"), num, name);
+	}
+	return 0;
+}
+
+static void disk_preload_clear (struct disk_preload *pl)
+{
+	zfile_fclose (pl->zf);
+	pl->zf = NULL;
+	pl->name[0] = 0;
+	pl->state = DISK_PRELOAD_NONE;
+}
+
+static void disk_preload_start (int num, const TCHAR *name)
+{
+	struct disk_preload *pl = &disk_preload[num];
+
+	if (!name[0])
+		return;
+	disk_init_sem ();
+	uae_sem_wait (&disk_preload_sem);
+	if (pl->state != DISK_PRELOAD_NONE && !_tcscmp (pl->name, name)) {
+		uae_sem_post (&disk_preload_sem);
+		return;
+	}
+	disk_preload_clear (pl);
+	_tcsncpy (pl->name, name, 255);
+	pl->name[255] = 0;
+	pl->state = DISK_PRELOAD_LOADING;
+	uae_sem_post (&disk_preload_sem);
+	if (!disk_preload_thread_running) {
+		init_comm_pipe (&disk_preload_requests, 20, 1);
+		uae_start_thread (_T("disk"), disk_preload_thread, NULL, NULL);
+		disk_preload_thread_running = true;
+	}
+	write_comm_pipe_int (&disk_preload_requests, num, 1);
+}
+
+static bool disk_preload_busy (int num, const TCHAR *name)
+{
+	struct disk_preload *pl = &disk_preload[num];
+	bool busy;
+
+	if (!disk_sem_init)
+		return false;
+	uae_sem_wait (&disk_preload_sem);
+	busy = pl->state == DISK_PRELOAD_LOADING && !_tcscmp (pl->name, name);
+	uae_sem_post (&disk_preload_sem);
+	return busy;
+}
+
+/* Hands out the preloaded image. A real insert takes it over, a fake
+ * one (DISK_examine_image) gets a duplicate. */
+static bool disk_preload_get (int num, const TCHAR *name, bool take, bool *wrprot, uae_u32 *crc32, struct zfile **zf)
+{
+	struct disk_preload *pl = &disk_preload[num];
+	bool ok = false;
+
+	if (!disk_sem_init)
+		return false;
+	uae_sem_wait (&disk_preload_sem);
+	if (pl->state == DISK_PRELOAD_READY && !_tcscmp (pl->name, name) && pl->zf) {
+		struct zfile *f = take ? pl->zf : zfile_dup (pl->zf);
+		if (f) {
+			*zf = f;
+			*wrprot = pl->wrprot;
+			*crc32 = pl->crc32;
+			if (take)
+				pl->zf = NULL;
+			ok = true;
+		}
+	}
+	if (take)
+		disk_preload_clear (pl);
+	uae_sem_post (&disk_preload_sem);
+	return ok;
+}
+
 static void updatemfmpos (drive *drv)
 {
 #ifdef FSUAE
@@ -1162,7 +1317,7 @@ static void update_disk_statusline(int num)
 		statusline_add_message(_T("DF%d: %s"), num, my_getfilepart(fname));
 }
 
-static int drive_insert (drive * drv, struct uae_prefs *p, int dnum, const TCHAR *fname, bool fake, bool forcedwriteprotect)
+static int drive_insert_2 (drive * drv, struct uae_prefs *p, int dnum, const TCHAR *fname, bool fake, bool forcedwriteprotect)
 {
 #ifdef FSUAE
 	write_log("drive_insert drv=%p dnum=%d fname=%s fake=%d\n", drv, dnum, fname, fake);
@@ -1175,7 +1330,8 @@ static int drive_insert (drive * drv, struct uae_prefs *p, int dnum, const TCHAR
 	drive_image_free (drv);
 	if (!fake)
 		DISK_examine_image(p, dnum, &disk_info_data);
-	DISK_validate_filename (p, fname, 1, &drv->wrprot, &drv->crc32, &drv->diskfile);
+	if (!disk_preload_get (dnum, fname, !fake, &drv->wrprot, &drv->crc32, &drv->diskfile))
+		DISK_validate_filename (p, fname, 1, &drv->wrprot, &drv->crc32, &drv->diskfile);
 	drv->forcedwrprot = forcedwriteprotect;
 	if (drv->forcedwrprot)
 		drv->wrprot = true;
@@ -1520,6 +1676,21 @@ static int drive_insert (drive * drv, struct uae_prefs *p, int dnum, const TCHAR
 	return 1;
 }
 
+// PC-only drives are used by the bridgeboard x86 CPU, which may run on
+// its own thread
+static int drive_insert (drive * drv, struct uae_prefs *p, int dnum, const TCHAR *fname, bool fake, bool forcedwriteprotect)
+{
+	int v;
+#ifdef WITH_X86
+	x86_bridge_sync_lock ();
+#endif
+	v = drive_insert_2 (drv, p, dnum, fname, fake, forcedwriteprotect);
+#ifdef WITH_X86
+	x86_bridge_sync_unlock ();
+#endif
+	return v;
+}
+
 static void rand_shifter (drive *drv)
 {
 	int r = ((uaerand () >> 4) & 7) + 1;
@@ -2608,6 +2779,9 @@ static void drive_write_data (drive * drv)
 
 static void drive_eject (drive * drv)
 {
+#ifdef WITH_X86
+	x86_bridge_sync_lock ();
+#endif
 #ifdef DRIVESOUND
 	if (isfloppysound (drv))
 		driveclick_insert (drv - floppy, 1);
@@ -2628,6 +2802,9 @@ static void drive_eject (drive * drv)
 	if (disk_debug_logging > 0)
 		write_log (_T("eject drive %ld\n"), drv - &floppy[0]);
 	inprec_recorddiskchange (drv - floppy, NULL, false);
+#ifdef WITH_X86
+	x86_bridge_sync_unlock ();
+#endif
 }
 
 /* We use this function if we have no Kickstart ROM.
@@ -2810,6 +2987,8 @@ static void diskfile_readonly (const TCHAR *name, bool readonly)
 static void setdskchangetime (drive *drv, int dsktime)
 {
 	int i;
+	/* start unpacking the new image while the drive is empty */
+	disk_preload_start (drv - floppy, drv->newname);
 	/* prevent multiple disk insertions at the same time */
 	if (drv->dskchange_time > 0)
 		return;
@@ -3873,7 +4052,10 @@ void DISK_hsync (void)
 		/* delay until new disk image is inserted */
 		if (drv->dskchange_time > 0) {
 			drv->dskchange_time--;
-			if (drv->dskchange_time == 0) {
+			if (drv->dskchange_time == 0 && disk_preload_busy (dr, drv->newname)) {
+				/* image is still being unpacked, keep the drive empty */
+				drv->dskchange_time = 1;
+			} else if (drv->dskchange_time == 0) {
 				drive_insert (drv, &currprefs, dr, drv->newname, false, drv->newnamewriteprotected);
 				if (disk_debug_logging > 0)
 					write_log (_T("delayed insert, drive %d, image '%s'\n"), dr, drv->newname);
@@ -4305,6 +4487,11 @@ void DISK_free (void)
 	for (int dr = 0; dr < MAX_FLOPPY_DRIVES; dr++) {
 		drive *drv = &floppy[dr];
 		drive_image_free (drv);
+		if (disk_sem_init) {
+			uae_sem_wait (&disk_preload_sem);
+			disk_preload_clear (&disk_preload[dr]);
+			uae_sem_post (&disk_preload_sem);
+		}
 	}
 }
 
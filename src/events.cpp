@@ -121,6 +121,13 @@ void do_cycles_slow (unsigned long cycles_to_add)
 					gui_message(_T("eventtab[%d].handler is null!\n"), i);
 					eventtab[i].active = 0;
 				} else {
+#if EVENT_STATS
+					if (event_stats_enabled) {
+						frame_time_t t = read_processor_time ();
+						(*eventtab[i].handler)();
+						event_stats_add (i, t);
+					} else
+#endif
 					(*eventtab[i].handler)();
 				}
 			}
@@ -132,42 +139,157 @@ void do_cycles_slow (unsigned long cycles_to_add)
 	currcycle += cycles_to_add;
 }
 
+/* Misc (ev2) events scheduled with event2_newevent2 () live in a binary
+ * min-heap ordered by evtime, which grows on demand, so expansion heavy
+ * configurations never run out of slots. The fixed ev2 slots (blitter,
+ * disk) stay in eventtab2. */
+
+struct ev2 *eventtab2_misc;
+int eventtab2_misc_count;
+static int eventtab2_misc_size;
+
+static inline bool evtime_before (evt a, evt b)
+{
+	return (signed long)(a - b) < 0;
+}
+
+static void misc_heap_up (int i)
+{
+	struct ev2 e = eventtab2_misc[i];
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+		if (!evtime_before (e.evtime, eventtab2_misc[parent].evtime))
+			break;
+		eventtab2_misc[i] = eventtab2_misc[parent];
+		i = parent;
+	}
+	eventtab2_misc[i] = e;
+}
+
+static void misc_heap_down (int i)
+{
+	struct ev2 e = eventtab2_misc[i];
+	for (;;) {
+		int child = i * 2 + 1;
+		if (child >= eventtab2_misc_count)
+			break;
+		if (child + 1 < eventtab2_misc_count && evtime_before (eventtab2_misc[child + 1].evtime, eventtab2_misc[child].evtime))
+			child++;
+		if (!evtime_before (eventtab2_misc[child].evtime, e.evtime))
+			break;
+		eventtab2_misc[i] = eventtab2_misc[child];
+		i = child;
+	}
+	eventtab2_misc[i] = e;
+}
+
+static void misc_heap_pop (struct ev2 *e)
+{
+	*e = eventtab2_misc[0];
+	eventtab2_misc_count--;
+	event2_count--;
+	if (eventtab2_misc_count > 0) {
+		eventtab2_misc[0] = eventtab2_misc[eventtab2_misc_count];
+		misc_heap_down (0);
+	}
+}
+
+/* Children are never earlier than their parent, so only the part of the
+ * heap up to et needs to be searched for a duplicate. */
+static bool misc_heap_find (int i, evt et, uae_u32 data, evfunc2 func)
+{
+	if (i >= eventtab2_misc_count)
+		return false;
+	struct ev2 *e = &eventtab2_misc[i];
+	if (evtime_before (et, e->evtime))
+		return false;
+	if (e->evtime == et && e->handler == func && e->data == data)
+		return true;
+	return misc_heap_find (i * 2 + 1, et, data, func) || misc_heap_find (i * 2 + 2, et, data, func);
+}
+
+static void misc_heap_push (evt et, uae_u32 data, evfunc2 func, const TCHAR *name)
+{
+	if (eventtab2_misc_count == eventtab2_misc_size) {
+		eventtab2_misc_size = eventtab2_misc_size ? eventtab2_misc_size * 2 : 16;
+		eventtab2_misc = xrealloc (struct ev2, eventtab2_misc, eventtab2_misc_size);
+	}
+	struct ev2 *e = &eventtab2_misc[eventtab2_misc_count];
+	e->active = true;
+	e->evtime = et;
+	e->data = data;
+	e->handler = func;
+#if EVENT_STATS
+	/* Events queued while statistics are off are not counted. */
+	e->stat = event_stats_enabled ? event_stats_index (func, name) : -1;
+#endif
+	eventtab2_misc_count++;
+	event2_count++;
+	misc_heap_up (eventtab2_misc_count - 1);
+}
+
+static void event2_fire (struct ev2 *e, int stat)
+{
+#if EVENT_STATS
+	if (event_stats_enabled && stat >= 0) {
+		frame_time_t t = read_processor_time ();
+		e->handler (e->data);
+		event_stats_add (stat, t);
+		return;
+	}
+#endif
+	e->handler (e->data);
+}
+
 void MISC_handler (void)
 {
-	static bool dorecheck;
-	bool recheck;
+	bool fired;
 	int i;
 	evt mintime;
 	evt ct = get_cycles ();
 	static int recursive;
 
-	if (recursive) {
-		dorecheck = true;
+	if (recursive)
 		return;
-	}
 	recursive++;
 	eventtab[ev_misc].active = 0;
-	recheck = true;
-	while (recheck) {
-		recheck = false;
-		mintime = ~0L;
+	do {
+		fired = false;
 		for (i = 0; i < ev2_max; i++) {
-			if (eventtab2[i].active) {
-				if (eventtab2[i].evtime == ct) {
-					eventtab2[i].active = false;
-					event2_count--;
-					eventtab2[i].handler (eventtab2[i].data);
-					if (dorecheck || eventtab2[i].active) {
-						recheck = true;
-						dorecheck = false;
-					}
-				} else {
-					evt eventtime = eventtab2[i].evtime - ct;
-					if (eventtime < mintime)
-						mintime = eventtime;
-				}
+			if (eventtab2[i].active && eventtab2[i].evtime == ct) {
+				eventtab2[i].active = false;
+#if EVENT_STATS
+				event2_fire (&eventtab2[i], EVENT_STATS_EV2 + i);
+#else
+				event2_fire (&eventtab2[i], 0);
+#endif
+				fired = true;
 			}
 		}
+		while (eventtab2_misc_count > 0 && !evtime_before (ct, eventtab2_misc[0].evtime)) {
+			struct ev2 e;
+			misc_heap_pop (&e);
+#if EVENT_STATS
+			event2_fire (&e, e.stat);
+#else
+			event2_fire (&e, 0);
+#endif
+			fired = true;
+		}
+	} while (fired);
+
+	mintime = ~0L;
+	for (i = 0; i < ev2_max; i++) {
+		if (eventtab2[i].active) {
+			evt eventtime = eventtab2[i].evtime - ct;
+			if (eventtime < mintime)
+				mintime = eventtime;
+		}
+	}
+	if (eventtab2_misc_count > 0) {
+		evt eventtime = eventtab2_misc[0].evtime - ct;
+		if (eventtime < mintime)
+			mintime = eventtime;
 	}
 	if (mintime != ~0UL) {
 		eventtab[ev_misc].active = true;
@@ -178,39 +300,124 @@ void MISC_handler (void)
 	recursive--;
 }
 
-
-void event2_newevent_xx (int no, evt t, uae_u32 data, evfunc2 func)
+void event2_newevent_xx_name (int no, evt t, uae_u32 data, evfunc2 func, const TCHAR *name)
 {
 	evt et;
-	static int next = ev2_misc;
 
 	et = t + get_cycles ();
 	if (no < 0) {
-		no = next;
-		for (;;) {
-			if (!eventtab2[no].active) {
-				event2_count++;
-				break;
-			}
-			if (eventtab2[no].evtime == et && eventtab2[no].handler == func && eventtab2[no].data == data)
-				break;
-			no++;
-			if (no == ev2_max)
-				no = ev2_misc;
-			if (no == next) {
-				write_log (_T("out of event2's!\n"));
-				return;
-			}
-		}
-		next = no;
+		if (!misc_heap_find (0, et, data, func))
+			misc_heap_push (et, data, func, name);
+	} else {
+		eventtab2[no].active = true;
+		eventtab2[no].evtime = et;
+		eventtab2[no].handler = func;
+		eventtab2[no].data = data;
 	}
-	eventtab2[no].active = true;
-	eventtab2[no].evtime = et;
-	eventtab2[no].handler = func;
-	eventtab2[no].data = data;
 	MISC_handler ();
 }
 
+/* Runs every pending ev2 event immediately, used before saving state. */
+void event2_flush (void)
+{
+	for (int i = 0; i < ev2_max; i++) {
+		if (eventtab2[i].active) {
+			eventtab2[i].active = 0;
+			eventtab2[i].handler (eventtab2[i].data);
+		}
+	}
+	int cnt = eventtab2_misc_count;
+	if (cnt == 0)
+		return;
+	struct ev2 *pending = xmalloc (struct ev2, cnt);
+	memcpy (pending, eventtab2_misc, cnt * sizeof (struct ev2));
+	eventtab2_misc_count = 0;
+	event2_count = 0;
+	for (int i = 0; i < cnt; i++)
+		pending[i].handler (pending[i].data);
+	xfree (pending);
+}
+
+void event2_reset (void)
+{
+	for (int i = 0; i < ev2_max; i++)
+		eventtab2[i].active = 0;
+	eventtab2_misc_count = 0;
+	event2_count = 0;
+}
+
+#if EVENT_STATS
+
+bool event_stats_enabled;
+
+static struct event_stat event_stats[EVENT_STATS_MAX] = {
+	{ _T("cia") }, { _T("audio") }, { _T("misc") }, { _T("hsync") },
+	{ _T("blitter") }, { _T("disk") }
+};
+static int event_stats_num = EVENT_STATS_MISC;
+static uae_u32 event_stats_frames;
+
+int event_stats_index (evfunc2 func, const TCHAR *name)
+{
+	for (int i = EVENT_STATS_MISC; i < event_stats_num; i++) {
+		if (event_stats[i].handler == func) {
+			if (!event_stats[i].name)
+				event_stats[i].name = name;
+			return i;
+		}
+	}
+	if (event_stats_num == EVENT_STATS_MAX - 1) {
+		/* Table full, account the remaining handlers together. */
+		event_stats[EVENT_STATS_MAX - 1].name = _T("other");
+		return EVENT_STATS_MAX - 1;
+	}
+	event_stats[event_stats_num].handler = func;
+	event_stats[event_stats_num].name = name;
+	return event_stats_num++;
+}
+
+void event_stats_add (int stat, frame_time_t start)
+{
+	struct event_stat *st = &event_stats[stat];
+	st->time += read_processor_time () - start;
+	st->fires++;
+	st->frame_fires++;
+}
+
+void events_stats_vsync (void)
+{
+	for (int i = 0; i < event_stats_num; i++) {
+		struct event_stat *st = &event_stats[i];
+		if (st->frame_fires > st->peak_frame_fires)
+			st->peak_frame_fires = st->frame_fires;
+		st->frame_fires = 0;
+	}
+	event_stats_frames++;
+}
+
+int events_get_stats (struct event_stat *st, int max, uae_u32 *frames)
+{
+	int num = event_stats_num < max ? event_stats_num : max;
+	memcpy (st, event_stats, num * sizeof (struct event_stat));
+	if (frames)
+		*frames = event_stats_frames;
+	return num;
+}
+
+void events_reset_stats (void)
+{
+	for (int i = 0; i < event_stats_num; i++) {
+		struct event_stat *st = &event_stats[i];
+		st->fires = 0;
+		st->frame_fires = 0;
+		st->peak_frame_fires = 0;
+		st->time = 0;
+	}
+	event_stats_frames = 0;
+}
+
+#endif /* EVENT_STATS */
+
 int current_hpos (void)
 {
 	int hp = current_hpos_safe ();
@@ -621,6 +621,17 @@ static inline void set_fpucw_x87(uae_u32 m68k_cw)
 
 static void native_set_fpucw(uae_u32 m68k_cw)
 {
+#ifdef JIT
+	/* JIT SSE2 FPU code is only compiled for round to nearest */
+	static uae_u32 jit_fpu_rounding;
+	if ((m68k_cw ^ jit_fpu_rounding) & 0x30) {
+		jit_fpu_rounding = m68k_cw & 0x30;
+		if (currprefs.cachesize && currprefs.comp_fpu_sse2) {
+			flush_icache_hard (0, 3);
+			set_special (SPCFLAG_END_COMPILE);
+		}
+	}
+#endif
 #ifdef WITH_SOFTFLOAT
 	if (currprefs.fpu_softfloat) {
 		set_fpucw_softfloat(m68k_cw);
@@ -0,0 +1,282 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <uae/uae.h>
+#include <fs/emu.h>
+#include <fs/log.h>
+#include <fs/glib.h>
+#include <fs/filesys.h>
+#include "fs-uae.h"
+#include "options.h"
+#include "benchmark.h"
+
+#define DEFAULT_CHECKPOINT_FRAMES 250
+
+typedef struct checkpoint {
+    int frame;
+    uint32_t ram;
+    uint32_t video;
+    int have_video;
+} checkpoint;
+
+static int g_enabled;
+static int g_finished;
+static int g_failed;
+static int g_completed;
+static char *g_recording;
+static char *g_report;
+static char *g_name;
+static int g_max_frames;
+static int g_checkpoint_frames;
+static int64_t g_start_time;
+static int64_t g_stop_time;
+static int g_frames;
+static GArray *g_checkpoints;
+/* Index of the checkpoint waiting for the next rendered frame, or -1 */
+static int g_video_pending = -1;
+
+int fs_uae_benchmark_enabled(void)
+{
+    return g_enabled;
+}
+
+int fs_uae_benchmark_exit_code(void)
+{
+    if (!g_enabled) {
+        return 0;
+    }
+    return g_failed || !g_completed ? 1 : 0;
+}
+
+void fs_uae_benchmark_init(void)
+{
+    const char *recording = fs_config_get_const_string(
+            OPTION_BENCHMARK_RECORDING);
+    int frames = fs_config_get_int(OPTION_BENCHMARK_FRAMES);
+    if (frames == FS_CONFIG_NONE || frames < 0) {
+        frames = 0;
+    }
+    if (!recording && frames == 0) {
+        return;
+    }
+    g_enabled = 1;
+    g_max_frames = frames;
+    if (recording) {
+        g_recording = fs_uae_expand_path(recording);
+    }
+    const char *report = fs_config_get_const_string(OPTION_BENCHMARK_REPORT);
+    if (report) {
+        g_report = fs_uae_expand_path(report);
+    }
+    const char *name = fs_config_get_const_string(OPTION_BENCHMARK_NAME);
+    if (name) {
+        g_name = g_strdup(name);
+    } else if (g_recording) {
+        g_name = g_path_get_basename(g_recording);
+        char *ext = strrchr(g_name, '.');
+        if (ext && ext != g_name) {
+            *ext = '\0';
+        }
+    } else {
+        g_name = g_strdup("default");
+    }
+    g_checkpoint_frames = fs_config_get_int(
+            OPTION_BENCHMARK_CHECKPOINT_FRAMES);
+    if (g_checkpoint_frames == FS_CONFIG_NONE || g_checkpoint_frames < 0) {
+        g_checkpoint_frames = DEFAULT_CHECKPOINT_FRAMES;
+    }
+    g_checkpoints = g_array_new(FALSE, TRUE, sizeof(checkpoint));
+
+    /* Run unthrottled and without audio output, unless the user has
+     * explicitly configured the benchmark option otherwise. */
+    fs_config_set_string_if_unset("benchmark", "1");
+
+    fs_log("[BENCHMARK] Scenario %s, recording %s, frames %d, "
+           "checkpoint every %d frames\n", g_name,
+           g_recording ? g_recording : "(none)", g_max_frames,
+           g_checkpoint_frames);
+}
+
+void fs_uae_benchmark_configure_amiga(void)
+{
+    if (!g_enabled || !g_recording) {
+        return;
+    }
+    if (!fs_path_exists(g_recording)) {
+        fs_log("[BENCHMARK] Recording %s does not exist\n", g_recording);
+        g_failed = 1;
+        return;
+    }
+    amiga_replay_input_recording(g_recording);
+}
+
+static void add_checkpoint(int frame)
+{
+    checkpoint cp;
+    memset(&cp, 0, sizeof(cp));
+    cp.frame = frame;
+    cp.ram = amiga_get_state_checksum();
+    g_array_append_val(g_checkpoints, cp);
+    g_video_pending = g_checkpoints->len - 1;
+}
+
+/* FNV-1a over 32-bit words; the frame buffer size is always a multiple of
+ * four bytes, and hashing bytes would make checkpoint frames noticeably
+ * slower than the others. */
+static uint32_t hash_pixels(const unsigned char *pixels, size_t size)
+{
+    const uint32_t *p = (const uint32_t *) pixels;
+    const uint32_t *end = p + size / 4;
+    uint32_t hash = 2166136261u;
+    while (p < end) {
+        hash = (hash ^ *p++) * 16777619u;
+    }
+    return hash;
+}
+
+void fs_uae_benchmark_render(RenderData *rd)
+{
+    if (g_video_pending < 0) {
+        return;
+    }
+    checkpoint *cp = &g_array_index(g_checkpoints, checkpoint,
+                                    g_video_pending);
+    g_video_pending = -1;
+    if (rd->pixels == NULL) {
+        return;
+    }
+    cp->video = hash_pixels(rd->pixels,
+            (size_t) rd->width * rd->height * rd->bpp);
+    cp->have_video = 1;
+}
+
+void fs_uae_benchmark_frame(int frame)
+{
+    if (!g_enabled || g_finished) {
+        return;
+    }
+    if (frame == 1) {
+        if (g_recording && !amiga_input_replay_active()) {
+            fs_log("[BENCHMARK] Could not start replay of %s\n",
+                   g_recording);
+            g_failed = 1;
+            fs_uae_benchmark_finish();
+            fs_emu_quit();
+            return;
+        }
+        g_start_time = fs_emu_monotonic_time();
+        return;
+    }
+    g_frames = frame - 1;
+    if (g_checkpoint_frames > 0 && g_frames % g_checkpoint_frames == 0) {
+        add_checkpoint(frame);
+    }
+    if (g_max_frames > 0 && g_frames >= g_max_frames) {
+        fs_log("[BENCHMARK] Frame limit reached\n");
+        g_completed = 1;
+    } else if (g_recording && !amiga_input_replay_active()) {
+        fs_log("[BENCHMARK] End of recording reached\n");
+        g_completed = 1;
+    } else {
+        return;
+    }
+    fs_uae_benchmark_finish();
+    fs_emu_quit();
+}
+
+static void write_json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; s && *s; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            fprintf(f, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+static void write_report(double seconds, double fps)
+{
+    char cpu[64];
+    char chipset[64];
+    amiga_get_hardware_modes(cpu, sizeof(cpu), chipset, sizeof(chipset));
+
+    FILE *f = g_fopen(g_report, "wb");
+    if (f == NULL) {
+        fs_log("[BENCHMARK] Could not open %s for writing\n", g_report);
+        g_failed = 1;
+        return;
+    }
+    const char *model = fs_config_get_const_string(OPTION_AMIGA_MODEL);
+    fprintf(f, "{\n  \"scenario\": ");
+    write_json_string(f, g_name);
+    fprintf(f, ",\n  \"recording\": ");
+    write_json_string(f, g_recording ? g_recording : "");
+    fprintf(f, ",\n  \"version\": ");
+    write_json_string(f, PACKAGE_VERSION);
+    fprintf(f, ",\n  \"amiga_model\": ");
+    write_json_string(f, model ? model : "A500");
+    fprintf(f, ",\n  \"cpu\": ");
+    write_json_string(f, cpu);
+    fprintf(f, ",\n  \"chipset\": ");
+    write_json_string(f, chipset);
+    fprintf(f, ",\n  \"completed\": %s", g_completed ? "true" : "false");
+    fprintf(f, ",\n  \"failed\": %s", g_failed ? "true" : "false");
+    fprintf(f, ",\n  \"frames\": %d", g_frames);
+    fprintf(f, ",\n  \"seconds\": %0.3f", seconds);
+    fprintf(f, ",\n  \"fps\": %0.2f", fps);
+    fprintf(f, ",\n  \"checkpoints\": [");
+    for (unsigned int i = 0; i < g_checkpoints->len; i++) {
+        checkpoint *cp = &g_array_index(g_checkpoints, checkpoint, i);
+        fprintf(f, "%s\n    {\"frame\": %d, \"ram\": \"%06x\"",
+                i == 0 ? "" : ",", cp->frame, cp->ram);
+        if (cp->have_video) {
+            fprintf(f, ", \"video\": \"%08x\"", cp->video);
+        }
+        fprintf(f, "}");
+    }
+    fprintf(f, "%s]\n}\n", g_checkpoints->len ? "\n  " : "");
+    fclose(f);
+    fs_log("[BENCHMARK] Wrote report to %s\n", g_report);
+}
+
+void fs_uae_benchmark_finish(void)
+{
+    if (!g_enabled || g_finished) {
+        return;
+    }
+    g_finished = 1;
+    g_stop_time = fs_emu_monotonic_time();
+    double seconds = 0.0;
+    if (g_start_time > 0) {
+        seconds = (g_stop_time - g_start_time) / 1000000.0;
+    }
+    double fps = seconds > 0.0 ? g_frames / seconds : 0.0;
+    if (!g_completed && g_recording && g_start_time > 0 &&
+            !amiga_input_replay_active()) {
+        /* The recording ended with a quit event */
+        g_completed = 1;
+    }
+    if (!g_completed && !g_failed) {
+        fs_log("[BENCHMARK] Emulation stopped before the end of the "
+               "benchmark\n");
+    }
+    fs_log("[BENCHMARK] %s: %d frames in %0.3f seconds, %0.2f fps, "
+           "%d checkpoints\n", g_name, g_frames, seconds, fps,
+           g_checkpoints->len);
+    printf("benchmark %s: %d frames, %0.3f s, %0.2f fps\n",
+           g_name, g_frames, seconds, fps);
+    if (g_report) {
+        write_report(seconds, fps);
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef FS_UAE_BENCHMARK_H
+#define FS_UAE_BENCHMARK_H
+
+#include <uae/uae.h>
+
+/* Benchmark mode. When benchmark_recording or benchmark_frames is set, the
+ * emulator replays the input recording (or just runs) unthrottled in
+ * deterministic mode, checksums RAM and video output at regular
+ * checkpoints, and writes a report with the emulated frame rate to
+ * benchmark_report before quitting. */
+
+void fs_uae_benchmark_init(void);
+int fs_uae_benchmark_enabled(void);
+void fs_uae_benchmark_configure_amiga(void);
+void fs_uae_benchmark_frame(int frame);
+void fs_uae_benchmark_render(RenderData *rd);
+void fs_uae_benchmark_finish(void);
+int fs_uae_benchmark_exit_code(void);
+
+#endif /* FS_UAE_BENCHMARK_H */
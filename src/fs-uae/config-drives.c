@@ -291,6 +291,20 @@ static void configure_hard_drive_image(
 
     char *uae_controller = resolve_controller(controller);
 
+    key = g_strdup_printf("hard_drive_%d_overlay", index);
+    char *overlay = fs_config_get_string(key);
+    g_free(key);
+    if (overlay) {
+        overlay = fs_uae_expand_path_and_free(overlay);
+        if (read_only) {
+            fs_emu_log("ignoring overlay for read-only hard drive\n");
+        } else {
+            fs_emu_log("overlay: %s\n", overlay);
+            amiga_add_hard_drive_overlay(path, overlay);
+        }
+        g_free(overlay);
+    }
+
     fs_emu_log("hard drive file: %s\n", path);
     fs_emu_log("rdb mode: %d\n", rdb_mode);
     fs_emu_log("device: %s\n", device);
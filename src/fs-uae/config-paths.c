@@ -86,6 +86,20 @@ void fs_uae_configure_directories(void)
 
     amiga_set_save_image_dir(fs_uae_state_dir());
     amiga_set_module_ripper_dir(fs_uae_module_ripper_dir());
+
+    const char *shared_rom_dir = fs_config_get_const_string(
+            OPTION_SHARED_ROM_DIR);
+    if (shared_rom_dir && shared_rom_dir[0]) {
+        char *expanded_path = fs_uae_expand_path(shared_rom_dir);
+        path = fs_uae_resolve_path(expanded_path, FS_UAE_DIR_PATHS);
+        free(expanded_path);
+        if (g_mkdir_with_parents(path, 0755) == 0) {
+            amiga_set_shared_rom_dir(path);
+        } else {
+            fs_log("WARNING: could not create shared ROM dir %s\n", path);
+        }
+        free(path);
+    }
 }
 
 void fs_uae_set_uae_paths(void)
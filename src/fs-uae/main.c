@@ -34,6 +34,8 @@
 #include "options.h"
 #include "paths.h"
 #include "config-drives.h"
+#include "benchmark.h"
+#include "zygote.h"
 #ifdef WITH_CEF
 #include <fs/emu/cef.h>
 #endif
@@ -224,6 +226,56 @@ void fs_uae_process_input_event(int line, int action, int state, int playback)
 
 int g_fs_uae_frame = 0;
 
+/* Host input events are timestamped when queued. With input_timing
+ * enabled, events which arrived during the previous host frame interval
+ * are spread over the input polls (every 64 lines) of the current
+ * emulated frame, so that an event which happened halfway through the
+ * interval is seen by the Amiga halfway down the frame, instead of all
+ * events being applied at once on the next input poll. */
+
+static struct {
+    int enabled;
+    int64_t frame_time;
+    int64_t frame_duration;
+    int frame_lines;
+    int max_line;
+} g_input_timing = { -1, 0, 0, 313, 0 };
+
+static void input_timing_new_frame(void)
+{
+    if (g_input_timing.enabled == -1) {
+        g_input_timing.enabled = fs_config_true(OPTION_INPUT_TIMING) &&
+                !fs_emu_netplay_enabled();
+        fs_log("[INPUT] Timestamped input placement: %d\n",
+                g_input_timing.enabled);
+    }
+    int64_t now = fs_emu_monotonic_time();
+    if (g_input_timing.frame_time) {
+        g_input_timing.frame_duration = now - g_input_timing.frame_time;
+    }
+    g_input_timing.frame_time = now;
+    if (g_input_timing.max_line > 0) {
+        g_input_timing.frame_lines = g_input_timing.max_line + 1;
+    }
+    g_input_timing.max_line = 0;
+}
+
+/* Returns the line in the current frame where an event queued at host
+ * time t should be applied. Events outside of the previous frame interval
+ * are due immediately; an event is never held back past its line. */
+static int input_timing_line(int64_t t)
+{
+    if (g_input_timing.enabled != 1 || g_input_timing.frame_duration <= 0) {
+        return 0;
+    }
+    int64_t start = g_input_timing.frame_time - g_input_timing.frame_duration;
+    if (t < start || t >= g_input_timing.frame_time) {
+        return 0;
+    }
+    return (int) ((t - start) * g_input_timing.frame_lines /
+            g_input_timing.frame_duration);
+}
+
 static int input_handler_loop(int line)
 {
     static int last_frame = -1;
@@ -235,12 +287,21 @@ static int input_handler_loop(int line)
         last_frame = g_fs_uae_frame;
     }
 
+    if (line > g_input_timing.max_line) {
+        g_input_timing.max_line = line;
+    }
+
     // FIXME: Move to another place?
     uae_clipboard_update();
 
     int action;
+    int64_t time;
     //int reconfigure_input = 0;
-    while ((action = fs_emu_get_input_event()) != 0) {
+    while ((action = fs_emu_peek_input_event(&time)) != 0) {
+        if (input_timing_line(time) > line) {
+            break;
+        }
+        fs_emu_get_input_event();
         //printf("event_handler_loop received input action %d\n", action);
         int istate = (action & 0x00ff0000) >> 16;
         // force to -128 to 127 range
@@ -353,6 +414,9 @@ static void event_handler(int line)
     //fs_emu_lua_run_handler("on_fs_uae_frame_start");
 
     fs_emu_wait_for_frame(g_fs_uae_frame);
+    input_timing_new_frame();
+    fs_uae_zygote_frame(g_fs_uae_frame);
+    fs_uae_benchmark_frame(g_fs_uae_frame);
     if (g_fs_uae_frame == 1) {
         if (!fs_emu_netplay_enabled()) {
             if (fs_config_true(OPTION_WARP_MODE)) {
@@ -576,6 +640,8 @@ static void on_init(void)
 
     fs_uae_set_uae_paths();
     fs_uae_read_custom_uae_options(fs_uae_argc, fs_uae_argv);
+    fs_uae_zygote_configure_amiga();
+    fs_uae_benchmark_configure_amiga();
 
     char *uae_file;
 
@@ -1160,6 +1226,11 @@ int main(int argc, char *argv[])
     fs_emu_set_state_check_function(amiga_get_state_checksum);
     fs_emu_set_rand_check_function(amiga_get_rand_checksum);
 
+    /* In zygote mode, this only returns in the forked instances, which
+     * then continue with directories, logging and video/audio/input
+     * initialization using their own request options. */
+    fs_uae_zygote_run();
+
     // force creation of some recommended default directories
     fs_uae_kickstarts_dir();
     fs_uae_configurations_dir();
@@ -1181,7 +1252,8 @@ int main(int argc, char *argv[])
         fs_emu_set_controllers_dir(controllers_dir);
     }
     const char *logs_dir = fs_uae_logs_dir();
-    if (logs_dir) {
+    /* Zygote instances have already switched to their own log file. */
+    if (logs_dir && !fs_uae_zygote_has_log_file()) {
         char *log_file;
 
         log_file = g_build_filename(logs_dir, "FS-UAE.log", NULL);
@@ -1211,6 +1283,9 @@ int main(int argc, char *argv[])
 
     fs_emu_set_pause_function(pause_function);
 
+    // must be called before fse_init, may enable the benchmark option
+    fs_uae_benchmark_init();
+
     //fs_uae_init_input();
     fse_init(FS_EMU_INIT_EVERYTHING);
 
@@ -1229,7 +1304,7 @@ int main(int argc, char *argv[])
     } else {
         fs_log("not running in record mode\n");
     }
-    if (fs_emu_netplay_enabled() ||
+    if (fs_emu_netplay_enabled() || fs_uae_benchmark_enabled() ||
             fs_config_get_boolean(OPTION_DETERMINISTIC) == 1) {
         deterministic_mode = 1;
     }
@@ -1237,6 +1312,16 @@ int main(int argc, char *argv[])
         amiga_set_deterministic_mode();
     }
 
+    int run_ahead = fs_config_get_int_clamped(OPTION_RUN_AHEAD, 0, 4);
+    if (run_ahead != FS_CONFIG_NONE && run_ahead > 0) {
+        if (deterministic_mode) {
+            fs_log("run_ahead is not supported in deterministic mode\n");
+        } else {
+            fs_log("Setting run-ahead to %d frames\n", run_ahead);
+            amiga_set_int_option("runahead", run_ahead);
+        }
+    }
+
     if (logs_dir) {
         if (fs_emu_netplay_enabled()) {
             char *sync_log_file = g_build_filename(logs_dir,
@@ -1322,6 +1407,7 @@ int main(int argc, char *argv[])
 
     fs_emu_run(main_function);
     fs_log("fs-uae shutting down, fs_emu_run returned\n");
+    fs_uae_benchmark_finish();
     if (g_rmdir(fs_uae_state_dir()) == 0) {
         fs_log("state dir %s was removed because it was empty\n",
                 fs_uae_state_dir());
@@ -1336,5 +1422,5 @@ int main(int argc, char *argv[])
 #ifdef WITH_CEF
     cef_destroy();
 #endif
-    return 0;
+    return fs_uae_benchmark_exit_code();
 }
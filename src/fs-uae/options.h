@@ -6,6 +6,11 @@
 #define OPTION_ACCELERATOR_MEMORY "accelerator_memory"
 #define OPTION_ACCURACY "accuracy"
 #define OPTION_AMIGA_MODEL "amiga_model"
+#define OPTION_BENCHMARK_CHECKPOINT_FRAMES "benchmark_checkpoint_frames"
+#define OPTION_BENCHMARK_FRAMES "benchmark_frames"
+#define OPTION_BENCHMARK_NAME "benchmark_name"
+#define OPTION_BENCHMARK_RECORDING "benchmark_recording"
+#define OPTION_BENCHMARK_REPORT "benchmark_report"
 #define OPTION_BLIZZARD_SCSI_KIT "blizzard_scsi_kit"
 #define OPTION_BSDSOCKET_LIBRARY "bsdsocket_library"
 #define OPTION_CDFS "cdfs"
@@ -27,6 +32,7 @@
 #define OPTION_GRAPHICS_CARD "graphics_card"
 #define OPTION_GRAPHICS_CARD_ROM "graphics_card_rom"
 #define OPTION_GRAPHICS_CARD_MEMORY "graphics_card_memory"
+#define OPTION_INPUT_TIMING "input_timing"
 #define OPTION_JIT_COMPILER "jit_compiler"
 #define OPTION_JIT_MEMORY "jit_memory"
 #define OPTION_JOYSTICK_PORT_0_AUTOSWITCH "joystick_port_0_autoswitch"
@@ -40,8 +46,10 @@
 #define OPTION_NETWORK_CARD "network_card"
 #define OPTION_PARALLEL_PORT "parallel_port"
 #define OPTION_RELATIVE_PATHS "relative_paths"
+#define OPTION_RUN_AHEAD "run_ahead"
 #define OPTION_SAVE_STATES "save_states"
 #define OPTION_SERIAL_PORT "serial_port"
+#define OPTION_SHARED_ROM_DIR "shared_rom_dir"
 #define OPTION_SLOW_MEMORY "slow_memory"
 #define OPTION_SOUND_CARD "sound_card"
 #define OPTION_STEREO_SEPARATION "stereo_separation"
@@ -51,6 +59,9 @@
 #define OPTION_WARP_MODE "warp_mode"
 #define OPTION_WORKBENCH_DISK "workbench_disk"
 #define OPTION_ZORRO_III_MEMORY "zorro_iii_memory"
+#define OPTION_ZYGOTE_CHECKPOINT_FRAMES "zygote_checkpoint_frames"
+#define OPTION_ZYGOTE_SOCKET "zygote_socket"
+#define OPTION_ZYGOTE_STATE "zygote_state"
 
 /* Deprecated options */
 
@@ -5,11 +5,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <uae/uae.h>
 #include <fs/emu.h>
 #include <fs/emu/buffer.h>
 #include <fs/emu/video.h>
 #include <fs/i18n.h>
+#include "benchmark.h"
 #include "fs-uae.h"
 #include "options.h"
 
@@ -298,102 +302,185 @@ static int modify_coordinates(int *cx, int *cy, int *cw, int *ch)
 }
 
 #define SUBSCAN
+#define SUBSCAN_SETTLE_FRAMES 50
+#define SUBSCAN_INTERVAL 25
+
+static int g_subscan_frames = 0;
 
 #ifdef SUBSCAN
-static void narrow_rect(RenderData* rd, int *nx, int *ny, int *nw, int *nh)
+
+/* The sub-scan border detector walks the frame in row-major order only:
+ * every helper below scans one contiguous row segment and stops at the
+ * first pixel which differs from the border colour. */
+
+static int find_left_32(const uint32_t *row, int n, uint32_t border)
 {
-    if (rd->bpp != 4) {
-        // not implemented for 16-bit video.
-        return;
+    int i = 0;
+#ifdef __SSE2__
+    __m128i b = _mm_set1_epi32(border);
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (row + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, b)) != 0xffff) {
+            break;
+        }
     }
-#if 0
-    int64_t t1 = fs_get_monotonic_time();
 #endif
-    int x = *nx;
-    int y = *ny;
-    int w = *nw;
-    int h = *nh;
-
-    uint32_t *ibuffer = (uint32_t *) rd->pixels;
-    uint32_t *p1, *p;
-    uint32_t cmpval;
-
-    p1 = ibuffer + y * rd->width + x;
-    cmpval = 0;
-    for (int i = 0; i < h; i++) {
-        cmpval += *p1;
+    for (; i < n; i++) {
+        if (row[i] != border) {
+            break;
+        }
     }
-    while (w > 0) {
-        p = p1;
-        uint32_t val = 0;
-        for (int i = 0; i < h; i++) {
-            val = val + *p;
-            p += rd->width;
+    return i;
+}
+
+static int find_right_32(const uint32_t *row, int start, int n,
+        uint32_t border)
+{
+    int i = n;
+#ifdef __SSE2__
+    __m128i b = _mm_set1_epi32(border);
+    for (; i - 4 >= start; i -= 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (row + i - 4));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, b)) != 0xffff) {
+            break;
         }
-        if (val != cmpval) {
+    }
+#endif
+    for (; i > start; i--) {
+        if (row[i - 1] != border) {
             break;
         }
-        x = x + 1;
-        w = w - 1;
-        p1 += 1;
     }
+    return i;
+}
 
-    p1 = ibuffer + y * rd->width + x + w - 1;
-    cmpval = 0;
-    for (int i = 0; i < h; i++) {
-        cmpval += *p1;
-    }
-    while (w > 0) {
-        p = p1;
-        uint32_t val = 0;
-        for (int i = 0; i < h; i++) {
-            val = val + *p;
-            p += rd->width;
+static int find_left_16(const uint16_t *row, int n, uint16_t border)
+{
+    int i = 0;
+#ifdef __SSE2__
+    __m128i b = _mm_set1_epi16(border);
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (row + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(v, b)) != 0xffff) {
+            break;
         }
-        if (val != cmpval) {
+    }
+#endif
+    for (; i < n; i++) {
+        if (row[i] != border) {
             break;
         }
-        w = w - 1;
-        p1 -= 1;
     }
+    return i;
+}
 
-    p1 = ibuffer + y * rd->width + x;
-    cmpval = 0;
-    for (int i = 0; i < w; i++) {
-        cmpval += *p1;
-    }
-    while (h > 0) {
-        p = p1;
-        uint32_t val = 0;
-        for (int i = 0; i < w; i++) {
-            val = val + *p;
-            p++;
+static int find_right_16(const uint16_t *row, int start, int n,
+        uint16_t border)
+{
+    int i = n;
+#ifdef __SSE2__
+    __m128i b = _mm_set1_epi16(border);
+    for (; i - 8 >= start; i -= 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (row + i - 8));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(v, b)) != 0xffff) {
+            break;
         }
-        if (val != cmpval) {
+    }
+#endif
+    for (; i > start; i--) {
+        if (row[i - 1] != border) {
             break;
         }
-        y = y + 1;
-        h = h - 1;
-        p1 += rd->width;
     }
+    return i;
+}
 
-    p1 = ibuffer + (y + h - 1) * rd->width + x;
-    cmpval = 0;
-    for (int i = 0; i < w; i++) {
-        cmpval += *p1;
+/* Returns the index of the first non-border pixel in row[0..n), or n. */
+static int find_left(RenderData* rd, int x, int y, int n, uint32_t border)
+{
+    if (rd->bpp == 4) {
+        return find_left_32((uint32_t *) rd->pixels + y * rd->width + x,
+                n, border);
     }
-    while (h > 0) {
-        p = p1;
-        uint32_t val = 0;
-        for (int i = 0; i < w; i++) {
-            val = val + *p;
-            p++;
-        }
-        if (val != cmpval) {
-            break;
+    return find_left_16((uint16_t *) rd->pixels + y * rd->width + x,
+            n, border);
+}
+
+/* Returns one past the last non-border pixel in row[start..n), or start. */
+static int find_right(RenderData* rd, int x, int y, int start, int n,
+        uint32_t border)
+{
+    if (rd->bpp == 4) {
+        return find_right_32((uint32_t *) rd->pixels + y * rd->width + x,
+                start, n, border);
+    }
+    return find_right_16((uint16_t *) rd->pixels + y * rd->width + x,
+            start, n, border);
+}
+
+static void narrow_rect(RenderData* rd, int *nx, int *ny, int *nw, int *nh)
+{
+    if (rd->bpp != 4 && rd->bpp != 2) {
+        return;
+    }
+#if 0
+    int64_t t1 = fs_get_monotonic_time();
+#endif
+    int x = *nx;
+    int y = *ny;
+    int w = *nw;
+    int h = *nh;
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+
+    /* The top-left pixel of the DIW rectangle is taken as border colour. */
+    uint32_t border;
+    if (rd->bpp == 4) {
+        border = ((uint32_t *) rd->pixels)[y * rd->width + x];
+    } else {
+        border = ((uint16_t *) rd->pixels)[y * rd->width + x];
+    }
+
+    int top = 0;
+    while (top < h && find_left(rd, x, y + top, w, border) == w) {
+        top++;
+    }
+    if (top == h) {
+        /* Only border, collapse the rectangle like before. */
+        x = x + w;
+        y = y + h;
+        w = 0;
+        h = 0;
+    } else {
+        int bottom = h - 1;
+        while (bottom > top &&
+                find_left(rd, x, y + bottom, w, border) == w) {
+            bottom--;
+        }
+        /* Both edge scans are limited to the part of each row which can
+         * still widen the result, so once the picture edges have been
+         * found, most rows only touch a few pixels at each end. */
+        int left = w;
+        int right = 0;
+        for (int i = top; i <= bottom; i++) {
+            if (left > 0) {
+                int l = find_left(rd, x, y + i, left, border);
+                if (l < left) {
+                    left = l;
+                }
+            }
+            if (right < w) {
+                int r = find_right(rd, x, y + i, right, w, border);
+                if (r > right) {
+                    right = r;
+                }
+            }
         }
-        h = h - 1;
-        p1 -= rd->width;
+        x = x + left;
+        w = right - left;
+        y = y + top;
+        h = bottom - top + 1;
     }
 
     static int px = 0, py = 0, pw = 0, ph = 0;
@@ -436,6 +523,7 @@ static void render_screen(RenderData* rd)
 
     rd_width = rd->width;
     rd_height = rd->height;
+    fs_uae_benchmark_render(rd);
 
     g_buffer->seq = g_frame_seq_no++;
     g_buffer->width = rd_width;
@@ -448,10 +536,8 @@ static void render_screen(RenderData* rd)
         }
     }
 
-    if (fse_drivers()) {
-
-    } else {
-        memcpy(g_buffer->line, rd->line, AMIGA_MAX_LINES);
+    memcpy(g_buffer->line, rd->line, AMIGA_MAX_LINES);
+    if (!fse_drivers()) {
         fs_emu_video_buffer_update_lines(g_buffer);
     }
 
@@ -476,12 +562,23 @@ static void render_screen(RenderData* rd)
     ch <<= vshift;
 
     int cchange = lastcx != cx || lastcy != cy || lastcw != cw || lastch != ch;
-    if (cchange || lastsubscan) {
+    int subscan_due = 0;
+    if (lastsubscan) {
+        /* The DIW limits are the primary crop source. Sub-scan overrides
+         * also look at the pixels, which may settle a few frames after
+         * the limits changed, so scan every frame for a short while and
+         * then only now and then, instead of on every frame. */
+        g_subscan_frames++;
+        subscan_due = g_subscan_frames < SUBSCAN_SETTLE_FRAMES ||
+                g_subscan_frames % SUBSCAN_INTERVAL == 0;
+    }
+    if (cchange || subscan_due) {
         if (cchange) {
             lastcx = cx;
             lastcy = cy;
             lastcw = cw;
             lastch = ch;
+            g_subscan_frames = 0;
         }
         lastsubscan = 0;
         struct WindowOverride* wo = NULL;
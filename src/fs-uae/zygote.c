@@ -0,0 +1,284 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <uae/uae.h>
+#include <fs/emu.h>
+#include <fs/log.h>
+#include <fs/glib.h>
+#include <fs/filesys.h>
+#include "fs-uae.h"
+#include "options.h"
+#include "zygote.h"
+
+#ifndef WINDOWS
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+
+#define ZYGOTE_NONE 0
+#define ZYGOTE_BUILDER 1
+#define ZYGOTE_CHILD 2
+
+#define MAX_REQUEST_SIZE (64 * 1024)
+#define DEFAULT_CHECKPOINT_FRAMES (50 * 20)
+
+static int g_zygote_mode;
+static char *g_checkpoint_path;
+static int g_checkpoint_frames;
+static char *g_child_log_file;
+
+int fs_uae_zygote_has_log_file(void)
+{
+    return g_child_log_file != NULL;
+}
+
+void fs_uae_zygote_configure_amiga(void)
+{
+    if (g_zygote_mode == ZYGOTE_BUILDER) {
+        fs_log("[ZYGOTE] Will save checkpoint to %s after %d frames\n",
+               g_checkpoint_path, g_checkpoint_frames);
+    } else if (g_zygote_mode == ZYGOTE_CHILD && g_checkpoint_path) {
+        fs_log("[ZYGOTE] Starting from checkpoint %s\n", g_checkpoint_path);
+        amiga_set_option("statefile", g_checkpoint_path);
+    }
+}
+
+void fs_uae_zygote_frame(int frame)
+{
+    if (g_zygote_mode == ZYGOTE_BUILDER && frame == g_checkpoint_frames) {
+        /* The state is saved here and not with statefile_quit, since
+         * uae_reset clears quitstatefile on the first reset. */
+        fs_log("[ZYGOTE] Checkpoint frame reached, saving %s\n",
+               g_checkpoint_path);
+        if (!amiga_state_save_file(g_checkpoint_path)) {
+            fs_log("[ZYGOTE] Could not save checkpoint\n");
+            g_unlink(g_checkpoint_path);
+        }
+        fs_emu_quit();
+    }
+}
+
+#ifndef WINDOWS
+
+/* Request format: "key = value" lines, terminated by an empty line or by
+ * the client shutting down its side of the connection. The options
+ * override the zygote configuration for the new instance. */
+static void read_request(int fd)
+{
+    char *buffer = g_malloc(MAX_REQUEST_SIZE + 1);
+    int size = 0;
+    while (size < MAX_REQUEST_SIZE) {
+        ssize_t result = read(fd, buffer + size, MAX_REQUEST_SIZE - size);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
+        }
+        size += result;
+        buffer[size] = '\0';
+        if (strstr(buffer, "\n\n") || strstr(buffer, "\r\n\r\n")) {
+            break;
+        }
+    }
+    buffer[size] = '\0';
+
+    char **lines = g_strsplit(buffer, "\n", 0);
+    for (char **line = lines; *line; line++) {
+        char *key = g_strstrip(*line);
+        if (key[0] == '\0' || key[0] == '#' || key[0] == ';') {
+            continue;
+        }
+        char *value = strchr(key, '=');
+        if (value == NULL) {
+            continue;
+        }
+        *value++ = '\0';
+        g_strstrip(key);
+        g_strstrip(value);
+        fs_log("[ZYGOTE] Request option %s = %s\n", key, value);
+        fs_config_set_string(key, value);
+    }
+    g_strfreev(lines);
+    g_free(buffer);
+}
+
+/* Instances must neither keep writing to the log file inherited from the
+ * zygote nor truncate each other's log files, so each instance logs to a
+ * file named after its pid. Called after the request options are set, so
+ * logs_dir from the request is used. */
+static void reopen_child_log(void)
+{
+    const char *logs_dir = fs_uae_logs_dir();
+    if (logs_dir == NULL) {
+        return;
+    }
+    char *name = g_strdup_printf("fs-uae-%d.log.txt", (int) getpid());
+    g_child_log_file = g_build_filename(logs_dir, name, NULL);
+    g_free(name);
+    fs_config_set_log_file(g_child_log_file);
+}
+
+static void build_checkpoint(void)
+{
+    fs_log("[ZYGOTE] Checkpoint %s does not exist, booting to create it\n",
+           g_checkpoint_path);
+    /* Do not let the child write out the parent's buffered output. */
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        g_zygote_mode = ZYGOTE_BUILDER;
+        return;
+    }
+    if (pid < 0) {
+        fs_log("[ZYGOTE] fork failed (%d)\n", errno);
+        return;
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (!fs_path_exists(g_checkpoint_path)) {
+        fs_log("[ZYGOTE] WARNING: checkpoint was not created, instances "
+               "will boot from scratch\n");
+        g_free(g_checkpoint_path);
+        g_checkpoint_path = NULL;
+    }
+}
+
+static void preload_checkpoint(void)
+{
+    /* Read the checkpoint once so it is in the page cache for the
+     * instances restoring it. */
+    FILE *f = g_fopen(g_checkpoint_path, "rb");
+    if (f == NULL) {
+        return;
+    }
+    char *buffer = g_malloc(65536);
+    int64_t total = 0;
+    size_t read;
+    while ((read = fread(buffer, 1, 65536, f)) > 0) {
+        total += read;
+    }
+    g_free(buffer);
+    fclose(f);
+    fs_log("[ZYGOTE] Checkpoint %s (%lld bytes) preloaded\n",
+           g_checkpoint_path, (long long) total);
+}
+
+static int create_socket(const char *path)
+{
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fs_log("[ZYGOTE] Socket path too long: %s\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fs_log("[ZYGOTE] socket failed (%d)\n", errno);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+            listen(fd, 16) != 0) {
+        fs_log("[ZYGOTE] Could not listen on %s (%d)\n", path, errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void fs_uae_zygote_run(void)
+{
+    const char *socket_path = fs_config_get_const_string(OPTION_ZYGOTE_SOCKET);
+    if (socket_path == NULL || socket_path[0] == '\0') {
+        return;
+    }
+    char *expanded_socket_path = fs_uae_expand_path(socket_path);
+
+    const char *state = fs_config_get_const_string(OPTION_ZYGOTE_STATE);
+    if (state && state[0]) {
+        g_checkpoint_path = fs_uae_expand_path(state);
+    }
+    g_checkpoint_frames = fs_config_get_int(OPTION_ZYGOTE_CHECKPOINT_FRAMES);
+    if (g_checkpoint_frames == FS_CONFIG_NONE || g_checkpoint_frames <= 0) {
+        g_checkpoint_frames = DEFAULT_CHECKPOINT_FRAMES;
+    }
+
+    if (g_checkpoint_path && !fs_path_exists(g_checkpoint_path)) {
+        build_checkpoint();
+        if (g_zygote_mode == ZYGOTE_BUILDER) {
+            g_free(expanded_socket_path);
+            return;
+        }
+    }
+    if (g_checkpoint_path) {
+        preload_checkpoint();
+    }
+
+    int listen_fd = create_socket(expanded_socket_path);
+    if (listen_fd < 0) {
+        exit(1);
+    }
+    fs_log("[ZYGOTE] Waiting for requests on %s\n", expanded_socket_path);
+    /* Instances are not waited for, let the system reap them. */
+    signal(SIGCHLD, SIG_IGN);
+
+    while (1) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EINTR) {
+                fs_log("[ZYGOTE] accept failed (%d)\n", errno);
+            }
+            continue;
+        }
+        fflush(NULL);
+        pid_t pid = fork();
+        if (pid == 0) {
+            signal(SIGCHLD, SIG_DFL);
+            close(listen_fd);
+            g_zygote_mode = ZYGOTE_CHILD;
+            read_request(fd);
+            reopen_child_log();
+            char reply[32];
+            int len = snprintf(reply, sizeof(reply), "%d\n", (int) getpid());
+            if (write(fd, reply, len) != len) {
+                fs_log("[ZYGOTE] Could not send reply\n");
+            }
+            close(fd);
+            g_free(expanded_socket_path);
+            return;
+        }
+        if (pid < 0) {
+            fs_log("[ZYGOTE] fork failed (%d)\n", errno);
+            if (write(fd, "error\n", 6) != 6) {
+                /* client went away */
+            }
+        } else {
+            fs_log("[ZYGOTE] Started instance %d\n", (int) pid);
+        }
+        close(fd);
+    }
+}
+
+#else
+
+void fs_uae_zygote_run(void)
+{
+    if (fs_config_get_const_string(OPTION_ZYGOTE_SOCKET)) {
+        fs_log("[ZYGOTE] Not supported on this platform\n");
+    }
+}
+
+#endif
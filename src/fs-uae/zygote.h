@@ -0,0 +1,14 @@
+#ifndef FS_UAE_ZYGOTE_H
+#define FS_UAE_ZYGOTE_H
+
+/* Fork server ("zygote") mode. When zygote_socket is set, the process
+ * stops after early initialization and forks a new emulator instance for
+ * each connection on the socket. Instances start from the checkpoint
+ * state given by zygote_state instead of booting from scratch. */
+
+void fs_uae_zygote_run(void);
+int fs_uae_zygote_has_log_file(void);
+void fs_uae_zygote_configure_amiga(void);
+void fs_uae_zygote_frame(int frame);
+
+#endif /* FS_UAE_ZYGOTE_H */
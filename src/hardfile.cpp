@@ -28,6 +28,7 @@
 #include "execio.h"
 #include "zfile.h"
 #include "ide.h"
+#include "ioqueue.h"
 #include "debug.h"
 
 #ifdef WITH_CHD
@@ -65,9 +66,7 @@ struct hardfileprivdata {
 	volatile uaecptr d_request[MAX_ASYNC_REQUESTS];
 	volatile int d_request_type[MAX_ASYNC_REQUESTS];
 	volatile uae_u32 d_request_data[MAX_ASYNC_REQUESTS];
-	smp_comm_pipe requests;
-	int thread_running;
-	uae_sem_t sync_sem;
+	volatile int thread_running;
 	uaecptr base;
 	int changenum;
 	uaecptr changeint;
@@ -83,7 +82,13 @@ STATIC_INLINE uae_u32 gl (uae_u8 *p)
 	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | (p[3] << 0);
 }
 
-static uae_sem_t change_sem;
+/* Per unit, so that I/O on one unit does not wait for another one. */
+static uae_sem_t change_sem[MAX_FILESYSTEM_UNITS];
+
+/* Requests of all units go through one shared queue, each unit is
+ * handled in order but different units are processed in parallel. */
+#define HARDFILE_QUEUE_LANES 4
+static struct ioqueue *hardfile_queue;
 
 static struct hardfileprivdata hardfpd[MAX_FILESYSTEM_UNITS];
 
@@ -447,21 +452,366 @@ static uae_u32 vhd_checksum (uae_u8 *p, int offset)
 static int hdf_write2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
 static int hdf_read2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
 
+/* Block cache shared by all open hardfiles. It sits in front of every
+ * backend (plain and archived images, VHD, CHD, real drives), above the
+ * per-handle read window of the host layer. Writes go through to the
+ * image, so the cache never holds dirty data and can always be dropped.
+ *
+ * Eviction is 2Q: blocks seen once go to a FIFO (A1in), blocks that are
+ * referenced again after falling out of it are promoted to an LRU list
+ * (Am). A1out remembers recently evicted A1in blocks without their data.
+ * Large sequential transfers bypass the cache so that they don't push
+ * out the bitmap and directory blocks filesystems keep rereading. */
+
+#define HDF_CACHE_BLOCK 4096
+#define HDF_CACHE_BYPASS (32 * 1024)
+
+#define HCL_NONE -1
+#define HCL_FREE 0
+#define HCL_A1IN 1
+#define HCL_AM 2
+#define HCL_A1OUT 3
+
+struct hdf_cache_entry
+{
+	struct hardfiledata *hfd;
+	uae_u64 block;
+	uae_u8 *data;
+	int list;
+	int prev, next;
+	int hnext;
+};
+
+struct hdf_cache_list
+{
+	int head, tail, count;
+};
+
+static uae_sem_t hc_sem;
+static bool hc_sem_valid;
+static int hc_users;
+static int hc_size;
+static int hc_slots, hc_kin, hc_kout;
+static uae_u8 *hc_data;
+static uae_u8 **hc_freedata;
+static int hc_freedatacount;
+static struct hdf_cache_entry *hc_entries;
+static int hc_numentries;
+static int *hc_hash;
+static int hc_hashmask;
+static struct hdf_cache_list hc_lists[4];
+
+static int hc_hashval (struct hardfiledata *hfd, uae_u64 block)
+{
+	uae_u64 v = ((uae_u64)(uintptr_t)hfd >> 4) ^ (block * 0x9e3779b97f4a7c15ULL);
+	return (int)(v >> 32) & hc_hashmask;
+}
+
+static void hc_unlink (int idx)
+{
+	struct hdf_cache_entry *e = &hc_entries[idx];
+	struct hdf_cache_list *l;
+
+	if (e->list == HCL_NONE)
+		return;
+	l = &hc_lists[e->list];
+	if (e->prev >= 0)
+		hc_entries[e->prev].next = e->next;
+	else
+		l->head = e->next;
+	if (e->next >= 0)
+		hc_entries[e->next].prev = e->prev;
+	else
+		l->tail = e->prev;
+	l->count--;
+	e->list = HCL_NONE;
+}
+
+static void hc_push (int list, int idx)
+{
+	struct hdf_cache_entry *e = &hc_entries[idx];
+	struct hdf_cache_list *l = &hc_lists[list];
+
+	e->list = list;
+	e->prev = -1;
+	e->next = l->head;
+	if (l->head >= 0)
+		hc_entries[l->head].prev = idx;
+	else
+		l->tail = idx;
+	l->head = idx;
+	l->count++;
+}
+
+static int hc_lookup (struct hardfiledata *hfd, uae_u64 block)
+{
+	int idx = hc_hash[hc_hashval (hfd, block)];
+	while (idx >= 0) {
+		struct hdf_cache_entry *e = &hc_entries[idx];
+		if (e->hfd == hfd && e->block == block)
+			return idx;
+		idx = e->hnext;
+	}
+	return -1;
+}
+
+static void hc_hash_remove (int idx)
+{
+	struct hdf_cache_entry *e = &hc_entries[idx];
+	int *pp = &hc_hash[hc_hashval (e->hfd, e->block)];
+	while (*pp >= 0) {
+		if (*pp == idx) {
+			*pp = e->hnext;
+			break;
+		}
+		pp = &hc_entries[*pp].hnext;
+	}
+	e->hnext = -1;
+}
+
+static void hc_release_data (struct hdf_cache_entry *e)
+{
+	if (e->data) {
+		hc_freedata[hc_freedatacount++] = e->data;
+		e->data = NULL;
+	}
+}
+
+static void hc_remove (int idx)
+{
+	struct hdf_cache_entry *e = &hc_entries[idx];
+	hc_unlink (idx);
+	hc_hash_remove (idx);
+	hc_release_data (e);
+	e->hfd = NULL;
+	hc_push (HCL_FREE, idx);
+}
+
+static uae_u8 *hc_alloc_data (void)
+{
+	if (!hc_freedatacount) {
+		if (hc_lists[HCL_A1IN].count > hc_kin || !hc_lists[HCL_AM].count) {
+			int idx = hc_lists[HCL_A1IN].tail;
+			hc_unlink (idx);
+			hc_release_data (&hc_entries[idx]);
+			hc_push (HCL_A1OUT, idx);
+			if (hc_lists[HCL_A1OUT].count > hc_kout)
+				hc_remove (hc_lists[HCL_A1OUT].tail);
+		} else {
+			hc_remove (hc_lists[HCL_AM].tail);
+		}
+	}
+	return hc_freedata[--hc_freedatacount];
+}
+
+static int hc_alloc_entry (void)
+{
+	if (hc_lists[HCL_FREE].head < 0)
+		hc_remove (hc_lists[HCL_A1OUT].tail);
+	int idx = hc_lists[HCL_FREE].head;
+	hc_unlink (idx);
+	return idx;
+}
+
+static void hc_insert (struct hardfiledata *hfd, uae_u64 block, const uae_u8 *src)
+{
+	int list = HCL_A1IN;
+	int idx = hc_lookup (hfd, block);
+	if (idx >= 0) {
+		if (hc_entries[idx].data)
+			return;
+		/* remembered in A1out: it is hot, goes straight to Am */
+		hc_unlink (idx);
+		list = HCL_AM;
+	}
+	uae_u8 *data = hc_alloc_data ();
+	if (idx < 0) {
+		idx = hc_alloc_entry ();
+		struct hdf_cache_entry *e = &hc_entries[idx];
+		int h = hc_hashval (hfd, block);
+		e->hfd = hfd;
+		e->block = block;
+		e->hnext = hc_hash[h];
+		hc_hash[h] = idx;
+	}
+	hc_entries[idx].data = data;
+	memcpy (data, src, HDF_CACHE_BLOCK);
+	hc_push (list, idx);
+}
+
+static void hc_free (void)
+{
+	xfree (hc_data);
+	xfree (hc_freedata);
+	xfree (hc_entries);
+	xfree (hc_hash);
+	hc_data = NULL;
+	hc_freedata = NULL;
+	hc_entries = NULL;
+	hc_hash = NULL;
+	hc_slots = 0;
+	hc_size = 0;
+}
+
+static void hc_alloc (int size)
+{
+	int slots = (int)((uae_u64)size * 1024 * 1024 / HDF_CACHE_BLOCK);
+	if (slots < 16)
+		return;
+	hc_data = xmalloc (uae_u8, (size_t)slots * HDF_CACHE_BLOCK);
+	if (!hc_data)
+		return;
+	hc_size = size;
+	hc_slots = slots;
+	hc_kin = slots / 4;
+	hc_kout = slots / 2;
+	hc_numentries = slots + hc_kout + 2;
+	hc_freedata = xmalloc (uae_u8*, slots);
+	for (int i = 0; i < slots; i++)
+		hc_freedata[i] = hc_data + (size_t)i * HDF_CACHE_BLOCK;
+	hc_freedatacount = slots;
+	hc_entries = xcalloc (struct hdf_cache_entry, hc_numentries);
+	for (int i = 0; i < 4; i++) {
+		hc_lists[i].head = hc_lists[i].tail = -1;
+		hc_lists[i].count = 0;
+	}
+	for (int i = 0; i < hc_numentries; i++) {
+		hc_entries[i].list = HCL_NONE;
+		hc_entries[i].hnext = -1;
+		hc_push (HCL_FREE, i);
+	}
+	int hashsize = 1;
+	while (hashsize < hc_numentries * 2)
+		hashsize <<= 1;
+	hc_hashmask = hashsize - 1;
+	hc_hash = xmalloc (int, hashsize);
+	for (int i = 0; i < hashsize; i++)
+		hc_hash[i] = -1;
+	write_log (_T("HDF block cache: %d MB, %d blocks\n"), size, slots);
+}
+
 static void hdf_init_cache (struct hardfiledata *hfd)
 {
+	int size = currprefs.hardfile_cache_size;
+
+	if (hfd->bcache_open)
+		return;
+	if (!hc_sem_valid) {
+		uae_sem_init (&hc_sem, 0, 1);
+		hc_sem_valid = true;
+	}
+	uae_sem_wait (&hc_sem);
+	if (size < 0)
+		size = 0;
+	if (!hc_users && hc_size != size) {
+		hc_free ();
+		if (size > 0)
+			hc_alloc (size);
+	}
+	hc_users++;
+	hfd->bcache_open = true;
+	hfd->bcache_gen = 0;
+	hfd->bcache_hits = 0;
+	hfd->bcache_misses = 0;
+	uae_sem_post (&hc_sem);
 }
-static void hdf_flush_cache (struct hardfiledata *hdf)
+
+static void hdf_flush_cache (struct hardfiledata *hfd)
 {
+	if (!hfd->bcache_open)
+		return;
+	uae_sem_wait (&hc_sem);
+	for (int i = 0; i < hc_numentries && hc_slots; i++) {
+		if (hc_entries[i].hfd == hfd)
+			hc_remove (i);
+	}
+	if (hfd->bcache_hits || hfd->bcache_misses) {
+		write_log (_T("HDF block cache: unit %d, %llu hits, %llu misses\n"),
+			hfd->unitnum, hfd->bcache_hits, hfd->bcache_misses);
+	}
+	hfd->bcache_open = false;
+	hc_users--;
+	uae_sem_post (&hc_sem);
 }
 
 static int hdf_cache_read (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
-	return hdf_read2 (hfd, buffer, offset, len);
+	uae_u8 *p = (uae_u8*)buffer;
+	uae_u8 tmp[HDF_CACHE_BLOCK];
+	int done = 0;
+
+	if (!hfd->bcache_open || !hc_slots || len > HDF_CACHE_BYPASS)
+		return hdf_read2 (hfd, buffer, offset, len);
+
+	while (done < len) {
+		uae_u64 block = (offset + done) / HDF_CACHE_BLOCK;
+		int boffset = (int)((offset + done) % HDF_CACHE_BLOCK);
+		int n = HDF_CACHE_BLOCK - boffset;
+		if (n > len - done)
+			n = len - done;
+
+		uae_sem_wait (&hc_sem);
+		int idx = hc_lookup (hfd, block);
+		if (idx >= 0 && hc_entries[idx].data) {
+			memcpy (p + done, hc_entries[idx].data + boffset, n);
+			if (hc_entries[idx].list == HCL_AM) {
+				hc_unlink (idx);
+				hc_push (HCL_AM, idx);
+			}
+			hfd->bcache_hits++;
+			uae_sem_post (&hc_sem);
+			done += n;
+			continue;
+		}
+		hfd->bcache_misses++;
+		uae_u32 gen = hfd->bcache_gen;
+		uae_sem_post (&hc_sem);
+
+		if (hdf_read2 (hfd, tmp, block * HDF_CACHE_BLOCK, HDF_CACHE_BLOCK) != HDF_CACHE_BLOCK) {
+			/* partial block at the end of the image or an error,
+			 * let the backend handle just the requested range */
+			int v = hdf_read2 (hfd, p + done, offset + done, n);
+			if (v != n)
+				return done + (v > 0 ? v : 0);
+			done += n;
+			continue;
+		}
+		memcpy (p + done, tmp + boffset, n);
+		uae_sem_wait (&hc_sem);
+		/* skip it if a write happened while we were reading */
+		if (gen == hfd->bcache_gen)
+			hc_insert (hfd, block, tmp);
+		uae_sem_post (&hc_sem);
+		done += n;
+	}
+	return len;
 }
 
 static int hdf_cache_write (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
-	return hdf_write2 (hfd, buffer, offset, len);
+	int v = hdf_write2 (hfd, buffer, offset, len);
+
+	if (!hfd->bcache_open || !hc_slots)
+		return v;
+	uae_sem_wait (&hc_sem);
+	hfd->bcache_gen++;
+	uae_u64 first = offset / HDF_CACHE_BLOCK;
+	uae_u64 last = (offset + len + HDF_CACHE_BLOCK - 1) / HDF_CACHE_BLOCK;
+	for (uae_u64 block = first; block < last; block++) {
+		int idx = hc_lookup (hfd, block);
+		if (idx < 0 || !hc_entries[idx].data)
+			continue;
+		if (v != len) {
+			hc_remove (idx);
+			continue;
+		}
+		uae_u64 start = block * HDF_CACHE_BLOCK;
+		uae_u64 from = start > offset ? start : offset;
+		uae_u64 to = start + HDF_CACHE_BLOCK < offset + len ? start + HDF_CACHE_BLOCK : offset + len;
+		memcpy (hc_entries[idx].data + (from - start), (uae_u8*)buffer + (from - offset), (size_t)(to - from));
+	}
+	uae_sem_post (&hc_sem);
+	return v;
 }
 
 int hdf_open (struct hardfiledata *hfd, const TCHAR *pname)
@@ -519,6 +869,7 @@ int hdf_open (struct hardfiledata *hfd, const TCHAR *pname)
 			hfd->virtsize = cf->logical_bytes();
 			hfd->handle_valid = -1;
 			write_log(_T("CHD '%s' mounted as %s, %s.\n"), pname, chdf ? _T("HD") : _T("OTHER"), hfd->ci.readonly ? _T("read only") : _T("read/write"));
+			hdf_init_cache (hfd);
 			return 1;
 		}
 	}
@@ -569,9 +920,9 @@ int hdf_open (struct hardfiledata *hfd, const TCHAR *pname)
 		hfd->vhd_header = xmalloc (uae_u8, size);
 		if (hdf_read_target (hfd, hfd->vhd_header, 0, size) != size)
 			goto end;
-		hfd->vhd_sectormap = xmalloc (uae_u8, 512);
-		hfd->vhd_sectormapblock = -1;
 		hfd->vhd_bitmapsize = ((hfd->vhd_blocksize / (8 * 512)) + 511) & ~511;
+		hfd->vhd_sectormap = xmalloc (uae_u8, hfd->vhd_bitmapsize);
+		hfd->vhd_sectormapblock = -1;
 	}
 	write_log (_T("HDF is VHD %s image, virtual size=%lldK (%llx %lld)\n"),
 		hfd->hfd_type == HFD_VHD_FIXED ? _T("fixed") : _T("dynamic"),
@@ -580,6 +931,7 @@ int hdf_open (struct hardfiledata *hfd, const TCHAR *pname)
 	return 1;
 nonvhd:
 	hfd->hfd_type = 0;
+	hdf_init_cache (hfd);
 	return 1;
 end:
 	hdf_close_target (hfd);
@@ -620,10 +972,31 @@ int hdf_dup (struct hardfiledata *dhfd, const struct hardfiledata *shfd)
 	return hdf_dup_target (dhfd, shfd);
 }
 
+/* Loads the sector bitmap of the data block at sectoroffset. The whole
+ * bitmap of the most recently used block is cached. */
+static bool vhd_load_sectormap (struct hardfiledata *hfd, uae_u32 sectoroffset)
+{
+	uae_u64 sectormapblock = sectoroffset * (uae_u64)512;
+	if (hfd->vhd_sectormapblock == sectormapblock)
+		return true;
+	if (hdf_read_target (hfd, hfd->vhd_sectormap, sectormapblock, hfd->vhd_bitmapsize) != hfd->vhd_bitmapsize) {
+		hfd->vhd_sectormapblock = -1;
+		return false;
+	}
+	hfd->vhd_sectormapblock = sectormapblock;
+	return true;
+}
+
+static bool vhd_sector_allocated (struct hardfiledata *hfd, int sector)
+{
+	return (hfd->vhd_sectormap[sector / 8] & (1 << (7 - (sector & 7)))) != 0;
+}
+
 static uae_u64 vhd_read (struct hardfiledata *hfd, void *v, uae_u64 offset, uae_u64 len)
 {
 	uae_u64 read;
 	uae_u8 *dataptr = (uae_u8*)v;
+	int blocksectors = hfd->vhd_blocksize / 512;
 
 	//write_log (_T("%08x %08x\n"), (uae_u32)offset, (uae_u32)len);
 	read = 0;
@@ -634,43 +1007,39 @@ static uae_u64 vhd_read (struct hardfiledata *hfd, void *v, uae_u64 offset, uae_
 	while (len > 0) {
 		uae_u32 bamoffset = (offset / hfd->vhd_blocksize) * 4 + hfd->vhd_bamoffset;
 		uae_u32 sectoroffset = gl (hfd->vhd_header + bamoffset);
+		int sector = (offset / 512) % blocksectors;
+		// sectors left in this request and data block
+		int cnt = blocksectors - sector;
+		if ((uae_u64)cnt * 512 > len)
+			cnt = len / 512;
 		if (sectoroffset == 0xffffffff) {
-			memset (dataptr, 0, 512);
-			read += 512;
+			memset (dataptr, 0, cnt * 512);
 		} else {
-			int bitmapoffsetbits;
-			int bitmapoffsetbytes;
-			uae_u64 sectormapblock;
-
-			bitmapoffsetbits = (offset / 512) % (hfd->vhd_blocksize / 512);
-			bitmapoffsetbytes = bitmapoffsetbits / 8;
-			sectormapblock = sectoroffset * (uae_u64)512 + (bitmapoffsetbytes & ~511);
-			if (hfd->vhd_sectormapblock != sectormapblock) {
-				// read sector bitmap
-				//write_log (_T("BM %08x\n"), sectormapblock);
-				if (hdf_read_target (hfd, hfd->vhd_sectormap, sectormapblock, 512) != 512) {
-					write_log (_T("vhd_read: bitmap read error\n"));
-					return read;
-				}
-				hfd->vhd_sectormapblock = sectormapblock;
+			if (!vhd_load_sectormap (hfd, sectoroffset)) {
+				write_log (_T("vhd_read: bitmap read error\n"));
+				return read;
 			}
-			// block allocated in bitmap?
-			if (hfd->vhd_sectormap[bitmapoffsetbytes & 511] & (1 << (7 - (bitmapoffsetbits & 7)))) {
-				// read data block
-				uae_u64 block = sectoroffset * (uae_u64)512 + hfd->vhd_bitmapsize + bitmapoffsetbits * 512;
-				//write_log (_T("DB %08x\n"), block);
-				if (hdf_read_target (hfd, dataptr, block, 512) != 512) {
+			// coalesce sectors with same allocation state
+			bool allocated = vhd_sector_allocated (hfd, sector);
+			int run = 1;
+			while (run < cnt && vhd_sector_allocated (hfd, sector + run) == allocated)
+				run++;
+			cnt = run;
+			if (allocated) {
+				uae_u64 block = sectoroffset * (uae_u64)512 + hfd->vhd_bitmapsize + sector * (uae_u64)512;
+				//write_log (_T("DB %08x %d\n"), block, cnt);
+				if (hdf_read_target (hfd, dataptr, block, cnt * 512) != cnt * 512) {
 					write_log (_T("vhd_read: data read error\n"));
 					return read;
 				}
 			} else {
-				memset (dataptr, 0, 512);
+				memset (dataptr, 0, cnt * 512);
 			}
-			read += 512;
 		}
-		len -= 512;
-		dataptr += 512;
-		offset += 512;
+		read += cnt * 512;
+		len -= cnt * 512;
+		dataptr += cnt * 512;
+		offset += cnt * 512;
 	}
 	return read;
 }
@@ -716,6 +1085,7 @@ static uae_u64 vhd_write (struct hardfiledata *hfd, void *v, uae_u64 offset, uae
 {
 	uae_u64 written;
 	uae_u8 *dataptr = (uae_u8*)v;
+	int blocksectors = hfd->vhd_blocksize / 512;
 
 	//write_log (_T("%08x %08x\n"), (uae_u32)offset, (uae_u32)len);
 	written = 0;
@@ -730,40 +1100,41 @@ static uae_u64 vhd_write (struct hardfiledata *hfd, void *v, uae_u64 offset, uae
 			if (!vhd_write_enlarge (hfd, bamoffset))
 				return written;
 			continue;
-		} else {
-			int bitmapoffsetbits;
-			int bitmapoffsetbytes;
-
-			bitmapoffsetbits = (offset / 512) % (hfd->vhd_blocksize / 512);
-			bitmapoffsetbytes = bitmapoffsetbits / 8;
-			uae_u64 sectormapblock = sectoroffset * (uae_u64)512 + (bitmapoffsetbytes & ~511);
-			if (hfd->vhd_sectormapblock != sectormapblock) {
-				// read sector bitmap
-				if (hdf_read_target (hfd, hfd->vhd_sectormap, sectormapblock, 512) != 512) {
-					write_log (_T("vhd_write: bitmap read error\n"));
-					return written;
-				}
-				hfd->vhd_sectormapblock = sectormapblock;
+		}
+		int sector = (offset / 512) % blocksectors;
+		// sectors left in this request and data block
+		int cnt = blocksectors - sector;
+		if ((uae_u64)cnt * 512 > len)
+			cnt = len / 512;
+		if (!vhd_load_sectormap (hfd, sectoroffset)) {
+			write_log (_T("vhd_write: bitmap read error\n"));
+			return written;
+		}
+		// write data
+		if (hdf_write_target (hfd, dataptr, sectoroffset * (uae_u64)512 + hfd->vhd_bitmapsize + sector * (uae_u64)512, cnt * 512) != cnt * 512) {
+			write_log (_T("vhd_write: data write error\n"));
+			return written;
+		}
+		// mark new sectors allocated and write the modified bitmap back once
+		bool changed = false;
+		for (int i = sector; i < sector + cnt; i++) {
+			if (!vhd_sector_allocated (hfd, i)) {
+				hfd->vhd_sectormap[i / 8] |= 1 << (7 - (i & 7));
+				changed = true;
 			}
-			// write data
-			if (hdf_write_target (hfd, dataptr, sectoroffset * (uae_u64)512 + hfd->vhd_bitmapsize + bitmapoffsetbits * 512, 512) != 512) {
-				write_log (_T("vhd_write: data write error\n"));
+		}
+		if (changed) {
+			int first = (sector / 8) & ~511;
+			int last = (((sector + cnt - 1) / 8) | 511) + 1;
+			if (hdf_write_target (hfd, hfd->vhd_sectormap + first, hfd->vhd_sectormapblock + first, last - first) != last - first) {
+				write_log (_T("vhd_write: bam write error\n"));
 				return written;
 			}
-			// block already allocated in bitmap?
-			if (!(hfd->vhd_sectormap[bitmapoffsetbytes & 511] & (1 << (7 - (bitmapoffsetbits & 7))))) {
-				// no, we need to mark it allocated and write the modified bitmap back to the disk
-				hfd->vhd_sectormap[bitmapoffsetbytes & 511] |= (1 << (7 - (bitmapoffsetbits & 7)));
-				if (hdf_write_target (hfd, hfd->vhd_sectormap, sectormapblock, 512) != 512) {
-					write_log (_T("vhd_write: bam write error\n"));
-					return written;
-				}
-			}
-			written += 512;
 		}
-		len -= 512;
-		dataptr += 512;
-		offset += 512;
+		written += cnt * 512;
+		len -= cnt * 512;
+		dataptr += cnt * 512;
+		offset += cnt * 512;
 	}
 	return written;
 }
@@ -1848,7 +2219,7 @@ void hardfile_send_disk_change (struct hardfiledata *hfd, bool insert)
 {
 	int newstate = insert ? 0 : 1;
 
-	uae_sem_wait (&change_sem);
+	uae_sem_wait (&change_sem[hfd->unitnum]);
 	hardfpd[hfd->unitnum].changenum++;
 	write_log (_T("uaehf.device:%d media status=%d changenum=%d\n"), hfd->unitnum, insert, hardfpd[hfd->unitnum].changenum);
 	hfd->drive_empty = newstate;
@@ -1861,7 +2232,7 @@ void hardfile_send_disk_change (struct hardfiledata *hfd, bool insert)
 	}
 	if (hardfpd[hfd->unitnum].changeint)
 		uae_Cause (hardfpd[hfd->unitnum].changeint);
-	uae_sem_post (&change_sem);
+	uae_sem_post (&change_sem[hfd->unitnum]);
 }
 
 void hardfile_do_disk_change (struct uaedev_config_data *uci, bool insert)
@@ -1950,7 +2321,7 @@ static void abort_async (struct hardfileprivdata *hfpd, uaecptr request, int err
 	}
 }
 
-static void *hardfile_thread (void *devs);
+static void hardfile_queue_io (void *devs, uae_u32 data);
 static int start_thread (TrapContext *context, int unit)
 {
 	struct hardfileprivdata *hfpd = &hardfpd[unit];
@@ -1959,10 +2330,9 @@ static int start_thread (TrapContext *context, int unit)
 		return 1;
 	memset (hfpd, 0, sizeof (struct hardfileprivdata));
 	hfpd->base = m68k_areg (regs, 6);
-	init_comm_pipe (&hfpd->requests, 100, 1);
-	uae_sem_init (&hfpd->sync_sem, 0, 0);
-	uae_start_thread (_T("hardfile"), hardfile_thread, hfpd, NULL);
-	uae_sem_wait (&hfpd->sync_sem);
+	if (!hardfile_queue)
+		hardfile_queue = ioqueue_create (_T("hardfile"), HARDFILE_QUEUE_LANES, 1);
+	hfpd->thread_running = 1;
 	return hfpd->thread_running;
 }
 
@@ -2021,7 +2391,7 @@ static uae_u32 REGPARAM2 hardfile_close (TrapContext *context)
 		return 0;
 	put_word (hfpd->base + 32, get_word (hfpd->base + 32) - 1);
 	if (get_word (hfpd->base + 32) == 0)
-		write_comm_pipe_u32 (&hfpd->requests, 0, 1);
+		ioqueue_submit (hardfile_queue, unit, hardfile_queue_io, hfpd, 0);
 	return 0;
 }
 
@@ -2356,35 +2726,28 @@ static uae_u32 REGPARAM2 hardfile_beginio (TrapContext *context)
 		hf_log2 (_T("hf asyncio unit=%d request=%p cmd=%d\n"), unit, request, cmd);
 		add_async_request (hfpd, request, ASYNC_REQUEST_TEMP, 0);
 		put_byte (request + 30, get_byte (request + 30) & ~1);
-		write_comm_pipe_u32 (&hfpd->requests, request, 1);
+		ioqueue_submit (hardfile_queue, unit, hardfile_queue_io, hfpd, request);
 		return 0;
 	}
 }
 
-static void *hardfile_thread (void *devs)
+static void hardfile_queue_io (void *devs, uae_u32 data)
 {
 	struct hardfileprivdata *hfpd = (struct hardfileprivdata*)devs;
+	int unit = hfpd - &hardfpd[0];
+	uaecptr request = (uaecptr)data;
 
-	uae_set_thread_priority (NULL, 1);
-	hfpd->thread_running = 1;
-	uae_sem_post (&hfpd->sync_sem);
-	for (;;) {
-		uaecptr request = (uaecptr)read_comm_pipe_u32_blocking (&hfpd->requests);
-		uae_sem_wait (&change_sem);
-		if (!request) {
-			hfpd->thread_running = 0;
-			uae_sem_post (&hfpd->sync_sem);
-			uae_sem_post (&change_sem);
-			return 0;
-		} else if (hardfile_do_io (get_hardfile_data (hfpd - &hardfpd[0]), hfpd, request) == 0) {
-			put_byte (request + 30, get_byte (request + 30) & ~1);
-			release_async_request (hfpd, request);
-			uae_ReplyMsg (request);
-		} else {
-			hf_log2 (_T("async request %08X\n"), request);
-		}
-		uae_sem_post (&change_sem);
+	uae_sem_wait (&change_sem[unit]);
+	if (!request) {
+		hfpd->thread_running = 0;
+	} else if (hardfile_do_io (get_hardfile_data (unit), hfpd, request) == 0) {
+		put_byte (request + 30, get_byte (request + 30) & ~1);
+		release_async_request (hfpd, request);
+		uae_ReplyMsg (request);
+	} else {
+		hf_log2 (_T("async request %08X\n"), request);
 	}
+	uae_sem_post (&change_sem[unit]);
 }
 
 void hardfile_reset (void)
@@ -2392,6 +2755,7 @@ void hardfile_reset (void)
 	int i, j;
 	struct hardfileprivdata *hfpd;
 
+	ioqueue_log_stats (hardfile_queue);
 	for (i = 0; i < MAX_FILESYSTEM_UNITS; i++) {
 		hfpd = &hardfpd[i];
 		if (hfpd->base && valid_address (hfpd->base, 36) && get_word (hfpd->base + 32) > 0) {
@@ -2411,7 +2775,8 @@ void hardfile_install (void)
 	uae_u32 initcode, openfunc, closefunc, expungefunc;
 	uae_u32 beginiofunc, abortiofunc;
 
-	uae_sem_init (&change_sem, 0, 1);
+	for (int i = 0; i < MAX_FILESYSTEM_UNITS; i++)
+		uae_sem_init (&change_sem[i], 0, 1);
 
 	ROM_hardfile_resname = ds (currprefs.uaescsidevmode == 1 ? _T("scsi.device") : _T("uaehf.device"));
 	ROM_hardfile_resid = ds (_T("UAE hardfile.device 0.4"));
@@ -23,6 +23,7 @@
 #include "savestate.h"
 #include "scsi.h"
 #include "ide.h"
+#include "ioqueue.h"
 
 /* STATUS bits */
 #define IDE_STATUS_ERR 0x01		// 0
@@ -611,15 +612,17 @@ static void setbsy (struct ide_hdf *ide)
 	ide->regs.ide_status &= ~IDE_STATUS_DRQ;
 }
 
+static void ide_queue_process (void *idedata, uae_u32 unit);
+
 static void process_rw_command (struct ide_hdf *ide)
 {
 	setbsy (ide);
-	write_comm_pipe_u32 (&ide->its->requests, ide->num, 1);
+	ioqueue_submit (ide->its->queue, ide->num, ide_queue_process, ide->its, ide->num);
 }
 static void process_packet_command (struct ide_hdf *ide)
 {
 	setbsy (ide);
-	write_comm_pipe_u32 (&ide->its->requests, ide->num | 0x80, 1);
+	ioqueue_submit (ide->its->queue, ide->num, ide_queue_process, ide->its, ide->num | 0x80);
 }
 
 static void atapi_data_done (struct ide_hdf *ide)
@@ -1289,40 +1292,35 @@ void ide_write_reg (struct ide_hdf *ide, int ide_reg, uae_u32 val)
 	}
 }
 
-static void *ide_thread (void *idedata)
+static void ide_queue_process (void *idedata, uae_u32 unit)
 {
 	struct ide_thread_state *its = (struct ide_thread_state*)idedata;
-	for (;;) {
-		uae_u32 unit = read_comm_pipe_u32_blocking (&its->requests);
-		struct ide_hdf *ide;
-		if (its->state == 0 || unit == 0xfffffff)
-			break;
-		ide = its->idetable[unit & 0x7f];
-		if (unit & 0x80)
-			do_process_packet_command (ide);
-		else
-			do_process_rw_command (ide);
-	}
-	its->state = -1;
-	return 0;
+	struct ide_hdf *ide = its->idetable[unit & 0x7f];
+	if (unit & 0x80)
+		do_process_packet_command (ide);
+	else
+		do_process_rw_command (ide);
 }
 
+/* Both drives of a channel share the lane, channels run in parallel. */
+#define IDE_QUEUE_MAX_LANES 4
+
 void start_ide_thread(struct ide_thread_state *its)
 {
 	if (!its->state) {
+		int lanes = its->idetotal / 2;
+		if (lanes > IDE_QUEUE_MAX_LANES)
+			lanes = IDE_QUEUE_MAX_LANES;
 		its->state = 1;
-		init_comm_pipe (&its->requests, 100, 1);
-		uae_start_thread (_T("ide"), ide_thread, its, NULL);
+		its->queue = ioqueue_create (_T("ide"), lanes, 2);
 	}
 }
 
 void stop_ide_thread(struct ide_thread_state *its)
 {
 	if (its->state > 0) {
-		its->state = 0;
-		write_comm_pipe_u32 (&its->requests, 0xffffffff, 1);
-		while(its->state == 0)
-			sleep_millis (10);
+		ioqueue_destroy (its->queue);
+		its->queue = NULL;
 		its->state = 0;
 	}
 }
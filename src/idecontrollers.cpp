@@ -27,6 +27,9 @@
 #include "scsi.h"
 #include "ncr9x_scsi.h"
 #include "autoconf.h"
+#ifdef WITH_X86
+#include "x86.h"
+#endif
 
 #define DEBUG_IDE 0
 #define DEBUG_IDE_GVP 0
@@ -235,16 +238,27 @@ static bool ide_rethink(struct ide_board *board, bool edge_triggered)
 
 void x86_doirq(uint8_t irqnum);
 
+static bool is_x86_ide_board(struct ide_board *board)
+{
+	return board == x86_at_ide_board[0] || board == x86_at_ide_board[1];
+}
+
 void idecontroller_rethink(void)
 {
 	bool irq = false;
 	for (int i = 0; ide_boards[i]; i++) {
-		if (ide_boards[i] == x86_at_ide_board[0] || ide_boards[i] == x86_at_ide_board[1]) {
+		if (is_x86_ide_board(ide_boards[i])) {
+#ifdef WITH_X86
+			x86_bridge_sync_lock();
+#endif
 			bool x86irq = ide_rethink(ide_boards[i], true);
 			if (x86irq) {
 				//write_log(_T("x86 IDE IRQ\n"));
 				x86_doirq(ide_boards[i] == x86_at_ide_board[0] ? 14 : 15);
 			}
+#ifdef WITH_X86
+			x86_bridge_sync_unlock();
+#endif
 		} else {
 			irq |= ide_rethink(ide_boards[i], false);
 		}
@@ -259,6 +273,11 @@ void idecontroller_hsync(void)
 	for (int i = 0; ide_boards[i]; i++) {
 		struct ide_board *board = ide_boards[i];
 		if (board->configured) {
+#ifdef WITH_X86
+			bool x86 = is_x86_ide_board(board);
+			if (x86)
+				x86_bridge_sync_lock();
+#endif
 			for (int j = 0; j < MAX_IDE_PORTS_BOARD; j++) {
 				if (board->ide[j]) {
 					ide_interrupt_hsync(board->ide[j]);
@@ -267,6 +286,10 @@ void idecontroller_hsync(void)
 			if (ide_interrupt_check(board, false)) {
 				idecontroller_rethink();
 			}
+#ifdef WITH_X86
+			if (x86)
+				x86_bridge_sync_unlock();
+#endif
 		}
 	}
 }
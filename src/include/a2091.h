@@ -83,8 +83,7 @@ struct wd_state {
 	struct romconfig *rc;
 	struct wd_state **self_ptr;
 
-	smp_comm_pipe requests;
-	volatile int scsi_thread_running;
+	struct ioqueue *queue;
 
 	// unit 8,9 = ST-506 (A2090)
 	// unit 8 = XT (A2091)
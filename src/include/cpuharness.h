@@ -0,0 +1,15 @@
+#ifndef UAE_CPUHARNESS_H
+#define UAE_CPUHARNESS_H
+
+#include "uae/types.h"
+
+/* CPU core harness. Runs randomized and curated instruction streams on
+ * every core variant available for the configured CPU (fast, prefetch,
+ * cycle-exact, MMU and JIT), compares the final register and memory state
+ * against the fast core and writes instructions per second per opcode
+ * class as JSON to path. Started from m68k_go when cpu_harness is set,
+ * the emulator quits afterwards. */
+
+void cpu_harness_run (const TCHAR *path);
+
+#endif /* UAE_CPUHARNESS_H */
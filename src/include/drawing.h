@@ -330,6 +330,7 @@ extern int thisframe_first_drawn_line, thisframe_last_drawn_line;
 #define IHF_SCROLLLOCK 0
 #define IHF_QUIT_PROGRAM 1
 #define IHF_PICASSO 2
+#define IHF_RUNAHEAD 3
 
 extern int inhibit_frame;
 
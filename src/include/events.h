@@ -56,12 +56,20 @@ struct ev
     evfunc handler;
 };
 
+/* Per event type counters, compiled in when EVENT_STATS is set and
+ * collected while event_stats_enabled is set by the debugger "es +"
+ * command. When disabled, the cost is one test per fired event. */
+#define EVENT_STATS 1
+
 struct ev2
 {
     bool active;
     evt evtime;
     uae_u32 data;
     evfunc2 handler;
+#if EVENT_STATS
+    int stat;
+#endif
 };
 
 enum {
@@ -69,9 +77,10 @@ enum {
     ev_max
 };
 
+/* Fixed ev2 slots, other ev2 events are kept in eventtab2_misc. */
 enum {
-    ev2_blitter, ev2_disk, ev2_misc,
-    ev2_max = 12
+    ev2_blitter, ev2_disk,
+    ev2_max
 };
 
 extern int pissoff_value;
@@ -82,6 +91,8 @@ extern uae_s32 pissoff;
 
 extern struct ev eventtab[ev_max];
 extern struct ev2 eventtab2[ev2_max];
+extern struct ev2 *eventtab2_misc;
+extern int eventtab2_misc_count;
 
 extern volatile bool vblank_found_chipset;
 extern volatile bool vblank_found_rtg;
@@ -136,26 +147,63 @@ STATIC_INLINE bool cycles_in_range (unsigned long endcycles)
 }
 
 extern void MISC_handler (void);
-extern void event2_newevent_xx (int no, evt t, uae_u32 data, evfunc2 func);
+extern void event2_newevent_xx_name (int no, evt t, uae_u32 data, evfunc2 func, const TCHAR *name);
+extern void event2_flush (void);
+extern void event2_reset (void);
+
+#if EVENT_STATS
+
+#define EVENT_STATS_EV2 ev_max
+#define EVENT_STATS_MISC (ev_max + ev2_max)
+#define EVENT_STATS_MAX 64
+
+struct event_stat
+{
+    const TCHAR *name;
+    evfunc2 handler;
+    uae_u64 fires;
+    uae_u32 frame_fires, peak_frame_fires;
+    /* host time spent in the handler, in read_processor_time units */
+    uae_u64 time;
+};
+
+extern bool event_stats_enabled;
 
-STATIC_INLINE void event2_newevent_x (int no, evt t, uae_u32 data, evfunc2 func)
+extern int event_stats_index (evfunc2 func, const TCHAR *name);
+extern void event_stats_add (int stat, frame_time_t start);
+extern void events_stats_vsync (void);
+extern int events_get_stats (struct event_stat *st, int max, uae_u32 *frames);
+extern void events_reset_stats (void);
+
+#endif /* EVENT_STATS */
+
+/* Misc event handlers are listed by name in the statistics */
+#if EVENT_STATS
+#define EVENT2_NAME(func) _T(#func)
+#else
+#define EVENT2_NAME(func) NULL
+#endif
+
+#define event2_newevent_xx(no, t, data, func) event2_newevent_xx_name (no, t, data, func, EVENT2_NAME (func))
+
+STATIC_INLINE void event2_newevent_x_name (int no, evt t, uae_u32 data, evfunc2 func, const TCHAR *name)
 {
 	if (((int)t) <= 0) {
 		func (data);
 		return;
 	}
-	event2_newevent_xx (no, t * CYCLE_UNIT, data, func);
+	event2_newevent_xx_name (no, t * CYCLE_UNIT, data, func, name);
 }
 
+#define event2_newevent_x(no, t, data, func) event2_newevent_x_name (no, t, data, func, EVENT2_NAME (func))
+
 STATIC_INLINE void event2_newevent (int no, evt t, uae_u32 data)
 {
-	event2_newevent_x (no, t, data, eventtab2[no].handler);
-}
-STATIC_INLINE void event2_newevent2 (evt t, uae_u32 data, evfunc2 func)
-{
-	event2_newevent_x (-1, t, data, func);
+	event2_newevent_x_name (no, t, data, eventtab2[no].handler, NULL);
 }
 
+#define event2_newevent2(t, data, func) event2_newevent_x_name (-1, t, data, func, EVENT2_NAME (func))
+
 STATIC_INLINE void event2_remevent (int no)
 {
 	eventtab2[no].active = 0;
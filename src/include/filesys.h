@@ -17,18 +17,7 @@
 
 struct hardfilehandle;
 
-#define MAX_HDF_CACHE_BLOCKS 128
 #define MAX_SCSI_SENSE 36
-struct hdf_cache
-{
-	bool valid;
-	uae_u8 *data;
-	uae_u64 block;
-	bool dirty;
-	int readcount;
-	int writecount;
-	time_t lastaccess;
-};
 
 struct hardfiledata {
     uae_u64 virtsize; // virtual size
@@ -70,7 +59,11 @@ struct hardfiledata {
     int drive_empty;
     TCHAR *emptyname;
 
-	struct hdf_cache bcache[MAX_HDF_CACHE_BLOCKS];
+	/* shared block cache (hardfile.cpp) */
+	bool bcache_open;
+	uae_u32 bcache_gen;
+	uae_u64 bcache_hits;
+	uae_u64 bcache_misses;
 	uae_u8 scsi_sense[MAX_SCSI_SENSE];
 
 	struct uaedev_config_info delayedci;
@@ -105,12 +105,13 @@ struct ide_hdf
 	struct scsi_data *scsi;
 };
 
+struct ioqueue;
 struct ide_thread_state
 {
 	struct ide_hdf **idetable;
 	int idetotal;
 	volatile int state;
-	smp_comm_pipe requests;	
+	struct ioqueue *queue;
 };
 
 uae_u32 ide_read_reg (struct ide_hdf *ide, int ide_reg);
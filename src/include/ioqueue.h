@@ -0,0 +1,38 @@
+#ifndef UAE_IOQUEUE_H
+#define UAE_IOQUEUE_H
+
+#include "uae/types.h"
+
+/* Shared storage I/O engine. Requests are executed by a small pool of
+ * worker threads (lanes). Units are mapped to lanes in groups, requests
+ * for units in the same group complete in submission order, while
+ * requests for different groups may be in flight at the same time. */
+
+#define IOQUEUE_MAX_LANES 8
+#define IOQUEUE_MAX_UNITS 128
+
+/* Called on a worker thread, this is where the controller emulation
+ * performs the transfer and signals completion (status, interrupt). */
+typedef void (*ioqueue_func)(void *ctx, uae_u32 data);
+
+struct ioqueue_stats
+{
+	uae_u32 requests;
+	uae_u32 completed;
+	uae_u32 depth;
+	uae_u32 max_depth;
+	uae_u64 busy_us;
+	uae_u64 wait_us;
+	uae_u32 max_latency_us;
+};
+
+struct ioqueue;
+
+struct ioqueue *ioqueue_create (const TCHAR *name, int lanes, int group);
+void ioqueue_destroy (struct ioqueue *q);
+void ioqueue_submit (struct ioqueue *q, int unit, ioqueue_func func, void *ctx, uae_u32 data);
+void ioqueue_drain (struct ioqueue *q);
+bool ioqueue_get_stats (struct ioqueue *q, int unit, struct ioqueue_stats *st);
+void ioqueue_log_stats (struct ioqueue *q);
+
+#endif /* UAE_IOQUEUE_H */
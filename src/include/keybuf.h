@@ -15,6 +15,8 @@ extern int keys_available (void);
 extern int record_key (int);
 extern int record_key_direct (int);
 extern void keybuf_init (void);
+extern int keybuf_getreadpos (void);
+extern void keybuf_setreadpos (int);
 extern int getcapslockstate (void);
 extern void setcapslockstate (int);
 
@@ -630,6 +630,9 @@ extern void cpu_halt (int id);
 extern void cpu_sleep_millis(int ms);
 
 extern void fill_prefetch (void);
+extern void m68k_harness_rebuild (void);
+extern int m68k_harness_opcode_length (uae_u16 opcode);
+extern int m68k_harness_run (uaecptr pc, int maxinsns);
 extern void fill_prefetch_020 (void);
 extern void fill_prefetch_030 (void);
 
@@ -385,6 +385,7 @@ struct uae_prefs {
 	bool sound_stereo_swap_ahi;
 	bool sound_auto;
 	bool sound_cdaudio;
+	bool sound_sinc_reference;
 
 	int sampler_freq;
 	int sampler_buffer;
@@ -398,6 +399,9 @@ struct uae_prefs {
 	bool compfpu;
 	bool comp_hardflush;
 	bool comp_constjump;
+	bool comp_stats;
+	bool comp_perfmap;
+	bool comp_fpu_sse2;
 	int cachesize;
 	bool fpu_strict;
 
@@ -485,6 +489,7 @@ struct uae_prefs {
 	TCHAR filesys_inject_icons_project[MAX_DPATH];
 	TCHAR filesys_inject_icons_drawer[MAX_DPATH];
 	int uaescsidevmode;
+	int hardfile_cache_size;
 	bool reset_delay;
 
 	int cs_compatible;
@@ -549,6 +554,7 @@ struct uae_prefs {
 	TCHAR quitstatefile[MAX_DPATH];
 	TCHAR statefile[MAX_DPATH];
 	TCHAR inprecfile[MAX_DPATH];
+	TCHAR cpuharnessfile[MAX_DPATH];
 	bool inprec_autoplay;
 	bool refresh_indicator;
 
@@ -560,6 +566,7 @@ struct uae_prefs {
 	int m68k_speed;
 	double m68k_speed_throttle;
 	double x86_speed_throttle;
+	int x86_thread_quantum;
 	int cpu_model;
 	int mmu_model;
 	int cpu060_revision;
@@ -690,6 +697,7 @@ struct uae_prefs {
 	struct slirp_redir slirp_redirs[MAX_SLIRP_REDIRS];
 #endif
 	int statecapturerate, statecapturebuffersize;
+	int runahead;
 	int aviout_width, aviout_height, aviout_xoffset, aviout_yoffset;
 
 	/* input */
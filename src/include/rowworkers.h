@@ -0,0 +1,22 @@
+#ifndef UAE_ROWWORKERS_H
+#define UAE_ROWWORKERS_H
+
+#include "uae/types.h"
+
+/* Fork/join helper for per-frame image loops. The rows are split into
+ * bands that run on a small pool of parked worker threads, the calling
+ * thread processes the last band itself and returns when all bands are
+ * done. Rows of one call must be independent of each other. Used by the
+ * special monitor decoders; the libfsemu scaler has its own pool. */
+
+#define ROWWORKERS_MAX_THREADS 8
+
+/* Processes rows first (inclusive) to last (exclusive). */
+typedef void (*rowworker_func)(void *ctx, int first, int last);
+
+/* Bands are at least minrows rows, small jobs run on the caller. */
+void rowworkers_run (int rows, int minrows, rowworker_func func, void *ctx);
+/* Number of threads (including the caller) used by rowworkers_run. */
+int rowworkers_count (void);
+
+#endif /* UAE_ROWWORKERS_H */
@@ -237,6 +237,7 @@ extern bool savestate_check (void);
 #define STATE_DORESTORE 8
 #define STATE_REWIND 16
 #define STATE_DOREWIND 32
+#define STATE_RUNAHEAD 64
 
 extern int savestate_state;
 extern TCHAR savestate_fname[MAX_DPATH];
@@ -245,7 +246,7 @@ extern struct zfile *savestate_file;
 STATIC_INLINE bool isrestore (void)
 {
 #ifdef SAVESTATE
-	return savestate_state == STATE_RESTORE || savestate_state == STATE_REWIND;
+	return savestate_state == STATE_RESTORE || savestate_state == STATE_REWIND || savestate_state == STATE_RUNAHEAD;
 #else
 	return false;
 #endif
@@ -262,4 +263,17 @@ extern void savestate_listrewind (void);
 extern void statefile_save_recording (const TCHAR*);
 extern void savestate_capture_request (void);
 
+extern void savestate_runahead_vsync (void);
+extern bool savestate_runahead_events (void);
+extern bool savestate_runahead_show (void);
+extern bool savestate_runahead_ahead (void);
+extern void savestate_runahead_restore (void);
+extern void savestate_runahead_free (void);
+
+/* In-memory state records, see savestate.cpp */
+struct staterecord;
+extern struct staterecord *savestate_record_save (struct staterecord *st);
+extern bool savestate_record_restore (struct staterecord *st);
+extern void savestate_record_free (struct staterecord *st);
+
 #endif /* UAE_SAVESTATE_H */
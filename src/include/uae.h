@@ -77,6 +77,9 @@ extern void fetch_statefilepath (TCHAR *out, int size);
 extern void fetch_inputfilepath (TCHAR *out, int size);
 extern void fetch_datapath (TCHAR *out, int size);
 extern void fetch_rompath (TCHAR *out, int size);
+#ifdef FSUAE
+extern void fetch_sharedrompath (TCHAR *out, int size);
+#endif
 extern uae_u32 uaerand (void);
 extern uae_u32 uaesrand (uae_u32 seed);
 extern uae_u32 uaerandgetseed (void);
@@ -81,6 +81,8 @@ void write_log (const char *, ...) UAE_PRINTF_FORMAT(1, 2);
 #if SIZEOF_TCHAR != 1
 void write_log (const TCHAR *, ...) UAE_WPRINTF_FORMAT(1, 2);
 #endif
+/* Suppresses write_log output while mute is set. */
+void write_log_mute (int mute);
 
 #endif
 
@@ -0,0 +1,27 @@
+/*
+ * Sampling profiler for guest code, using SegmentTracker symbols
+ */
+
+#ifndef UAE_SEGPROFILER_H
+#define UAE_SEGPROFILER_H
+
+extern int segprofiler_interval;
+
+extern void segprofiler_start(int interval);
+extern void segprofiler_stop(void);
+extern void segprofiler_clear(void);
+extern void segprofiler_status(void);
+extern int segprofiler_write_folded(const char *file_name);
+
+extern void segprofiler_sample(void);
+
+/* called from devices_hsync; sampling is done every
+   segprofiler_interval scanlines */
+STATIC_INLINE void segprofiler_hsync(void)
+{
+    if (segprofiler_interval) {
+        segprofiler_sample();
+    }
+}
+
+#endif /* UAE_SEGPROFILER_H */
@@ -44,6 +44,12 @@ bool uae_vm_decommit(void *address, uae_u32 size);
 
 int uae_vm_page_size(void);
 
+/* Replace the (already initialized) pages at address with a private
+ * copy-on-write mapping of the file at path. The file is created with the
+ * current contents if needed. Processes mapping the same file share the
+ * physical pages until one of them writes to the memory. */
+bool uae_vm_share_pages(void *address, uae_u32 size, const TCHAR *path);
+
 // void *uae_vm_alloc_with_flags(uae_u32 size, int protect, int flags);
 
 #endif /* UAE_VM_H */
@@ -16,6 +16,10 @@ void x86_bridge_reset(void);
 void x86_bridge_free(void);
 void x86_bridge_rethink(void);
 void x86_bridge_sync_change(void);
+/* Held by the emulation thread while it changes state shared with the x86
+ * CPU thread (floppy drives, x86 IDE), no-op on other threads. */
+void x86_bridge_sync_lock(void);
+void x86_bridge_sync_unlock(void);
 void x86_xt_ide_bios(struct zfile*, struct romconfig *rc);
 
 #define X86_STATE_INACTIVE 0
@@ -0,0 +1,200 @@
+/*
+* UAE - The Un*x Amiga Emulator
+*
+* Shared storage I/O engine used by the IDE, SCSI and uaehf.device
+* emulations. Replaces the single "one command at a time" worker each
+* of them used to have.
+*
+*/
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include "options.h"
+#include "threaddep/thread.h"
+#include "events.h"
+#include "ioqueue.h"
+
+struct ioqueue_req
+{
+	ioqueue_func func;
+	void *ctx;
+	uae_u32 data;
+	int unit;
+	frame_time_t queued;
+};
+
+struct ioqueue_lane
+{
+	struct ioqueue *q;
+	int num;
+	smp_comm_pipe requests;
+	uae_thread_id tid;
+	TCHAR name[32];
+};
+
+struct ioqueue
+{
+	TCHAR name[16];
+	int lanes;
+	int group;
+	struct ioqueue_lane lane[IOQUEUE_MAX_LANES];
+	uae_sem_t stats_sem;
+	uae_sem_t marker_sem;
+	struct ioqueue_stats stats[IOQUEUE_MAX_UNITS];
+};
+
+/* func == NULL marks a control request, data tells which one. */
+#define IOQUEUE_MARKER_DRAIN 0
+#define IOQUEUE_MARKER_QUIT 1
+
+static uae_u32 ioqueue_us (frame_time_t t)
+{
+	if (syncbase <= 0)
+		return 0;
+	return (uae_u32)((uae_u64)t * 1000000 / syncbase);
+}
+
+static void *ioqueue_thread (void *v)
+{
+	struct ioqueue_lane *lane = (struct ioqueue_lane*)v;
+	struct ioqueue *q = lane->q;
+
+	uae_set_thread_priority (NULL, 1);
+	for (;;) {
+		struct ioqueue_req *req = (struct ioqueue_req*)read_comm_pipe_pvoid_blocking (&lane->requests);
+		if (!req->func) {
+			int quit = req->data == IOQUEUE_MARKER_QUIT;
+			xfree (req);
+			uae_sem_post (&q->marker_sem);
+			if (quit)
+				break;
+			continue;
+		}
+		frame_time_t start = read_processor_time ();
+		req->func (req->ctx, req->data);
+		frame_time_t end = read_processor_time ();
+
+		uae_sem_wait (&q->stats_sem);
+		struct ioqueue_stats *st = &q->stats[req->unit];
+		uae_u32 latency = ioqueue_us (end - req->queued);
+		st->completed++;
+		st->depth--;
+		st->busy_us += ioqueue_us (end - start);
+		st->wait_us += ioqueue_us (start - req->queued);
+		if (latency > st->max_latency_us)
+			st->max_latency_us = latency;
+		uae_sem_post (&q->stats_sem);
+		xfree (req);
+	}
+	return 0;
+}
+
+struct ioqueue *ioqueue_create (const TCHAR *name, int lanes, int group)
+{
+	struct ioqueue *q = xcalloc (struct ioqueue, 1);
+
+	if (lanes < 1)
+		lanes = 1;
+	if (lanes > IOQUEUE_MAX_LANES)
+		lanes = IOQUEUE_MAX_LANES;
+	q->lanes = lanes;
+	q->group = group < 1 ? 1 : group;
+	_tcsncpy (q->name, name, sizeof q->name / sizeof (TCHAR) - 1);
+	uae_sem_init (&q->stats_sem, 0, 1);
+	uae_sem_init (&q->marker_sem, 0, 0);
+	for (int i = 0; i < lanes; i++) {
+		struct ioqueue_lane *lane = &q->lane[i];
+		lane->q = q;
+		lane->num = i;
+		_stprintf (lane->name, _T("%s%d"), q->name, i);
+		init_comm_pipe (&lane->requests, 100, 1);
+		uae_start_thread (lane->name, ioqueue_thread, lane, &lane->tid);
+	}
+	write_log (_T("%s: I/O queue started, %d lane(s)\n"), q->name, lanes);
+	return q;
+}
+
+static void ioqueue_marker (struct ioqueue *q, int type)
+{
+	for (int i = 0; i < q->lanes; i++) {
+		struct ioqueue_req *req = xcalloc (struct ioqueue_req, 1);
+		req->data = type;
+		write_comm_pipe_pvoid (&q->lane[i].requests, req, 1);
+	}
+	for (int i = 0; i < q->lanes; i++)
+		uae_sem_wait (&q->marker_sem);
+}
+
+/* Waits until everything submitted so far has completed. Must not be
+ * called from a completion function. */
+void ioqueue_drain (struct ioqueue *q)
+{
+	if (!q)
+		return;
+	ioqueue_marker (q, IOQUEUE_MARKER_DRAIN);
+}
+
+void ioqueue_destroy (struct ioqueue *q)
+{
+	if (!q)
+		return;
+	ioqueue_marker (q, IOQUEUE_MARKER_QUIT);
+	for (int i = 0; i < q->lanes; i++) {
+		uae_wait_thread (q->lane[i].tid);
+		destroy_comm_pipe (&q->lane[i].requests);
+	}
+	ioqueue_log_stats (q);
+	uae_sem_destroy (&q->marker_sem);
+	uae_sem_destroy (&q->stats_sem);
+	xfree (q);
+}
+
+void ioqueue_submit (struct ioqueue *q, int unit, ioqueue_func func, void *ctx, uae_u32 data)
+{
+	struct ioqueue_req *req = xmalloc (struct ioqueue_req, 1);
+
+	if (unit < 0 || unit >= IOQUEUE_MAX_UNITS)
+		unit = IOQUEUE_MAX_UNITS - 1;
+	req->func = func;
+	req->ctx = ctx;
+	req->data = data;
+	req->unit = unit;
+	req->queued = read_processor_time ();
+
+	uae_sem_wait (&q->stats_sem);
+	struct ioqueue_stats *st = &q->stats[unit];
+	st->requests++;
+	st->depth++;
+	if (st->depth > st->max_depth)
+		st->max_depth = st->depth;
+	uae_sem_post (&q->stats_sem);
+
+	write_comm_pipe_pvoid (&q->lane[(unit / q->group) % q->lanes].requests, req, 1);
+}
+
+bool ioqueue_get_stats (struct ioqueue *q, int unit, struct ioqueue_stats *st)
+{
+	if (!q || unit < 0 || unit >= IOQUEUE_MAX_UNITS)
+		return false;
+	uae_sem_wait (&q->stats_sem);
+	*st = q->stats[unit];
+	uae_sem_post (&q->stats_sem);
+	return st->requests != 0;
+}
+
+void ioqueue_log_stats (struct ioqueue *q)
+{
+	if (!q)
+		return;
+	for (int i = 0; i < IOQUEUE_MAX_UNITS; i++) {
+		struct ioqueue_stats st;
+		if (!ioqueue_get_stats (q, i, &st))
+			continue;
+		write_log (_T("%s unit %d: %u requests, max depth %u, avg wait %u us, avg busy %u us, max latency %u us\n"),
+			q->name, i, st.requests, st.max_depth,
+			st.completed ? (uae_u32)(st.wait_us / st.completed) : 0,
+			st.completed ? (uae_u32)(st.busy_us / st.completed) : 0,
+			st.max_latency_us);
+	}
+}
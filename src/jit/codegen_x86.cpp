@@ -4843,6 +4843,40 @@ LOWFUNC(NONE,NONE,1,raw_fcut_r,(FRW r))
 }
 LENDFUNC(NONE,NONE,1,raw_fcut_r,(FRW r))
 
+/* SSE2 scalar double arithmetic for the FDxxx instructions. s holds a
+   memory operand that is exact in double precision, so storing it for
+   SSE2 does not round it. The result is loaded back into the x87 register
+   of the destination, the register allocator is not affected. Only used
+   with round to nearest, which is the host MXCSR setting. */
+static double sse2_fp_temp[2];
+
+LOWFUNC(NONE,NONE,3,raw_fop_sse2_rr,(FRW d, FR s, IMM op))
+{
+	uae_u32 src = uae_p32(&sse2_fp_temp[1]);
+	uae_u32 dst = uae_p32(&sse2_fp_temp[0]);
+	static const int sse2_ops[] = {
+		X86_SSE_ADD, X86_SSE_SUB, X86_SSE_MUL, X86_SSE_DIV, X86_SSE_SQRT
+	};
+
+	make_tos(s);
+	raw_fstl(src);
+	if (op == FOP_SSE2_SQRT) {
+		_SSESDmr(X86_SSE_SQRT, src, X86_NOREG, X86_NOREG, 1, X86_XMM0);
+	} else {
+		make_tos(d);
+		raw_fstpl(dst);
+		live.onstack[live.tos]=-1;
+		live.tos--;
+		live.spos[d]=-2;
+		_SSESDmr(0x10, dst, X86_NOREG, X86_NOREG, 1, X86_XMM0); /* movsd */
+		_SSESDmr(sse2_ops[op], src, X86_NOREG, X86_NOREG, 1, X86_XMM0);
+	}
+	_SSESDrm(0x11, X86_XMM0, dst, X86_NOREG, X86_NOREG, 1); /* movsd */
+	raw_fldl(dst);
+	tos_make(d);
+}
+LENDFUNC(NONE,NONE,3,raw_fop_sse2_rr,(FRW d, FR s, IMM op))
+
 LOWFUNC(NONE,NONE,2,raw_fgetexp_rr,(FW d, FR s))
 {
 	int ds;
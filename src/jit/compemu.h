@@ -176,7 +176,13 @@ static inline void flush_icache_hard(int n)
 extern void alloc_cache(void);
 extern int check_for_cache_miss(void);
 
+/* Statistics, per block data is only collected with comp_stats */
+extern void jit_stats_dump(int top);
+extern bool jit_stats_write_json(const TCHAR *path);
+extern void jit_stats_reset(void);
+
 /* JIT FPU compilation */
+extern bool comp_fpu_use_sse2 (void);
 extern void comp_fpp_opp (uae_u32 opcode, uae_u16 extra);
 extern void comp_fbcc_opp (uae_u32 opcode);
 extern void comp_fscc_opp (uae_u32 opcode, uae_u16 extra);
@@ -707,6 +707,18 @@ extern uae_u32 xhex_1e2048[], xhex_1e4096[];
 extern double fp_1e8;
 extern float  fp_1e1, fp_1e2, fp_1e4;
 
+/* FDxxx with a source from <EA> that is not extended (exact as a double)
+   can use SSE2. SSE2 runs with the host MXCSR, so only round to nearest is
+   compiled that way; fpp.cpp flushes the cache when the FPCR mode changes. */
+static bool comp_fp_sse2 (int source, int prec)
+{
+	if (!currprefs.fpu_strict || !comp_fpu_use_sse2 ())
+		return false;
+	if (!source || !prec)
+		return false;
+	return !(regs.fpcr & 0x30);
+}
+
 void comp_fpp_opp (uae_u32 opcode, uae_u16 extra)
 {
 	int reg;
@@ -725,6 +737,10 @@ void comp_fpp_opp (uae_u32 opcode, uae_u16 extra)
 			FAIL (1);
 		return;
 		case 4: /* FMOVE.L  <EA>, ControlReg */
+		if ((extra & 0x1000) && comp_fpu_use_sse2 ()) {
+			FAIL (1); /* FPCR rounding changes must flush SSE2 code */
+			return;
+		}
 		if (!(opcode & 0x30)) { /* Dn or An */
 			if (extra & 0x1000) { /* FPCR */
 				mov_l_mr (uae_p32(&regs.fpcr), opcode & 15);
@@ -1299,6 +1315,10 @@ void comp_fpp_opp (uae_u32 opcode, uae_u16 extra)
 			fcuts_r (dreg);
 			break;
 			case 0x45: /* FDSQRT */
+			if (comp_fp_sse2 (source, prec)) {
+				fop_sse2_rr (dreg, sreg, FOP_SSE2_SQRT);
+				break;
+			}
 			if (!currprefs.fpu_strict) { /* faster, but less strict rounding */
 				fsqrt_rr (dreg, sreg);
 				break;
@@ -1352,6 +1372,10 @@ void comp_fpp_opp (uae_u32 opcode, uae_u16 extra)
 			fcuts_r (dreg);
 			break;
 			case 0x64: /* FDDIV */
+			if (comp_fp_sse2 (source, prec)) {
+				fop_sse2_rr (dreg, sreg, FOP_SSE2_DIV);
+				break;
+			}
 			if (!currprefs.fpu_strict) { /* faster, but less strict rounding */
 				fdiv_rr (dreg, sreg);
 				break;
@@ -1375,6 +1399,10 @@ void comp_fpp_opp (uae_u32 opcode, uae_u16 extra)
 			fcut_r (dreg);
 			break;
 			case 0x66: /* FDADD */
+			if (comp_fp_sse2 (source, prec)) {
+				fop_sse2_rr (dreg, sreg, FOP_SSE2_ADD);
+				break;
+			}
 			if (!currprefs.fpu_strict) { /* faster, but less strict rounding */
 				fadd_rr (dreg, sreg);
 				break;
@@ -1398,6 +1426,10 @@ void comp_fpp_opp (uae_u32 opcode, uae_u16 extra)
 			fcut_r (dreg);
 			break;
 			case 0x67: /* FDMUL */
+			if (comp_fp_sse2 (source, prec)) {
+				fop_sse2_rr (dreg, sreg, FOP_SSE2_MUL);
+				break;
+			}
 			if (!currprefs.fpu_strict) { /* faster, but less strict rounding */
 				fmul_rr (dreg, sreg);
 				break;
@@ -1431,6 +1463,10 @@ void comp_fpp_opp (uae_u32 opcode, uae_u16 extra)
 			fcuts_r (dreg);
 			break;
 			case 0x6c: /* FDSUB */
+			if (comp_fp_sse2 (source, prec)) {
+				fop_sse2_rr (dreg, sreg, FOP_SSE2_SUB);
+				break;
+			}
 			if (!currprefs.fpu_strict) { /* faster, but less strict rounding */
 				fsub_rr (dreg, sreg);
 				break;
@@ -2895,6 +2895,19 @@ MIDFUNC(2,fmul_rr,(FRW d, FR s))
 }
 MENDFUNC(2,fmul_rr,(FRW d, FR s))
 
+MIDFUNC(3,fop_sse2_rr,(FRW d, FR s, IMM op))
+{
+	s=f_readreg(s);
+	if (op == FOP_SSE2_SQRT)
+		d=f_writereg(d);
+	else
+		d=f_rmw(d);
+	raw_fop_sse2_rr(d,s,op);
+	f_unlock(s);
+	f_unlock(d);
+}
+MENDFUNC(3,fop_sse2_rr,(FRW d, FR s, IMM op))
+
 #ifdef __GNUC__
 
 static inline void mfence(void)
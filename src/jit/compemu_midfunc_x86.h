@@ -248,4 +248,7 @@ DECLARE_MIDFUNC(frem_rr(FRW d, FR s));
 DECLARE_MIDFUNC(frem1_rr(FRW d, FR s));
 DECLARE_MIDFUNC(fdiv_rr(FRW d, FR s));
 DECLARE_MIDFUNC(fcmp_rr(FR d, FR s));
+/* op for fop_sse2_rr */
+enum { FOP_SSE2_ADD, FOP_SSE2_SUB, FOP_SSE2_MUL, FOP_SSE2_DIV, FOP_SSE2_SQRT };
+DECLARE_MIDFUNC(fop_sse2_rr(FRW d, FR s, IMM op));
 DECLARE_MIDFUNC(fflags_into_flags(W2 tmp));
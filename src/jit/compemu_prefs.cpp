@@ -22,6 +22,7 @@ bool check_prefs_changed_comp (bool checkonly)
 		currprefs.comp_hardflush != changed_prefs.comp_hardflush ||
 		currprefs.comp_constjump != changed_prefs.comp_constjump ||
 		currprefs.compfpu != changed_prefs.compfpu ||
+		currprefs.comp_fpu_sse2 != changed_prefs.comp_fpu_sse2 ||
 		currprefs.fpu_strict != changed_prefs.fpu_strict ||
 		currprefs.cachesize != changed_prefs.cachesize)
 		changed = 1;
@@ -37,6 +38,7 @@ bool check_prefs_changed_comp (bool checkonly)
 	currprefs.comp_hardflush = changed_prefs.comp_hardflush;
 	currprefs.comp_constjump = changed_prefs.comp_constjump;
 	currprefs.compfpu = changed_prefs.compfpu;
+	currprefs.comp_fpu_sse2 = changed_prefs.comp_fpu_sse2;
 	currprefs.fpu_strict = changed_prefs.fpu_strict;
 
 	if (currprefs.cachesize != changed_prefs.cachesize) {
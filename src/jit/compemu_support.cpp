@@ -117,6 +117,7 @@ static inline void *vm_acquire(size_t size, int options = VM_MAP_DEFAULT)
 #define UNUSED(x)
 #include "uae.h"
 #include "uae/log.h"
+#include "uae/io.h"
 #define jit_log(format, ...) \
 	uae_log("JIT: " format "\n", ##__VA_ARGS__);
 #define jit_log2(format, ...)
@@ -872,6 +873,104 @@ static inline void alloc_blockinfos(void)
 	}
 }
 
+/********************************************************************
+ * Optional statistics (comp_stats) and perf map (comp_perfmap)     *
+ ********************************************************************/
+
+/* One record per translated 68k block start, kept across recompiles and
+   cache flushes. Records are never released, since translated code
+   increments execs directly, so they come from the 32-bit pools. */
+typedef struct jit_block_stat_t {
+	uae_u32 execs;
+	uae_u32 pc;
+	uae_u8 *pc_p;
+	uae_u32 compiles;
+	uae_u32 invalidations;
+	uae_u32 code_size;
+	uae_u16 insns;
+	uae_u8 optlevel;
+	uae_u64 compile_time;
+	struct jit_block_stat_t *next;
+	struct jit_block_stat_t *hash_next;
+} jit_block_stat;
+
+#define JIT_STATS_HASH_SIZE 4096
+
+static LazyBlockAllocator<jit_block_stat> BlockStatAllocator;
+static jit_block_stat *jit_stats_hash[JIT_STATS_HASH_SIZE];
+static jit_block_stat *jit_stats_all;
+static int jit_stats_blocks;
+
+static struct {
+	uae_u32 compiles;
+	uae_u64 compile_time;
+	uae_u32 hard_flushes_full;
+	uae_u32 range_flushes;
+	uae_u32 checksum_good;
+	uae_u32 checksum_bad;
+} jit_stats;
+
+static FILE *jit_perfmap;
+
+static inline uae_u32 jit_stats_hashkey(uae_u8 *pc_p)
+{
+	return ((uintptr)pc_p >> 1) & (JIT_STATS_HASH_SIZE - 1);
+}
+
+static jit_block_stat *jit_stats_find(uae_u8 *pc_p)
+{
+	jit_block_stat *st = jit_stats_hash[jit_stats_hashkey(pc_p)];
+	while (st && st->pc_p != pc_p)
+		st = st->hash_next;
+	return st;
+}
+
+static jit_block_stat *jit_stats_get(uae_u8 *pc_p, uae_u32 pc)
+{
+	jit_block_stat *st = jit_stats_find(pc_p);
+	if (st)
+		return st;
+	st = BlockStatAllocator.acquire();
+	memset(st, 0, sizeof(jit_block_stat));
+	st->pc_p = pc_p;
+	st->pc = pc;
+	st->hash_next = jit_stats_hash[jit_stats_hashkey(pc_p)];
+	jit_stats_hash[jit_stats_hashkey(pc_p)] = st;
+	st->next = jit_stats_all;
+	jit_stats_all = st;
+	jit_stats_blocks++;
+	return st;
+}
+
+static void jit_stats_invalidated(blockinfo *bi)
+{
+	jit_stats.checksum_bad++;
+	if (currprefs.comp_stats) {
+		jit_block_stat *st = jit_stats_find(bi->pc_p);
+		if (st)
+			st->invalidations++;
+	}
+}
+
+static void jit_perfmap_add(uintptr start, uae_u32 size, uae_u32 pc)
+{
+#ifdef __linux__
+	if (!jit_perfmap) {
+		char path[64];
+		snprintf(path, sizeof path, "/tmp/perf-%d.map", (int)getpid());
+		jit_perfmap = fopen(path, "w");
+		if (!jit_perfmap) {
+			jit_log("Could not open %s, perf map disabled", path);
+			changed_prefs.comp_perfmap = currprefs.comp_perfmap = false;
+			return;
+		}
+		jit_log("Writing perf map to %s", path);
+	}
+	fprintf(jit_perfmap, "%lx %x m68k_%08x\n", (unsigned long)start, size, pc);
+	fflush(jit_perfmap);
+#endif
+}
+
 /********************************************************************
  * Functions to emit data into memory, and other general support    *
  ********************************************************************/
@@ -2717,6 +2816,12 @@ void compiler_exit(void)
 #endif
 }
 
+/* SSE2 arithmetic for FDxxx instructions with a memory source operand */
+bool comp_fpu_use_sse2(void)
+{
+	return currprefs.comp_fpu_sse2 && cpuinfo.x86_has_xmm2;
+}
+
 #ifdef UAE
 #else
 bool compiler_use_jit(void)
@@ -3626,6 +3731,7 @@ static inline int block_check_checksum(blockinfo* bi)
 		isgood=called_check_checksum(bi) != 0;
 	}
 	if (isgood) {
+		jit_stats.checksum_good++;
 		jit_log2("reactivate %p/%p (%x %x/%x %x)",bi,bi->pc_p, c1,c2,bi->c1,bi->c2);
 		remove_from_list(bi);
 		add_to_active(bi);
@@ -3636,6 +3742,7 @@ static inline int block_check_checksum(blockinfo* bi)
 		/* This block actually changed. We need to invalidate it,
 		and set it up to be recompiled */
 		jit_log2("discard %p/%p (%x %x/%x %x)",bi,bi->pc_p, c1,c2,bi->c1,bi->c2);
+		jit_stats_invalidated(bi);
 		invalidate_block(bi);
 		raise_in_cl_list(bi);
 	}
@@ -4204,6 +4311,7 @@ void flush_icache_range(uae_u32 start, uae_u32 length)
 {
 	if (!active)
 		return;
+	jit_stats.range_flushes++;
 
 #if LAZY_FLUSH_ICACHE_RANGE
 	uae_u8 *start_p = get_real_address(start);
@@ -4236,6 +4344,116 @@ void flush_icache_range(uae_u32 start, uae_u32 length)
 	flush_icache(-1);
 }
 
+static int jit_stats_compare(const void *a, const void *b)
+{
+	const jit_block_stat *s1 = *(const jit_block_stat **)a;
+	const jit_block_stat *s2 = *(const jit_block_stat **)b;
+	if (s1->execs != s2->execs)
+		return s1->execs < s2->execs ? 1 : -1;
+	return 0;
+}
+
+/* Returns all block records, hottest first. */
+static jit_block_stat **jit_stats_sorted(void)
+{
+	jit_block_stat **list = xmalloc(jit_block_stat *, jit_stats_blocks + 1);
+	int n = 0;
+	for (jit_block_stat *st = jit_stats_all; st; st = st->next)
+		list[n++] = st;
+	qsort(list, n, sizeof(jit_block_stat *), jit_stats_compare);
+	return list;
+}
+
+static void jit_stats_count_blocks(int *nactive, int *ndormant)
+{
+	*nactive = *ndormant = 0;
+	for (blockinfo *bi = active; bi; bi = bi->next)
+		(*nactive)++;
+	for (blockinfo *bi = dormant; bi; bi = bi->next)
+		(*ndormant)++;
+}
+
+static double jit_stats_ms(uae_u64 t)
+{
+	return syncbase ? t * 1000.0 / syncbase : 0.0;
+}
+
+void jit_stats_dump(int top)
+{
+	int nactive, ndormant;
+	uae_u32 used = get_jitted_size();
+
+	jit_stats_count_blocks(&nactive, &ndormant);
+	console_out_f(_T("JIT cache: %u of %u KB used (%.1f%%), %d active, %d dormant blocks\n"),
+		used / 1024, cache_size, cache_size ? used * 100.0 / (cache_size * 1024.0) : 0.0,
+		nactive, ndormant);
+	console_out_f(_T("Compiles: %u (%.1f ms)\n"), jit_stats.compiles, jit_stats_ms(jit_stats.compile_time));
+	console_out_f(_T("Flushes: soft %d, hard %d (cache full %u), range %u\n"),
+		soft_flush_count, hard_flush_count, jit_stats.hard_flushes_full, jit_stats.range_flushes);
+	console_out_f(_T("Checksum checks: %d, unchanged %u, invalidated %u\n"),
+		checksum_count, jit_stats.checksum_good, jit_stats.checksum_bad);
+	if (!currprefs.comp_stats) {
+		console_out_f(_T("Per block statistics are disabled (comp_stats=false)\n"));
+		return;
+	}
+	console_out_f(_T("%d blocks recorded\n"), jit_stats_blocks);
+	console_out_f(_T("%-8s %12s %8s %6s %6s %5s %3s %9s\n"),
+		_T("PC"), _T("execs"), _T("compiles"), _T("inval"), _T("bytes"), _T("insns"), _T("opt"), _T("comp ms"));
+	jit_block_stat **list = jit_stats_sorted();
+	for (int i = 0; i < jit_stats_blocks && i < top; i++) {
+		jit_block_stat *st = list[i];
+		console_out_f(_T("%08X %12u %8u %6u %6u %5u %3u %9.3f\n"),
+			st->pc, st->execs, st->compiles, st->invalidations,
+			st->code_size, st->insns, st->optlevel, jit_stats_ms(st->compile_time));
+	}
+	xfree(list);
+}
+
+bool jit_stats_write_json(const TCHAR *path)
+{
+	int nactive, ndormant;
+	FILE *f = uae_tfopen(path, _T("w"));
+	if (!f)
+		return false;
+	jit_stats_count_blocks(&nactive, &ndormant);
+	fprintf(f, "{\n");
+	fprintf(f, "  \"cache\": {\"size\": %u, \"used\": %u, \"active\": %d, \"dormant\": %d},\n",
+		cache_size * 1024, get_jitted_size(), nactive, ndormant);
+	fprintf(f, "  \"compiles\": %u,\n  \"compile_ms\": %.3f,\n",
+		jit_stats.compiles, jit_stats_ms(jit_stats.compile_time));
+	fprintf(f, "  \"flushes\": {\"soft\": %d, \"hard\": %d, \"cache_full\": %u, \"range\": %u},\n",
+		soft_flush_count, hard_flush_count, jit_stats.hard_flushes_full, jit_stats.range_flushes);
+	fprintf(f, "  \"checksum\": {\"checks\": %d, \"unchanged\": %u, \"invalidated\": %u},\n",
+		checksum_count, jit_stats.checksum_good, jit_stats.checksum_bad);
+	fprintf(f, "  \"blocks\": [");
+	jit_block_stat **list = jit_stats_sorted();
+	for (int i = 0; i < jit_stats_blocks; i++) {
+		jit_block_stat *st = list[i];
+		fprintf(f, "%s\n    {\"pc\": %u, \"execs\": %u, \"compiles\": %u, \"invalidations\": %u, "
+			"\"code_size\": %u, \"insns\": %u, \"optlevel\": %u, \"compile_ms\": %.3f}",
+			i ? "," : "", st->pc, st->execs, st->compiles, st->invalidations,
+			st->code_size, st->insns, st->optlevel, jit_stats_ms(st->compile_time));
+	}
+	xfree(list);
+	fprintf(f, "\n  ]\n}\n");
+	fclose(f);
+	return true;
+}
+
+void jit_stats_reset(void)
+{
+	for (jit_block_stat *st = jit_stats_all; st; st = st->next) {
+		st->execs = 0;
+		st->compiles = 0;
+		st->invalidations = 0;
+		st->compile_time = 0;
+	}
+	memset(&jit_stats, 0, sizeof jit_stats);
+	soft_flush_count = 0;
+	hard_flush_count = 0;
+	checksum_count = 0;
+}
+
 /*
 static void catastrophe(void)
 {
@@ -4347,6 +4565,8 @@ static void compile_block(cpu_history* pc_hist, int blocklen)
 #endif
 
 		/* OK, here we need to 'compile' a block */
+		frame_time_t stats_start_time = read_processor_time();
+		jit_block_stat *stat = NULL;
 		int i;
 		int r;
 		int was_comp=0;
@@ -4366,8 +4586,10 @@ static void compile_block(cpu_history* pc_hist, int blocklen)
 		int extra_len=0;
 
 		redo_current_block=0;
-		if (current_compile_p >= MAX_COMPILE_PTR)
+		if (current_compile_p >= MAX_COMPILE_PTR) {
+			jit_stats.hard_flushes_full++;
 			flush_icache_hard(0, 3);
+		}
 
 		alloc_blockinfos();
 
@@ -4463,6 +4685,10 @@ static void compile_block(cpu_history* pc_hist, int blocklen)
 	
 		log_startblock();
 
+		if (currprefs.comp_stats) {
+			stat = jit_stats_get(bi->pc_p, start_pc + ((uae_u8 *)pc_hist[0].location - start_pc_p));
+			compemu_raw_add_l_mi((uintptr)&stat->execs, 1);
+		}
 		if (bi->count>=0) { /* Need to generate countdown code */
 			compemu_raw_mov_l_mi((uintptr)&regs.pc_p,(uintptr)pc_hist[0].location);
 			compemu_raw_sub_l_mi((uintptr)&(bi->count),1);
@@ -4848,9 +5074,27 @@ static void compile_block(cpu_history* pc_hist, int blocklen)
 		raise_in_cl_list(bi);
 		bi->nexthandler=current_compile_p;
 
+		if (currprefs.comp_perfmap) {
+			jit_perfmap_add(current_block_start_target,
+				(uintptr)current_compile_p - current_block_start_target,
+				start_pc + ((uae_u8 *)pc_hist[0].location - start_pc_p));
+		}
+		jit_stats.compiles++;
+		if (stat) {
+			frame_time_t t = read_processor_time() - stats_start_time;
+			stat->compiles++;
+			stat->compile_time += t;
+			stat->code_size = (uintptr)current_compile_p - current_block_start_target;
+			stat->insns = blocklen;
+			stat->optlevel = optlev;
+			jit_stats.compile_time += t;
+		}
+
 		/* We will flush soon, anyway, so let's do it now */
-		if (current_compile_p >= MAX_COMPILE_PTR)
+		if (current_compile_p >= MAX_COMPILE_PTR) {
+			jit_stats.hard_flushes_full++;
 			flush_icache_hard(0, 3);
+		}
 
 		bi->status=BI_ACTIVE;
 		if (redo_current_block)
@@ -76,6 +76,18 @@ int record_key_direct (int kc)
 	return 1;
 }
 
+/* Used by run-ahead to give back keys consumed by frames which are
+ * discarded afterwards. */
+int keybuf_getreadpos (void)
+{
+	return kpb_last;
+}
+
+void keybuf_setreadpos (int pos)
+{
+	kpb_last = pos;
+}
+
 void keybuf_init (void)
 {
 	kpb_first = kpb_last = 0;
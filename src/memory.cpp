@@ -37,6 +37,7 @@
 #include "cpuboard.h"
 #include "uae/ppc.h"
 #include "devices.h"
+#include "uae/vm.h"
 
 #ifdef FSUAE // NL
 #undef _WIN32
@@ -2349,6 +2350,40 @@ void memory_clear (void)
 	cpuboard_clear();
 }
 
+#ifdef FSUAE
+
+/* Back ROM banks with a copy-on-write mapping of a file named after the
+ * ROM contents, so several emulator instances using the same ROMs share
+ * the physical memory. */
+static void share_rom_bank(addrbank *ab, const TCHAR *dir)
+{
+	if (!ab->baseaddr || !ab->allocated)
+		return;
+#ifdef NATMEM_OFFSET
+	/* Only memory from the natmem area is page aligned and mmap'ed */
+	if (!(ab->flags & ABFLAG_DIRECTMAP))
+		return;
+#endif
+	TCHAR path[MAX_DPATH];
+	_sntprintf(path, MAX_DPATH, _T("%s%s-%s.rom"), dir, ab->label,
+		get_sha1_txt(ab->baseaddr, ab->allocated));
+	if (uae_vm_share_pages(ab->baseaddr, ab->allocated, path))
+		write_log(_T("MMAN: %s is shared with %s\n"), ab->label, path);
+}
+
+static void share_roms(void)
+{
+	TCHAR dir[MAX_DPATH];
+	fetch_sharedrompath(dir, sizeof dir / sizeof (TCHAR));
+	if (!dir[0])
+		return;
+	share_rom_bank(&kickmem_bank, dir);
+	share_rom_bank(&extendedkickmem_bank, dir);
+	share_rom_bank(&extendedkickmem2_bank, dir);
+}
+
+#endif
+
 static void restore_roms(void)
 {
 	roms_modified = false;
@@ -2412,6 +2447,9 @@ static void restore_roms(void)
 		}
 	}
 	patch_kick ();
+#ifdef FSUAE
+	share_roms ();
+#endif
 	write_log (_T("ROM loader end\n"));
 	protect_roms (true);
 }
@@ -44,6 +44,7 @@
 #include "threaddep/thread.h"
 #include "x86.h"
 #include "bsdsocket.h"
+#include "cpuharness.h"
 #ifdef JIT
 #include "jit/compemu.h"
 #include <signal.h>
@@ -5305,6 +5306,97 @@ bool is_keyboardreset(void)
 	return  cpu_keyboardreset;
 }
 
+/* CPU harness (cpuharness.cpp) support. m68k_harness_run executes the
+ * current core from pc until a STOP instruction, without chipset emulation
+ * in between. Opcode fetch follows the run loop m68k_go would select for
+ * the current CPU settings. Returns the number of executed instructions
+ * (0 with JIT, where they are not counted), or -1 if STOP was not reached
+ * within maxinsns instructions (maxinsns passes through the translation
+ * cache with JIT) or a bus error was thrown. */
+
+void m68k_harness_rebuild (void)
+{
+	build_cpufunctbl ();
+	set_x_funcs ();
+	update_68k_cycles ();
+	set_cpu_caches (true);
+}
+
+int m68k_harness_opcode_length (uae_u16 opcode)
+{
+	if (cpufunctbl[opcode] == op_illg_1 || cpudatatbl[opcode].branch)
+		return -1;
+	return cpudatatbl[opcode].length;
+}
+
+int m68k_harness_run (uaecptr pc, int maxinsns)
+{
+	struct regstruct *r = &regs;
+	volatile int count = 0;
+
+	unset_special (SPCFLAG_STOP);
+	r->stopped = 0;
+	m68k_setpc_normal (pc);
+	fill_prefetch ();
+#ifdef JIT
+	if (currprefs.cachesize) {
+		/* each pass runs at least one translated block */
+		int passes;
+		for (passes = 0; passes < maxinsns; passes++) {
+			((compiled_handler*)(pushall_call_handler))();
+			if (r->spcflags & SPCFLAG_STOP)
+				break;
+			if (r->spcflags && do_specialties (0)) {
+				count = -1;
+				break;
+			}
+		}
+		if (passes >= maxinsns)
+			count = -1;
+	} else
+#endif
+	{
+		TRY (prb) {
+			while (count < maxinsns && !(r->spcflags & SPCFLAG_STOP)) {
+				r->instruction_pc = m68k_getpc ();
+				if (currprefs.mmu_model) {
+					mmu_restart = true;
+					mmu_opcode = -1;
+					mmu060_state = 0;
+					mmu030_state[0] = mmu030_state[1] = mmu030_state[2] = 0;
+					mmu_opcode = r->opcode = x_prefetch (0);
+					mmu060_state = 1;
+					mmu030_opcode = r->opcode;
+					mmu030_ad[0].done = false;
+					mmu030_idx = 0;
+					mmu030_retry = false;
+				} else if (currprefs.cpu_compatible && currprefs.cpu_model <= 68010) {
+					r->opcode = r->ir;
+				} else if (currprefs.cpu_compatible && currprefs.cpu_model <= 68030) {
+					r->opcode = r->irc;
+				} else if (currprefs.cpu_compatible) {
+					r->opcode = get_iword_cache_040 (0);
+					if (r->cacr & 0x8000)
+						fill_icache040 (r->instruction_pc + 16);
+				} else {
+					r->opcode = x_get_iword (0);
+				}
+				(*cpufunctbl[r->opcode])(r->opcode);
+				if (currprefs.mmu_model)
+					mmu030_opcode = -1;
+				count++;
+			}
+		} CATCH (prb) {
+			count = -1;
+		} ENDTRY
+		if (count >= 0 && !(r->spcflags & SPCFLAG_STOP))
+			count = -1;
+	}
+	r->stopped = 0;
+	unset_special (SPCFLAG_STOP);
+	return count;
+}
+
 void m68k_go (int may_quit)
 {
 	int hardboot = 1;
@@ -5359,6 +5451,8 @@ void m68k_go (int may_quit)
 				restore_state (savestate_fname);
 			else if (savestate_state == STATE_REWIND)
 				savestate_rewind ();
+			else if (savestate_state == STATE_RUNAHEAD)
+				savestate_runahead_restore ();
 #endif
 			set_cycles (start_cycles);
 			custom_reset (cpu_hardreset != 0, cpu_keyboardreset);
@@ -5371,12 +5465,14 @@ void m68k_go (int may_quit)
 #ifdef SAVESTATE
 			/* We may have been restoring state, but we're done now.  */
 			if (isrestore ()) {
+				bool runahead = savestate_state == STATE_RUNAHEAD;
 				if (debug_dma) {
 					record_dma_reset ();
 					record_dma_reset ();
 				}
 				savestate_restore_finish ();
-				memory_map_dump ();
+				if (!runahead)
+					memory_map_dump ();
 				if (currprefs.mmu_model == 68030) {
 					mmu030_decode_tc (tc_030);
 				} else if (currprefs.mmu_model >= 68040) {
@@ -5446,6 +5542,14 @@ void m68k_go (int may_quit)
 		event_wait = true;
 		unset_special(SPCFLAG_MODE_CHANGE);
 
+		if (currprefs.cpuharnessfile[0]) {
+			cpu_harness_run (currprefs.cpuharnessfile);
+			changed_prefs.cpuharnessfile[0] = currprefs.cpuharnessfile[0] = 0;
+			uae_quit ();
+			quit_program = UAE_QUIT;
+			continue;
+		}
+
 		if (regs.halted) {
 			cpu_halt (regs.halted);
 			if (regs.halted < 0) {
@@ -46,8 +46,31 @@ struct hardfilehandle
     int zfile;
     struct zfile *zf;
     FILE *h;
+    /* copy-on-write overlay, see hdf_overlay_open */
+    FILE *overlay;
+    uae_u32 *overlay_map;
+    uae_u32 overlay_blocks;
+    uae_u32 overlay_used;
+    uae_u64 overlay_data;
 };
 
+/* Overlay file format: a 512 byte header, followed by one 32-bit big
+ * endian map entry per OVERLAY_BLOCK_SIZE block of the base image, and
+ * then the modified blocks in the order they were first written. A map
+ * entry of 0 means the block is read from the base image, otherwise it
+ * is the 1-based index of the block in the overlay data area. */
+#define OVERLAY_MAGIC "FSUAECOW"
+#define OVERLAY_VERSION 1
+#define OVERLAY_BLOCK_SIZE 65536
+#define OVERLAY_HEADER_SIZE 512
+
+struct hdf_overlay_path {
+    char *path;
+    char *overlay_path;
+};
+
+static struct hdf_overlay_path g_overlay_paths[MAX_FILESYSTEM_UNITS];
+
 struct uae_driveinfo {
     char vendor_id[128];
     char product_id[128];
@@ -207,6 +230,149 @@ static int isharddrive (const TCHAR *name)
 
 static const char *hdz[] = { "hdz", "zip", "rar", "7z", NULL };
 
+extern "C" {
+
+void amiga_add_hard_drive_overlay(const char *path, const char *overlay_path)
+{
+    for (int i = 0; i < MAX_FILESYSTEM_UNITS; i++) {
+        struct hdf_overlay_path *op = &g_overlay_paths[i];
+        if (op->path == NULL || strcmp(op->path, path) == 0) {
+            write_log("hdf overlay: %s -> %s\n", path, overlay_path);
+            free(op->path);
+            free(op->overlay_path);
+            op->path = strdup(path);
+            op->overlay_path = strdup(overlay_path);
+            return;
+        }
+    }
+    write_log("hdf overlay: too many overlays, ignoring %s\n", overlay_path);
+}
+
+} // extern "C"
+
+static const char *hdf_overlay_path (const char *path)
+{
+    for (int i = 0; i < MAX_FILESYSTEM_UNITS; i++) {
+        if (g_overlay_paths[i].path && strcmp(g_overlay_paths[i].path, path) == 0)
+            return g_overlay_paths[i].overlay_path;
+    }
+    return NULL;
+}
+
+static void hdf_overlay_put32 (uae_u8 *p, uae_u32 v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v >> 0;
+}
+
+static uae_u32 hdf_overlay_get32 (const uae_u8 *p)
+{
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | (p[3] << 0);
+}
+
+/* Dynamic VHD images start with a copy of the footer, disk type 3. */
+static bool hdf_overlay_base_is_dynamic_vhd (struct hardfiledata *hfd)
+{
+    struct hardfilehandle *hh = hfd->handle;
+    uae_u8 footer[512];
+    size_t len;
+
+    if (hh->zfile) {
+        zfile_fseek (hh->zf, 0, SEEK_SET);
+        len = zfile_fread (footer, 1, sizeof footer, hh->zf);
+    } else {
+        if (uae_fseeko64 (hh->h, 0, SEEK_SET) != 0)
+            return false;
+        len = fread (footer, 1, sizeof footer, hh->h);
+    }
+    return len == sizeof footer && memcmp (footer, "conectix", 8) == 0
+            && hdf_overlay_get32 (footer + 0x3c) == 3;
+}
+
+/* Opens (or creates) the copy-on-write overlay for the base image which
+ * has already been opened read-only. */
+static int hdf_overlay_open (struct hardfiledata *hfd, const char *path)
+{
+    struct hardfilehandle *hh = hfd->handle;
+    uae_u8 header[OVERLAY_HEADER_SIZE];
+    uae_u32 blocks = (hfd->physsize + OVERLAY_BLOCK_SIZE - 1) / OVERLAY_BLOCK_SIZE;
+    uae_u32 mapsize = (blocks * 4 + OVERLAY_HEADER_SIZE - 1) & ~(OVERLAY_HEADER_SIZE - 1);
+
+    /* writes to a dynamic VHD grow the image file, which the block map
+     * (sized for the base image) cannot follow */
+    if (hdf_overlay_base_is_dynamic_vhd (hfd)) {
+        gui_message ("Overlay %s cannot be used with a dynamic VHD image, "
+                "convert the image to a fixed size VHD or HDF first", path);
+        return 0;
+    }
+    uae_u8 *map = xcalloc (uae_u8, mapsize);
+
+    hh->overlay = uae_tfopen (path, "r+b");
+    if (hh->overlay == NULL) {
+        write_log ("hdf overlay: creating %s (%u blocks)\n", path, blocks);
+        hh->overlay = uae_tfopen (path, "w+b");
+        if (hh->overlay == NULL) {
+            write_log ("hdf overlay: could not create %s\n", path);
+            xfree (map);
+            return 0;
+        }
+        memset (header, 0, sizeof header);
+        memcpy (header, OVERLAY_MAGIC, 8);
+        hdf_overlay_put32 (header + 8, OVERLAY_VERSION);
+        hdf_overlay_put32 (header + 12, OVERLAY_BLOCK_SIZE);
+        hdf_overlay_put32 (header + 16, (uae_u32) (hfd->physsize >> 32));
+        hdf_overlay_put32 (header + 20, (uae_u32) hfd->physsize);
+        hdf_overlay_put32 (header + 24, blocks);
+        if (fwrite (header, 1, sizeof header, hh->overlay) != sizeof header
+                || fwrite (map, 1, mapsize, hh->overlay) != mapsize
+                || fflush (hh->overlay) != 0) {
+            write_log ("hdf overlay: could not write header to %s\n", path);
+            goto fail;
+        }
+    } else {
+        if (fread (header, 1, sizeof header, hh->overlay) != sizeof header
+                || memcmp (header, OVERLAY_MAGIC, 8) != 0
+                || hdf_overlay_get32 (header + 8) != OVERLAY_VERSION
+                || hdf_overlay_get32 (header + 12) != OVERLAY_BLOCK_SIZE) {
+            write_log ("hdf overlay: %s is not a valid overlay file\n", path);
+            goto fail;
+        }
+        uae_u64 basesize = ((uae_u64) hdf_overlay_get32 (header + 16) << 32)
+                | hdf_overlay_get32 (header + 20);
+        if (basesize != hfd->physsize || hdf_overlay_get32 (header + 24) != blocks) {
+            gui_message ("Overlay %s was created for a different hard drive "
+                    "image (size %lld, expected %lld)", path, basesize,
+                    hfd->physsize);
+            goto fail;
+        }
+        if (fread (map, 1, mapsize, hh->overlay) != mapsize) {
+            write_log ("hdf overlay: could not read block map from %s\n", path);
+            goto fail;
+        }
+    }
+    hh->overlay_blocks = blocks;
+    hh->overlay_map = xmalloc (uae_u32, blocks);
+    hh->overlay_used = 0;
+    for (uae_u32 i = 0; i < blocks; i++) {
+        hh->overlay_map[i] = hdf_overlay_get32 (map + i * 4);
+        if (hh->overlay_map[i] > hh->overlay_used)
+            hh->overlay_used = hh->overlay_map[i];
+    }
+    /* data blocks are aligned to the block size within the file */
+    hh->overlay_data = (OVERLAY_HEADER_SIZE + mapsize + OVERLAY_BLOCK_SIZE - 1) & ~(uae_u64) (OVERLAY_BLOCK_SIZE - 1);
+    xfree (map);
+    write_log ("hdf overlay: %s opened, %u of %u blocks modified\n", path,
+            hh->overlay_used, blocks);
+    return 1;
+fail:
+    fclose (hh->overlay);
+    hh->overlay = NULL;
+    xfree (map);
+    return 0;
+}
+
 int hdf_open_target (struct hardfiledata *hfd, const char *pname)
 {
     FILE *h = INVALID_HANDLE_VALUE;
@@ -287,7 +453,8 @@ int hdf_open_target (struct hardfiledata *hfd, const char *pname)
                     zmode = 1;
             }
         }
-        h = uae_tfopen (name, hfd->ci.readonly ? "rb" : "r+b");
+        const char *overlay_path = hdf_overlay_path (name);
+        h = uae_tfopen (name, hfd->ci.readonly || overlay_path ? "rb" : "r+b");
         if (h == INVALID_HANDLE_VALUE)
             goto end;
         hfd->handle->h = h;
@@ -372,7 +539,7 @@ int hdf_open_target (struct hardfiledata *hfd, const char *pname)
                 write_log ("HDF '%s' re-opened in zfile-mode\n", name);
                 fclose (h);
                 hfd->handle->h = INVALID_HANDLE_VALUE;
-                hfd->handle->zf = zfile_fopen(name, hfd->ci.readonly ? "rb" : "r+b", ZFD_NORMAL);
+                hfd->handle->zf = zfile_fopen(name, hfd->ci.readonly || overlay_path ? "rb" : "r+b", ZFD_NORMAL);
                 hfd->handle->zfile = 1;
                 if (!h)
                     goto end;
@@ -385,6 +552,8 @@ int hdf_open_target (struct hardfiledata *hfd, const char *pname)
                 zfile_fseek (hfd->handle->zf, 0, SEEK_SET);
                 hfd->handle_valid = HDF_HANDLE_ZFILE;
             }
+            if (overlay_path && !hdf_overlay_open (hfd, overlay_path))
+                goto end;
         } else {
             write_log ("HDF '%s' failed to open. error = %d\n", name, errno);
         }
@@ -417,6 +586,10 @@ static void freehandle (struct hardfilehandle *h)
 
 void hdf_close_target (struct hardfiledata *hfd) {
     write_log("hdf_close_target\n");
+    if (hfd->handle && hfd->handle->overlay) {
+        fclose(hfd->handle->overlay);
+        xfree(hfd->handle->overlay_map);
+    }
     if (hfd->handle && hfd->handle->h) {
         write_log("closing file handle %p\n", hfd->handle->h);
         fclose(hfd->handle->h);
@@ -569,6 +742,9 @@ static int hdf_read_2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, i
     return 0;
 }
 
+static int hdf_read_base (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
+static int hdf_overlay_read (struct hardfiledata *hfd, uae_u8 *p, uae_u64 offset, int len);
+
 int hdf_read_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
     int got = 0;
@@ -584,6 +760,16 @@ int hdf_read_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int
         return len2;
     }
     offset -= hfd->virtual_size;
+    if (hfd->handle->overlay)
+        return got + hdf_overlay_read (hfd, p, offset, len);
+    return got + hdf_read_base (hfd, p, offset, len);
+}
+
+static int hdf_read_base (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
+{
+    int got = 0;
+    uae_u8 *p = (uae_u8*)buffer;
+
     while (len > 0) {
         int maxlen;
         int ret = 0;
@@ -659,6 +845,101 @@ static int hdf_write_2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset,
     }
     return outlen;
 }
+static uae_u64 hdf_overlay_block_offset (struct hardfilehandle *hh, uae_u32 index)
+{
+    return hh->overlay_data + (uae_u64) (index - 1) * OVERLAY_BLOCK_SIZE;
+}
+
+static int hdf_overlay_read (struct hardfiledata *hfd, uae_u8 *p, uae_u64 offset, int len)
+{
+    struct hardfilehandle *hh = hfd->handle;
+    int got = 0;
+
+    while (len > 0) {
+        uae_u32 block = offset / OVERLAY_BLOCK_SIZE;
+        int blockoffset = offset % OVERLAY_BLOCK_SIZE;
+        int maxlen = OVERLAY_BLOCK_SIZE - blockoffset;
+        if (maxlen > len)
+            maxlen = len;
+        int ret;
+        if (block < hh->overlay_blocks && hh->overlay_map[block]) {
+            ret = 0;
+            if (uae_fseeko64 (hh->overlay, hdf_overlay_block_offset (hh, hh->overlay_map[block]) + blockoffset, SEEK_SET) == 0)
+                ret = fread (p, 1, maxlen, hh->overlay);
+        } else {
+            ret = hdf_read_base (hfd, p, offset, maxlen);
+        }
+        got += ret;
+        if (ret != maxlen)
+            return got;
+        offset += maxlen;
+        p += maxlen;
+        len -= maxlen;
+    }
+    return got;
+}
+
+/* Writes go to the overlay only. The first write to a block copies it
+ * from the base image, the data is flushed before the block map entry
+ * is updated so the overlay stays consistent if interrupted. */
+static int hdf_overlay_write (struct hardfiledata *hfd, uae_u8 *p, uae_u64 offset, int len)
+{
+    struct hardfilehandle *hh = hfd->handle;
+    int got = 0;
+
+    if (hfd->ci.readonly)
+        return 0;
+    while (len > 0) {
+        uae_u32 block = offset / OVERLAY_BLOCK_SIZE;
+        int blockoffset = offset % OVERLAY_BLOCK_SIZE;
+        int maxlen = OVERLAY_BLOCK_SIZE - blockoffset;
+        if (maxlen > len)
+            maxlen = len;
+        if (block >= hh->overlay_blocks)
+            return got;
+        if (!hh->overlay_map[block]) {
+            uae_u64 blockstart = (uae_u64) block * OVERLAY_BLOCK_SIZE;
+            int blocklen = OVERLAY_BLOCK_SIZE;
+            if (blockstart + blocklen > hfd->physsize)
+                blocklen = hfd->physsize - blockstart;
+            uae_u8 *buf = xcalloc (uae_u8, OVERLAY_BLOCK_SIZE);
+            if (hdf_read_base (hfd, buf, blockstart, blocklen) != blocklen) {
+                write_log ("hdf overlay: base read error at %llx\n", blockstart);
+                xfree (buf);
+                return got;
+            }
+            memcpy (buf + blockoffset, p, maxlen);
+            uae_u32 index = hh->overlay_used + 1;
+            uae_u8 entry[4];
+            hdf_overlay_put32 (entry, index);
+            bool ok = uae_fseeko64 (hh->overlay, hdf_overlay_block_offset (hh, index), SEEK_SET) == 0
+                    && fwrite (buf, 1, OVERLAY_BLOCK_SIZE, hh->overlay) == OVERLAY_BLOCK_SIZE
+                    && fflush (hh->overlay) == 0
+                    && uae_fseeko64 (hh->overlay, OVERLAY_HEADER_SIZE + block * 4, SEEK_SET) == 0
+                    && fwrite (entry, 1, 4, hh->overlay) == 4
+                    && fflush (hh->overlay) == 0;
+            xfree (buf);
+            if (!ok) {
+                write_log ("hdf overlay: write error, errno %d\n", errno);
+                return got;
+            }
+            hh->overlay_used = index;
+            hh->overlay_map[block] = index;
+        } else {
+            if (uae_fseeko64 (hh->overlay, hdf_overlay_block_offset (hh, hh->overlay_map[block]) + blockoffset, SEEK_SET) != 0
+                    || (int) fwrite (p, 1, maxlen, hh->overlay) != maxlen) {
+                write_log ("hdf overlay: write error, errno %d\n", errno);
+                return got;
+            }
+        }
+        got += maxlen;
+        offset += maxlen;
+        p += maxlen;
+        len -= maxlen;
+    }
+    return got;
+}
+
 int hdf_write_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
     int got = 0;
@@ -681,6 +962,8 @@ int hdf_write_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, in
         return len;
     }
     offset -= hfd->virtual_size;
+    if (hfd->handle->overlay)
+        return hdf_overlay_write (hfd, p, offset, len);
     while (len > 0) {
         int maxlen = len > CACHE_SIZE ? CACHE_SIZE : len;
         int ret = hdf_write_2 (hfd, p, offset, maxlen);
@@ -698,6 +981,11 @@ int hdf_write_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, in
 
 int hdf_resize_target(struct hardfiledata *hfd, uae_u64 newsize)
 {
+    if (hfd->handle->overlay) {
+        /* hdf_overlay_open refuses dynamic VHD images */
+        uae_log("hdf_resize_target: not supported with overlay\n");
+        return 0;
+    }
     if (newsize < hfd->physsize) {
         uae_log("hdf_resize_target: truncation not implemented\n");
         return 0;
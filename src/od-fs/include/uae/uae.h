@@ -72,6 +72,8 @@ int amiga_enable_parallel_port(const char *parallel_name);
 
 void amiga_set_save_image_dir(const char *path);
 void amiga_set_module_ripper_dir(const char *path);
+void amiga_set_shared_rom_dir(const char *path);
+void amiga_add_hard_drive_overlay(const char *path, const char *overlay_path);
 
 int amiga_set_min_first_line(int line, int ntsc);
 
@@ -87,6 +89,11 @@ int amiga_get_rand_checksum();
 int amiga_get_state_checksum(void);
 int amiga_get_state_checksum_and_dump(void *data, int size);
 
+int amiga_replay_input_recording(const char *path);
+int amiga_input_replay_active(void);
+void amiga_get_hardware_modes(char *cpu, int cpu_size,
+        char *chipset, int chipset_size);
+
 void amiga_floppy_set_writable_images(int writable);
 const char *amiga_floppy_get_file(int index);
 const char *amiga_floppy_get_list_entry(int index);
@@ -109,6 +116,8 @@ int amiga_floppy_set_from_list(int drive, int index);
 
 int amiga_state_save(int slot);
 
+int amiga_state_save_file(const char *path);
+
 int amiga_state_load(int slot);
 
 int amiga_quit();
@@ -6,6 +6,7 @@
 #include "inputdevice.h"
 #include "moduleripper.h"
 #include "options.h"
+#include "savestate.h"
 #include "xwin.h"
 #include "uae/fs.h"
 
@@ -196,7 +197,13 @@ void gui_gameport_button_change (int port, int button, int onoff) {
 #endif
 
 int handle_msgpump (void) {
+#ifdef SAVESTATE
+    /* Input is left queued while emulating run-ahead frames, so it is
+     * not lost when the state is restored. */
+    if (g_libamiga_callbacks.event && !savestate_runahead_ahead()) {
+#else
     if (g_libamiga_callbacks.event) {
+#endif
         // g_libamiga_callbacks.event(hsync_counter);
         g_libamiga_callbacks.event(vpos);
     }
@@ -18,6 +18,8 @@
 #include "disk.h"
 #include "gui.h"
 #include "events.h"
+#include "inputrecord.h"
+#include "savestate.h"
 #include "luascript.h"
 
 #include "uae/fs.h"
@@ -300,6 +302,51 @@ int amiga_get_state_checksum_and_dump(void *data, int size)
     return checksum & 0x00ffffff;
 }
 
+int amiga_replay_input_recording(const char *path)
+{
+    if (path == NULL || !path[0]) {
+        return 0;
+    }
+    write_log("replaying input recording %s\n", path);
+    _tcsncpy(changed_prefs.inprecfile, path, MAX_DPATH - 1);
+    changed_prefs.inprecfile[MAX_DPATH - 1] = 0;
+    _tcscpy(currprefs.inprecfile, changed_prefs.inprecfile);
+    /* m68k_go opens the recording (and its linked state) on startup */
+    input_play = INPREC_PLAY_NORMAL;
+    return 1;
+}
+
+int amiga_input_replay_active(void)
+{
+    return input_play != 0;
+}
+
+void amiga_get_hardware_modes(char *cpu, int cpu_size,
+        char *chipset, int chipset_size)
+{
+    const char *mode = "fast";
+    if (currprefs.cachesize) {
+        mode = "jit";
+    } else if (currprefs.cpu_cycle_exact) {
+        mode = "cycle-exact";
+    } else if (currprefs.cpu_compatible) {
+        mode = "compatible";
+    }
+    snprintf(cpu, cpu_size, "%d/%s", currprefs.cpu_model, mode);
+
+    const char *type = "OCS";
+    if (currprefs.chipset_mask & CSMASK_AGA) {
+        type = "AGA";
+    } else if ((currprefs.chipset_mask & CSMASK_ECS_AGNUS) &&
+            (currprefs.chipset_mask & CSMASK_ECS_DENISE)) {
+        type = "ECS";
+    } else if (currprefs.chipset_mask & CSMASK_ECS_AGNUS) {
+        type = "ECS-Agnus";
+    }
+    snprintf(chipset, chipset_size, "%s/%s", type,
+            currprefs.immediate_blits ? "immediate-blits" : "normal");
+}
+
 void amiga_main(void)
 {
     write_log("amiga_main\n");
@@ -398,6 +445,14 @@ int amiga_state_save(int slot) {
     return 1;
 }
 
+int amiga_state_save_file(const char *path) {
+    /* Must be called from the emulation thread, e.g. from the event
+     * function at the end of a frame. */
+    write_log("amiga_state_save_file %s\n", path);
+    savestate_initsave(path, g_amiga_savestate_docompress, 1, true);
+    return save_state(path, _T("")) > 0;
+}
+
 int amiga_state_load(int slot) {
     if (slot < 0) {
         return 0;
@@ -12,8 +12,18 @@
 int log_scsi = 0;
 int log_net = 0;
 
+static int g_write_log_mute;
+
+void write_log_mute (int mute)
+{
+    g_write_log_mute = mute;
+}
+
 void write_log (const TCHAR *format, ...)
 {
+    if (g_write_log_mute) {
+        return;
+    }
     va_list args;
     va_start(args, format);
     char *buffer = g_strdup_vprintf(format, args);
@@ -11,6 +11,7 @@ char *g_libamiga_save_image_path = NULL;
 
 static const char **g_native_library_dirs;
 static char *g_module_ripper_dir = NULL;
+static char *g_shared_rom_dir = NULL;
 
 const TCHAR **uaenative_get_library_dirs(void)
 {
@@ -151,6 +152,16 @@ void fetch_ripperpath (TCHAR *out, int size)
 	}
 }
 
+void fetch_sharedrompath (TCHAR *out, int size)
+{
+	if (g_shared_rom_dir) {
+		_tcscpy(out, g_shared_rom_dir);
+		fixtrailing(out);
+	} else {
+		_tcscpy(out, _T(""));
+	}
+}
+
 void fetch_statefilepath (TCHAR *out, int size)
 {
 	fetch_path("StatefilePath", out, size);
@@ -194,4 +205,10 @@ void amiga_set_module_ripper_dir(const char *path)
 	g_module_ripper_dir = strdup(path);
 }
 
+void amiga_set_shared_rom_dir(const char *path)
+{
+	write_log("amiga_set_shared_rom_dir %s\n", path);
+	g_shared_rom_dir = strdup(path);
+}
+
 } // extern "C"
@@ -8,6 +8,7 @@
 #include "drawing.h"
 #include "gfxfilter.h"
 #include "gui.h"
+#include "savestate.h"
 #include "uae/fs.h"
 
 #include <limits.h>
@@ -276,6 +277,11 @@ bool render_screen(bool immediate)
     render_ok = false;
     if (minimized || picasso_on || monitor_off || dx_islost ())
             return render_ok;
+#ifdef SAVESTATE
+    /* frames emulated only for run-ahead are not displayed */
+    if (!savestate_runahead_show ())
+            return render_ok;
+#endif
     cnt = 0;
     while (wait_render) {
             sleep_millis (1);
@@ -339,6 +345,11 @@ void show_screen (int mode)
 {
 #ifdef DEBUG_SHOW_SCREEN
     printf("show_screen mode=%d\n\n", mode);
+#endif
+#ifdef SAVESTATE
+    if (!savestate_runahead_show ()) {
+        return;
+    }
 #endif
     if (g_libamiga_callbacks.display) {
         g_libamiga_callbacks.display();
@@ -106,6 +106,7 @@ void PPCCALL ppc_cpu_do_dec(int val)
 
 static uint ops = 0;
 static int ppc_trace;
+static ppc_opc_function *dec_code_page;
 
 void PPCCALL ppc_cpu_run_single(int count)
 {
@@ -118,7 +119,8 @@ void PPCCALL ppc_cpu_run_single(int count)
 			ppc_debug_hook();
 		} else {
 			int ret;
-			if ((ret = ppc_direct_effective_memory_handle_code(gCPU.pc & ~0xfff, gCPU.physical_code_page))) {
+			uint32 pa;
+			if ((ret = ppc_direct_effective_memory_handle_code(gCPU.pc & ~0xfff, gCPU.physical_code_page, pa))) {
 				if (ret == PPC_MMU_EXC) {
 					gCPU.pc = gCPU.npc;
 					continue;
@@ -127,11 +129,12 @@ void PPCCALL ppc_cpu_run_single(int count)
 				}
 			}
 			gCPU.effective_code_page = gCPU.pc & ~0xfff;
+			dec_code_page = ppc_dec_page(pa);
 			continue;
 		}
 		if (ppc_trace)
 			ht_printf("%08x %04x\n", gCPU.pc, gCPU.current_opc);
-		ppc_exec_opc();
+		ppc_dec_exec(&dec_code_page[(gCPU.pc & 0xfff) >> 2]);
 		ops++;
 		gCPU.ptb++;
 		ppc_do_dec(1);
@@ -35,6 +35,12 @@
 #define PPC_BUS_FREQUENCY PPC_MHz(10)
 #define PPC_TIMEBASE_FREQUENCY (PPC_CLOCK_FREQUENCY / TB_TO_PTB_FACTOR)
 
+// software TLB of the generic cpu core, direct mapped by effective page
+#define PPC_TLB_SIZE	256
+#define PPC_TLB_VALID	1
+#define PPC_TLB_PR	2	// entry was created with MSR[PR] set
+#define PPC_TLB_WRITE	4	// stores allowed and PTE[C] already set
+
 struct PPC_CPU_State {	
 	// * uisa
 	uint32 gpr[32];
@@ -102,6 +108,12 @@ struct PPC_CPU_State {
 	uint32 vrsave;	// spr 256
 	Vector_t vr[36];		// <--- this MUST be 16-byte alligned
 	uint32 vtemp;
+
+	// for generic cpu core
+	uint32 itlb_va[PPC_TLB_SIZE];
+	uint32 itlb_pa[PPC_TLB_SIZE];
+	uint32 dtlb_va[PPC_TLB_SIZE];
+	uint32 dtlb_pa[PPC_TLB_SIZE];
 };
 
 extern PPC_CPU_State gCPU;
@@ -608,6 +608,70 @@ void FASTCALL ppc_exec_opc()
 	ppc_opc_table_main[mainopc]();
 }
 
+/*
+ *	The cache is tagged with physical page addresses, one slot per
+ *	instruction word. An empty slot is decoded on its first execution.
+ */
+uint32 ppc_dec_page_pa[PPC_DEC_PAGES];
+static ppc_opc_function ppc_dec_slots[PPC_DEC_PAGES][1024];
+
+static ppc_opc_function ppc_dec_opc(uint32 opc)
+{
+	uint32 mainopc = PPC_OPC_MAIN(opc);
+	if (mainopc == 31) {
+		uint32 ext = PPC_OPC_EXT(opc);
+		if (ext >= (sizeof ppc_opc_table_group2 / sizeof ppc_opc_table_group2[0])) {
+			return ppc_opc_invalid;
+		}
+		return ppc_opc_table_group2[ext];
+	}
+	return ppc_opc_table_main[mainopc];
+}
+
+ppc_opc_function *ppc_dec_page(uint32 pa)
+{
+	uint32 i = (pa >> 12) & (PPC_DEC_PAGES - 1);
+	if (ppc_dec_page_pa[i] != pa) {
+		ppc_dec_page_pa[i] = pa;
+		memset(ppc_dec_slots[i], 0, sizeof ppc_dec_slots[i]);
+	}
+	return ppc_dec_slots[i];
+}
+
+void FASTCALL ppc_dec_exec(ppc_opc_function *slot)
+{
+	if (!*slot) {
+		*slot = ppc_dec_opc(gCPU.current_opc);
+	}
+	(*slot)();
+}
+
+void FASTCALL ppc_dec_invalidate(uint32 pa, uint32 size)
+{
+	while (size) {
+		uint32 i = (pa >> 12) & (PPC_DEC_PAGES - 1);
+		uint32 ofs = pa & 0xfff;
+		uint32 len = 4096 - ofs;
+		if (len > size) len = size;
+		if (ppc_dec_page_pa[i] == (pa & ~0xfff)) {
+			memset(&ppc_dec_slots[i][ofs >> 2], 0,
+				(((ofs + len + 3) >> 2) - (ofs >> 2)) * sizeof(ppc_opc_function));
+		}
+		pa += len;
+		size -= len;
+	}
+}
+
+/*
+ *	Only drops the tags. Callers also reset gCPU.effective_code_page, so
+ *	the current code page is looked up (and cleared) again before the
+ *	next instruction.
+ */
+void ppc_dec_invalidate_all()
+{
+	memset(ppc_dec_page_pa, 0xff, sizeof ppc_dec_page_pa);
+}
+
 void ppc_dec_init()
 {
 	ppc_opc_init_group2();
@@ -615,4 +679,5 @@ void ppc_dec_init()
 		ppc_opc_table_main[4] = ppc_opc_group_v;
 		ppc_opc_init_groupv();
 	}
+	ppc_dec_invalidate_all();
 }
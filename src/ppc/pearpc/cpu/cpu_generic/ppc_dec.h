@@ -28,6 +28,26 @@ void ppc_dec_init();
 
 typedef void (*ppc_opc_function)();
 
+/*
+ *	Predecoded instruction cache: handlers of the instructions of recently
+ *	executed physical pages, direct mapped by page. Entries are cleared by
+ *	stores to the page, icbi, HID0[ICFI] and TLB flushes.
+ */
+#define PPC_DEC_PAGES	64
+
+extern uint32 ppc_dec_page_pa[PPC_DEC_PAGES];
+
+ppc_opc_function *ppc_dec_page(uint32 pa);
+void FASTCALL ppc_dec_exec(ppc_opc_function *slot);
+void FASTCALL ppc_dec_invalidate(uint32 pa, uint32 size);
+void ppc_dec_invalidate_all();
+
+static inline void ppc_dec_store(uint32 pa, uint32 size)
+{
+	if (ppc_dec_page_pa[(pa >> 12) & (PPC_DEC_PAGES - 1)] == (pa & ~0xfff))
+		ppc_dec_invalidate(pa, size);
+}
+
 #define PPC_OPC_ASSERT(v)
 
 #define PPC_OPC_MAIN(opc)		(((opc)>>26)&0x3f)
@@ -33,6 +33,7 @@
 //#include "io/prom/prom.h"
 #include "io/io.h"
 #include "ppc_cpu.h"
+#include "ppc_dec.h"
 #include "ppc_fpu.h"
 #include "ppc_vec.h"
 #include "ppc_mmu.h"
@@ -44,8 +45,6 @@ byte *gMemory = NULL;
 uint32 gMemorySize;
 #endif
 
-#undef TLB
-
 static int ppc_pte_protection[] = {
 	// read(0)/write(1) key pp
 	
@@ -70,6 +69,20 @@ static int ppc_pte_protection[] = {
 	0, // r
 };
 
+static inline void ppc_mmu_tlb_store(uint32 addr, int flags, uint32 pap, bool writable)
+{
+	uint32 i = (addr >> 12) & (PPC_TLB_SIZE - 1);
+	uint32 tag = (addr & ~0xfff) | PPC_TLB_VALID;
+	if (gCPU.msr & MSR_PR) tag |= PPC_TLB_PR;
+	if (flags & PPC_MMU_CODE) {
+		gCPU.itlb_va[i] = tag;
+		gCPU.itlb_pa[i] = pap;
+	} else {
+		gCPU.dtlb_va[i] = tag | (writable ? PPC_TLB_WRITE : 0);
+		gCPU.dtlb_pa[i] = pap;
+	}
+}
+
 inline int FASTCALL ppc_effective_to_physical(uint32 addr, int flags, uint32 &result)
 {
 	static int lastibatcnt;
@@ -151,16 +164,24 @@ inline int FASTCALL ppc_effective_to_physical(uint32 addr, int flags, uint32 &re
 		// FIXME: implement me
 		PPC_MMU_ERR("sr & T\n");
 	} else {
-#ifdef TLB	
-		for (int i=0; i<4; i++) {
-			if ((addr & ~0xfff) == (gCPU.tlb_va[i])) {
-				gCPU.tlb_last = i;
-//				ht_printf("TLB: %d: %08x -> %08x\n", i, addr, gCPU.tlb_pa[i] | (addr & 0xfff));
-				result = gCPU.tlb_pa[i] | (addr & 0xfff);
+		uint32 tlb_index = (addr >> 12) & (PPC_TLB_SIZE - 1);
+		uint32 tlb_tag = (addr & ~0xfff) | PPC_TLB_VALID | ((gCPU.msr & MSR_PR) ? PPC_TLB_PR : 0);
+		if (flags & PPC_MMU_CODE) {
+			if (gCPU.itlb_va[tlb_index] == tlb_tag) {
+				result = gCPU.itlb_pa[tlb_index] | (addr & 0xfff);
+				return PPC_MMU_OK;
+			}
+		} else if (flags & PPC_MMU_WRITE) {
+			if (gCPU.dtlb_va[tlb_index] == (tlb_tag | PPC_TLB_WRITE)) {
+				result = gCPU.dtlb_pa[tlb_index] | (addr & 0xfff);
+				return PPC_MMU_OK;
+			}
+		} else {
+			if ((gCPU.dtlb_va[tlb_index] & ~PPC_TLB_WRITE) == tlb_tag) {
+				result = gCPU.dtlb_pa[tlb_index] | (addr & 0xfff);
 				return PPC_MMU_OK;
 			}
 		}
-#endif
 		// page address translation
 		if ((flags & PPC_MMU_CODE) && (sr & SR_N)) {
 			// segment isnt executable
@@ -228,13 +249,6 @@ inline int FASTCALL ppc_effective_to_physical(uint32 addr, int flags, uint32 &re
 					// ok..
 					uint32 pap = PTE2_RPN(pte);
 					result = pap | offset;
-#ifdef TLB
-					gCPU.tlb_last++;
-					gCPU.tlb_last &= 3;
-					gCPU.tlb_pa[gCPU.tlb_last] = pap;
-					gCPU.tlb_va[gCPU.tlb_last] = addr & ~0xfff;					
-//					ht_printf("TLB: STORE %d: %08x -> %08x\n", gCPU.tlb_last, addr, pap);
-#endif
 					// update access bits
 					uint32 opte = pte;
 					if (flags & PPC_MMU_WRITE) {
@@ -244,6 +258,7 @@ inline int FASTCALL ppc_effective_to_physical(uint32 addr, int flags, uint32 &re
 					}
 					if (pte != opte)
 						ppc_write_physical_word(pteg_addr+4, pte);
+					ppc_mmu_tlb_store(addr, flags, pap, (pte & PTE2_C) && ppc_pte_protection[8 + key + PTE2_PP(pte)]);
 					return PPC_MMU_OK;
 				}
 			}
@@ -308,6 +323,7 @@ inline int FASTCALL ppc_effective_to_physical(uint32 addr, int flags, uint32 &re
 					}
 					if (pte != opte)
 						ppc_write_physical_word(pteg_addr+4, pte);
+					ppc_mmu_tlb_store(addr, flags, PTE2_RPN(pte), (pte & PTE2_C) && ppc_pte_protection[8 + key + PTE2_PP(pte)]);
 //					PPC_MMU_WARN("hash function 2 used!\n");
 //					gSinglestep = true;
 					return PPC_MMU_OK;
@@ -337,6 +353,28 @@ void ppc_mmu_tlb_invalidate()
 	gCPU.effective_code_page = 0xffffffff;
 }
 
+/*
+ *	Entries are tagged with MSR[PR] and BATs are checked first, so the
+ *	software TLB only needs flushing when segment registers, SDR1 or
+ *	the page table (tlbie/tlbia) change.
+ */
+void ppc_mmu_tlb_invalidate_all()
+{
+	memset(gCPU.itlb_va, 0, sizeof gCPU.itlb_va);
+	memset(gCPU.dtlb_va, 0, sizeof gCPU.dtlb_va);
+	ppc_dec_invalidate_all();
+	ppc_mmu_tlb_invalidate();
+}
+
+void ppc_mmu_tlb_invalidate_entry(uint32 ea)
+{
+	uint32 i = (ea >> 12) & (PPC_TLB_SIZE - 1);
+	gCPU.itlb_va[i] = 0;
+	gCPU.dtlb_va[i] = 0;
+	ppc_dec_invalidate_all();
+	ppc_mmu_tlb_invalidate();
+}
+
 /*
 pagetable:
 min. 2^10 (64k) PTEGs
@@ -371,6 +409,7 @@ bool FASTCALL ppc_mmu_set_sdr1(uint32 newval, bool quiesce)
 	}
 	gCPU.pagetable_base = htaborg<<16;
 	gCPU.sdr1 = newval;
+	ppc_mmu_tlb_invalidate_all();
 	gCPU.pagetable_hashmask = ((xx<<10)|0x3ff);
 	PPC_MMU_TRACE("new pagetable: sdr1 accepted\n");
 	PPC_MMU_TRACE("number of pages: 2^%d pagetable_start: 0x%08x size: 2^%d\n", n+13, gCPU.pagetable_base, n+16);
@@ -442,12 +481,11 @@ int FASTCALL ppc_direct_effective_memory_handle(uint32 addr, byte *&ptr)
 	return r;
 }
 
-int FASTCALL ppc_direct_effective_memory_handle_code(uint32 addr, byte *&ptr)
+int FASTCALL ppc_direct_effective_memory_handle_code(uint32 addr, byte *&ptr, uint32 &pa)
 {
-	uint32 ea;
 	int r;
-	if (!((r = ppc_effective_to_physical(addr, PPC_MMU_READ | PPC_MMU_CODE, ea)))) {
-		return ppc_direct_physical_memory_handle(ea, ptr);
+	if (!((r = ppc_effective_to_physical(addr, PPC_MMU_READ | PPC_MMU_CODE, pa)))) {
+		return ppc_direct_physical_memory_handle(pa, ptr);
 	}
 	return r;
 }
@@ -713,6 +751,7 @@ inline int FASTCALL ppc_write_effective_qword(uint32 addr, Vector_t data)
 	addr &= ~0x0f;
 
 	if (!((r=ppc_effective_to_physical(addr, PPC_MMU_WRITE, p)))) {
+		ppc_dec_store(p, 16);
 		return ppc_write_physical_qword(p, data);
 	}
 	return r;
@@ -728,8 +767,10 @@ inline int FASTCALL ppc_write_effective_dword(uint32 addr, uint64 data)
 			byte *r1, *r2;
 			byte b[14];
 			ppc_effective_to_physical((addr & ~0xfff)+4089, PPC_MMU_WRITE, p);
+			ppc_dec_store(p, 7);
 			if ((r = ppc_direct_physical_memory_handle(p, r1))) return r;
 			if ((r = ppc_effective_to_physical((addr & ~0xfff)+4096, PPC_MMU_WRITE, p))) return r;
+			ppc_dec_store(p, 7);
 			if ((r = ppc_direct_physical_memory_handle(p, r2))) return r;
 			data = ppc_dword_to_BE(data);
 			memmove(&b[0], r1, 7);
@@ -739,6 +780,7 @@ inline int FASTCALL ppc_write_effective_dword(uint32 addr, uint64 data)
 			memmove(r2, &b[7], 7);
 			return PPC_MMU_OK;
 		} else {
+			ppc_dec_store(p, 8);
 			return ppc_write_physical_dword(p, data);
 		}
 	}
@@ -755,8 +797,10 @@ inline int FASTCALL ppc_write_effective_word(uint32 addr, uint32 data)
 			byte *r1, *r2;
 			byte b[6];
 			ppc_effective_to_physical((addr & ~0xfff)+4093, PPC_MMU_WRITE, p);
+			ppc_dec_store(p, 3);
 			if ((r = ppc_direct_physical_memory_handle(p, r1))) return r;
 			if ((r = ppc_effective_to_physical((addr & ~0xfff)+4096, PPC_MMU_WRITE, p))) return r;
+			ppc_dec_store(p, 3);
 			if ((r = ppc_direct_physical_memory_handle(p, r2))) return r;
 			data = ppc_word_to_BE(data);
 			memmove(&b[0], r1, 3);
@@ -766,6 +810,7 @@ inline int FASTCALL ppc_write_effective_word(uint32 addr, uint32 data)
 			memmove(r2, &b[3], 3);
 			return PPC_MMU_OK;
 		} else {
+			ppc_dec_store(p, 4);
 			return ppc_write_physical_word(p, data);
 		}
 	}
@@ -780,11 +825,14 @@ inline int FASTCALL ppc_write_effective_half(uint32 addr, uint16 data)
 		if (EA_Offset(addr) > 4094) {
 			// write overlaps two pages.. tricky
 			ppc_effective_to_physical((addr & ~0xfff)+4095, PPC_MMU_WRITE, p);
+			ppc_dec_store(p, 1);
 			if ((r = ppc_write_physical_byte(p, data>>8))) return r;
 			if ((r = ppc_effective_to_physical((addr & ~0xfff)+4096, PPC_MMU_WRITE, p))) return r;
+			ppc_dec_store(p, 1);
 			if ((r = ppc_write_physical_byte(p, data))) return r;
 			return PPC_MMU_OK;
 		} else {
+			ppc_dec_store(p, 2);
 			return ppc_write_physical_half(p, data);
 		}
 	}
@@ -796,6 +844,7 @@ inline int FASTCALL ppc_write_effective_byte(uint32 addr, uint8 data)
 	uint32 p;
 	int r;
 	if (!((r=ppc_effective_to_physical(addr, PPC_MMU_WRITE, p)))) {
+		ppc_dec_store(p, 1);
 		return ppc_write_physical_byte(p, data);
 	}
 	return r;
@@ -829,6 +878,7 @@ bool	ppc_dma_write(uint32 dest, const void *src, uint32 size)
 #if 0
 	if (dest > gMemorySize || (dest+size) > gMemorySize) return false;
 #endif	
+	ppc_dec_invalidate(dest, size);
 	byte *ptr;
 	ppc_direct_physical_memory_handle(dest, ptr);
 	
@@ -853,6 +903,7 @@ bool	ppc_dma_set(uint32 dest, int c, uint32 size)
 #if 0
 	if (dest > gMemorySize || (dest+size) > gMemorySize) return false;
 #endif	
+	ppc_dec_invalidate(dest, size);
 	byte *ptr;
 	ppc_direct_physical_memory_handle(dest, ptr);
 	
@@ -864,8 +915,6 @@ bool	ppc_dma_set(uint32 dest, int c, uint32 size)
  *	MMU Opcodes
  */
 
-#include "ppc_dec.h"
-
 /*
  *	dcbz		Data Cache Clear to Zero
  *	.464
@@ -40,6 +40,8 @@ extern uint32 gMemorySize;
 int FASTCALL ppc_effective_to_physical(uint32 addr, int flags, uint32 &result);
 bool FASTCALL ppc_mmu_set_sdr1(uint32 newval, bool quiesce);
 void ppc_mmu_tlb_invalidate();
+void ppc_mmu_tlb_invalidate_all();
+void ppc_mmu_tlb_invalidate_entry(uint32 ea);
 
 int FASTCALL ppc_read_physical_dword(uint32 addr, uint64 &result);
 int FASTCALL ppc_read_physical_word(uint32 addr, uint32 &result);
@@ -64,7 +66,7 @@ int FASTCALL ppc_write_effective_byte(uint32 addr, uint8 data);
 
 int FASTCALL ppc_direct_physical_memory_handle(uint32 addr, byte *&ptr);
 int FASTCALL ppc_direct_effective_memory_handle(uint32 addr, byte *&ptr);
-int FASTCALL ppc_direct_effective_memory_handle_code(uint32 addr, byte *&ptr);
+int FASTCALL ppc_direct_effective_memory_handle_code(uint32 addr, byte *&ptr, uint32 &pa);
 bool FASTCALL ppc_mmu_page_create(uint32 ea, uint32 pa);
 bool FASTCALL ppc_mmu_page_free(uint32 ea);
 bool FASTCALL ppc_init_physical_memory(uint size);
@@ -222,7 +222,13 @@ void ppc_opc_eieio()
  */
 void ppc_opc_icbi()
 {
-	// NO-OP
+	int rA, rD, rB;
+	PPC_OPC_TEMPL_X(gCPU.current_opc, rD, rA, rB);
+	uint32 a = ((rA?gCPU.gpr[rA]:0)+gCPU.gpr[rB]) & ~31;
+	uint32 pa;
+	if (!ppc_effective_to_physical(a, PPC_MMU_READ | PPC_MMU_NO_EXC, pa)) {
+		ppc_dec_invalidate(pa, 32);
+	}
 }
 
 /*
@@ -763,6 +769,11 @@ void ppc_opc_mtspr()
 		case 16:
 //			PPC_OPC_WARN("write(%08x) to spr %d:%d (HID0) not supported! @%08x\n", gCPU.gpr[rS], spr1, spr2, gCPU.pc);
 			gCPU.hid[0] = gCPU.gpr[rS];
+			if (gCPU.hid[0] & HID0_icfim) {
+				// flash invalidate of the instruction cache
+				ppc_dec_invalidate_all();
+				ppc_mmu_tlb_invalidate();
+			}
 			return;
 		case 17: return;
 		case 18:
@@ -806,6 +817,7 @@ void ppc_opc_mtsr()
 	PPC_OPC_TEMPL_X(gCPU.current_opc, rS, SR, rB);
 	// FIXME: check insn
 	gCPU.sr[SR & 0xf] = gCPU.gpr[rS];
+	ppc_mmu_tlb_invalidate_all();
 }
 /*
  *	mtsrin		Move to Segment Register Indirect
@@ -821,6 +833,7 @@ void ppc_opc_mtsrin()
 	PPC_OPC_TEMPL_X(gCPU.current_opc, rS, rA, rB);
 	// FIXME: check insn
 	gCPU.sr[gCPU.gpr[rB] >> 28] = gCPU.gpr[rS];
+	ppc_mmu_tlb_invalidate_all();
 }
 
 /*
@@ -877,7 +890,7 @@ void ppc_opc_tlbia()
 	int rS, rA, rB;
 	PPC_OPC_TEMPL_X(gCPU.current_opc, rS, rA, rB);
 	// FIXME: check rS.. for 0
-	ppc_mmu_tlb_invalidate();
+	ppc_mmu_tlb_invalidate_all();
 }
 
 /*
@@ -893,7 +906,7 @@ void ppc_opc_tlbie()
 	int rS, rA, rB;
 	PPC_OPC_TEMPL_X(gCPU.current_opc, rS, rA, rB);
 	// FIXME: check rS.. for 0     
-	ppc_mmu_tlb_invalidate();
+	ppc_mmu_tlb_invalidate_entry(gCPU.gpr[rB]);
 }
 
 /*
@@ -909,7 +922,7 @@ void ppc_opc_tlbsync()
 	int rS, rA, rB;
 	PPC_OPC_TEMPL_X(gCPU.current_opc, rS, rA, rB);
 	// FIXME: check rS.. for 0     
-	ppc_mmu_tlb_invalidate();
+	ppc_mmu_tlb_invalidate_all();
 }
 
 /*
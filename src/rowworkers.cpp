@@ -0,0 +1,111 @@
+/*
+* UAE - The Un*x Amiga Emulator
+*
+* Fork/join row workers for per-frame image processing (special monitor
+* decoders in specialmonitors.cpp).
+*
+*/
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "threaddep/thread.h"
+#include "rowworkers.h"
+
+struct rowworker
+{
+	uae_thread_id tid;
+	uae_sem_t go;
+	int first, last;
+};
+
+static struct rowworker workers[ROWWORKERS_MAX_THREADS - 1];
+static int rowworker_threads = -1;
+static rowworker_func job_func;
+static void *job_ctx;
+static uae_sem_t job_done;
+
+static void *rowworker_thread (void *v)
+{
+	struct rowworker *w = (struct rowworker*)v;
+
+	for (;;) {
+		uae_sem_wait (&w->go);
+		job_func (job_ctx, w->first, w->last);
+		uae_sem_post (&job_done);
+	}
+	return 0;
+}
+
+static int host_cpus (void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo (&si);
+	return si.dwNumberOfProcessors;
+#else
+	long n = sysconf (_SC_NPROCESSORS_ONLN);
+	return n > 0 ? n : 1;
+#endif
+}
+
+static void rowworkers_init (void)
+{
+	int cnt = host_cpus ();
+	if (cnt > ROWWORKERS_MAX_THREADS)
+		cnt = ROWWORKERS_MAX_THREADS;
+	rowworker_threads = 0;
+	uae_sem_init (&job_done, 0, 0);
+	for (int i = 0; i < cnt - 1; i++) {
+		struct rowworker *w = &workers[i];
+		TCHAR name[16];
+		_stprintf (name, _T("rowworker%d"), i);
+		uae_sem_init (&w->go, 0, 0);
+		if (!uae_start_thread (name, rowworker_thread, w, &w->tid)) {
+			uae_sem_destroy (&w->go);
+			break;
+		}
+		rowworker_threads++;
+	}
+	write_log (_T("Row workers: %d thread(s)\n"), rowworker_threads + 1);
+}
+
+int rowworkers_count (void)
+{
+	if (rowworker_threads < 0)
+		rowworkers_init ();
+	return rowworker_threads + 1;
+}
+
+/* Only called from the emulation thread, there is one job at a time. */
+void rowworkers_run (int rows, int minrows, rowworker_func func, void *ctx)
+{
+	int bands = rowworkers_count ();
+
+	if (minrows < 1)
+		minrows = 1;
+	if (rows / minrows < bands)
+		bands = rows / minrows;
+	if (bands <= 1) {
+		if (rows > 0)
+			func (ctx, 0, rows);
+		return;
+	}
+	job_func = func;
+	job_ctx = ctx;
+	for (int i = 0; i < bands - 1; i++) {
+		struct rowworker *w = &workers[i];
+		w->first = rows * i / bands;
+		w->last = rows * (i + 1) / bands;
+		uae_sem_post (&w->go);
+	}
+	func (ctx, rows * (bands - 1) / bands, rows);
+	for (int i = 0; i < bands - 1; i++)
+		uae_sem_wait (&job_done);
+}
@@ -66,6 +66,8 @@
 #include "threaddep/thread.h"
 #include "a2091.h"
 #include "devices.h"
+#include "keybuf.h"
+#include "drawing.h"
 
 #ifdef FSUAE // NL
 #include "uae/fs.h"
@@ -86,11 +88,22 @@ static int savestate_docompress, savestate_specialdump, savestate_nodialogs;
 
 TCHAR savestate_fname[MAX_DPATH];
 
+/* In-memory state records (rewind, run-ahead) are single allocations laid
+ * out when the record is created: the header, the serialized CPU and
+ * chipset state, then one slot per RAM bank at a fixed offset. Saving
+ * copies each RAM bank once into its slot and does not allocate, unless
+ * the RAM configuration changed or the serialized state outgrew its area,
+ * in which case the larger area is also used for all later records. */
+
 #define STATEFILE_ALLOC_SIZE 600000
-static int statefile_alloc;
+#define STATERECORD_STATE_SIZE 200000
+#define STATERECORD_RAMS 4
+static int staterecord_statesize;
 static int staterecords_max = 1000;
 static int staterecords_first = 0;
 static struct zfile *staterecord_statefile;
+/* set while the rerecording state file is saved in memory */
+static bool savestate_quiet;
 struct staterecord
 {
 	int len;
@@ -99,10 +112,32 @@ struct staterecord
 	uae_u8 *data;
 	uae_u8 *end;
 	int inprecoffset;
+	int statesize;
+	uae_u8 *ram[STATERECORD_RAMS];
+	int ramsize[STATERECORD_RAMS];
 };
 
 static struct staterecord **staterecords;
 
+/* Run-ahead: after each real frame, the state is saved in memory and the
+ * following frames are emulated ahead with the current input. The last of
+ * these is displayed, and the state is then restored so the next real
+ * frame can see new input. Only the real frames produce sound and read
+ * host input. */
+
+#define RUNAHEAD_NONE 0
+#define RUNAHEAD_SAVE 1
+#define RUNAHEAD_RESTORE 2
+
+static struct staterecord *runahead_record;
+static int runahead_keybufpos;
+/* frame being emulated, 0 is the real frame, -1 when not running ahead */
+static int runahead_frame = -1;
+static int runahead_frames;
+static int runahead_action;
+static bool runahead_show = true;
+static bool runahead_events = true;
+
 static void state_incompatible_warn (void)
 {
 	static int warned;
@@ -320,7 +355,8 @@ static void save_chunk (struct zfile *f, uae_u8 *chunk, unsigned int len, const
 	uae_u32 flags;
 	unsigned int pos;
 	unsigned int chunklen, len2;
-	char *s;
+	char s[4];
+	int i;
 
 	if (!chunk)
 		return;
@@ -330,10 +366,10 @@ static void save_chunk (struct zfile *f, uae_u8 *chunk, unsigned int len, const
 		return;
 	}
 
-	/* chunk name */
-	s = ua (name);
+	/* chunk name, always four ASCII characters */
+	for (i = 0; i < 4; i++)
+		s[i] = (char)name[i];
 	zfile_fwrite (s, 1, 4, f);
-	xfree (s);
 	pos = zfile_ftell (f);
 	/* chunk size */
 	dst = &tmp[0];
@@ -376,7 +412,8 @@ static void save_chunk (struct zfile *f, uae_u8 *chunk, unsigned int len, const
 	if (len2)
 		zfile_fwrite (zero, 1, len2, f);
 
-	write_log (_T("Chunk '%s' chunk size %u (%u)\n"), name, chunklen, len);
+	if (!savestate_quiet)
+		write_log (_T("Chunk '%s' chunk size %u (%u)\n"), name, chunklen, len);
 }
 
 static uae_u8 *restore_chunk (struct zfile *f, TCHAR *name, unsigned int *len, unsigned int *totallen, size_t *filepos)
@@ -755,10 +792,14 @@ error:
 
 void savestate_restore_finish (void)
 {
+	bool runahead;
+
 	if (!isrestore ())
 		return;
+	runahead = savestate_state == STATE_RUNAHEAD;
 #ifdef FSUAE
-	printf("savestate_restore_finish\n");
+	if (!runahead)
+		printf("savestate_restore_finish\n");
 #endif
 	zfile_fclose (savestate_file);
 	savestate_file = 0;
@@ -783,6 +824,14 @@ void savestate_restore_finish (void)
 	savestate_state = 0;
 	init_hz_normal();
 	audio_activate();
+	if (runahead) {
+		write_log_mute (0);
+		return;
+	}
+	/* a loaded state replaces the one run-ahead would return to */
+	if (runahead_frame > 0)
+		runahead_frame = -1;
+	clear_inhibit_frame (IHF_RUNAHEAD);
 #ifdef FSUAE
     uae_callback(uae_on_restore_state_finished, savestate_fname);
 #endif
@@ -853,7 +902,8 @@ static int save_state_internal (struct zfile *f, const TCHAR *description, int c
 	TCHAR name[5];
 	int i, len;
 
-	write_log (_T("STATESAVE (%s):\n"), f ? zfile_getname (f) : _T("<internal>"));
+	if (!savestate_quiet)
+		write_log (_T("STATESAVE (%s):\n"), f ? zfile_getname (f) : _T("<internal>"));
 	dst = header;
 	save_u32 (0);
 	save_string (_T("UAE"));
@@ -1203,12 +1253,25 @@ void savestate_quick (int slot, int save)
 	}
 }
 
+static void runahead_save (void);
+
 bool savestate_check (void)
 {
 	if (vpos == 0 && !savestate_state) {
 		if (hsync_counter == 0 && input_play == INPREC_PLAY_NORMAL)
 			savestate_memorysave ();
 		savestate_capture (0);
+		if (runahead_action == RUNAHEAD_SAVE) {
+			runahead_action = RUNAHEAD_NONE;
+			runahead_save ();
+		} else if (runahead_action == RUNAHEAD_RESTORE) {
+			runahead_action = RUNAHEAD_NONE;
+			/* restore right away instead of going through uae_reset,
+			 * which would only act on it at the next vsync. */
+			savestate_state = STATE_RUNAHEAD;
+			quit_program = UAE_RESET;
+			set_special (SPCFLAG_BRK | SPCFLAG_MODE_CHANGE);
+		}
 	}
 	if (savestate_state == STATE_DORESTORE) {
 		savestate_state = STATE_RESTORE;
@@ -1275,31 +1338,36 @@ void savestate_listrewind (void)
 }
 #endif
 
-void savestate_rewind (void)
+/* RAM banks kept in the fixed slots of a state record */
+static uae_u8 *staterecord_ram (int i, int *len)
 {
-	int len, i, dummy;
-	uae_u8 *p, *p2;
-	struct staterecord *st;
-	int pos;
-	bool rewind = false;
-
-	if (hsync_counter % currprefs.statecapturerate <= 25 && rewindmode <= -2) {
-		pos = replaycounter - 2;
-		rewind = true;
-	} else {
-		pos = replaycounter - 1;
-	}
-	st = canrewind (pos);
-	if (!st) {
-		rewind = false;
-		pos = replaycounter - 1;
-		st = canrewind (pos);
-		if (!st)
-			return;
+	switch (i)
+	{
+	case 0:
+		return save_cram (len);
+	case 1:
+		return save_bram (len);
+#ifdef AUTOCONFIG
+	case 2:
+		return save_fram (len, 0);
+	case 3:
+		return save_zram (len, 0);
+#endif
 	}
+	*len = 0;
+	return NULL;
+}
+
+/* Restores the emulated machine from an in-memory state record. Must be
+ * called where restore_state would be, i.e. from the reset path of
+ * m68k_go. */
+bool savestate_record_restore (struct staterecord *st)
+{
+	int len, i;
+	uae_u8 *p, *p2, *dst;
+
 	p = st->data;
 	p2 = st->end;
-	write_log (_T("rewinding %d -> %d\n"), replaycounter - 1, pos);
 	hsync_counter = restore_u32_func (&p);
 	vsync_counter = restore_u32_func (&p);
 	p = restore_cpu (p);
@@ -1340,20 +1408,13 @@ void savestate_rewind (void)
 	if (restore_u32_func (&p))
 		p = restore_p96 (p);
 #endif
-	len = restore_u32_func (&p);
-	memcpy (chipmem_bank.baseaddr, p, currprefs.chipmem_size > len ? len : currprefs.chipmem_size);
-	p += len;
-	len = restore_u32_func (&p);
-	memcpy (save_bram (&dummy), p, currprefs.bogomem_size > len ? len : currprefs.bogomem_size);
-	p += len;
-#ifdef AUTOCONFIG
-	len = restore_u32_func (&p);
-	memcpy (save_fram (&dummy, 0), p, currprefs.fastmem_size > len ? len : currprefs.fastmem_size);
-	p += len;
-	len = restore_u32_func (&p);
-	memcpy (save_zram (&dummy, 0), p, currprefs.z3fastmem_size > len ? len : currprefs.z3fastmem_size);
-	p += len;
-#endif
+	for (i = 0; i < STATERECORD_RAMS; i++) {
+		dst = staterecord_ram (i, &len);
+		if (len > st->ramsize[i])
+			len = st->ramsize[i];
+		if (dst && len > 0)
+			memcpy (dst, st->ram[i], len);
+	}
 #ifdef ACTION_REPLAY
 	if (restore_u32_func (&p))
 		p = restore_action_replay (p);
@@ -1386,8 +1447,34 @@ void savestate_rewind (void)
 	if (p != p2) {
 		gui_message (_T("reload failure, address mismatch %p != %p"), p, p2);
 		uae_reset (0, 0);
-		return;
+		return false;
+	}
+	return true;
+}
+
+void savestate_rewind (void)
+{
+	struct staterecord *st;
+	int pos;
+	bool rewind = false;
+
+	if (hsync_counter % currprefs.statecapturerate <= 25 && rewindmode <= -2) {
+		pos = replaycounter - 2;
+		rewind = true;
+	} else {
+		pos = replaycounter - 1;
+	}
+	st = canrewind (pos);
+	if (!st) {
+		rewind = false;
+		pos = replaycounter - 1;
+		st = canrewind (pos);
+		if (!st)
+			return;
 	}
+	write_log (_T("rewinding %d -> %d\n"), replaycounter - 1, pos);
+	if (!savestate_record_restore (st))
+		return;
 	inprec_setposition (st->inprecoffset, pos);
 	write_log (_T("state %d restored.  (%010ld/%03ld)\n"), pos, hsync_counter, vsync_counter);
 	if (rewind) {
@@ -1404,7 +1491,7 @@ void savestate_rewind (void)
 
 STATIC_INLINE int bufcheck (struct staterecord *sr, uae_u8 *p, int len)
 {
-	if (p - sr->data + BS + len >= sr->len)
+	if (p - sr->data + BS + len >= sr->statesize)
 		return 1;
 	return 0;
 }
@@ -1412,60 +1499,92 @@ STATIC_INLINE int bufcheck (struct staterecord *sr, uae_u8 *p, int len)
 void savestate_memorysave (void)
 {
 	new_blitter = true;
-	// create real statefile in memory too for later saving
-	zfile_fclose (staterecord_statefile);
-	staterecord_statefile = zfile_fopen_empty (NULL, _T("statefile.inp.uss"));
-	if (staterecord_statefile)
-		save_state_internal (staterecord_statefile, _T("rerecording"), 1, false);
+	// create real statefile in memory too for later saving, reusing
+	// the buffer of the previous one
+	if (staterecord_statefile) {
+		zfile_truncate (staterecord_statefile, 0);
+		zfile_fseek (staterecord_statefile, 0, SEEK_SET);
+	} else {
+		staterecord_statefile = zfile_fopen_empty (NULL, _T("statefile.inp.uss"), STATEFILE_ALLOC_SIZE);
+		if (!staterecord_statefile)
+			return;
+		zfile_truncate (staterecord_statefile, 0);
+	}
+	savestate_quiet = true;
+	save_state_internal (staterecord_statefile, _T("rerecording"), 1, false);
+	savestate_quiet = false;
 }
 
-void savestate_capture (int force)
+static bool staterecord_layout_ok (struct staterecord *st)
 {
-	uae_u8 *p, *p2, *p3, *dst;
-	int i, len, tlen, retrycnt;
-	struct staterecord *st;
-	bool firstcapture = false;
+	int i, len;
 
-#ifdef FILESYS
-	if (nr_units ())
-		return;
-#endif
-	if (!staterecords)
-		return;
-	if (!input_record)
-		return;
-	if (currprefs.statecapturerate && hsync_counter == 0 && input_record == INPREC_RECORD_START && savestate_first_capture > 0) {
-		// first capture
-		force = true;
-		firstcapture = true;
-	} else if (savestate_first_capture < 0) {
-		force = true;
-		firstcapture = false;
+	if (st->statesize < staterecord_statesize)
+		return false;
+	for (i = 0; i < STATERECORD_RAMS; i++) {
+		staterecord_ram (i, &len);
+		if (len != st->ramsize[i])
+			return false;
 	}
-	if (!force) {
-		if (currprefs.statecapturerate <= 0)
-			return;
-		if (hsync_counter % currprefs.statecapturerate)
-			return;
+	return true;
+}
+
+static struct staterecord *staterecord_alloc (void)
+{
+	struct staterecord *st;
+	int ramsize[STATERECORD_RAMS];
+	int i, len;
+	uae_u8 *p;
+
+	if (staterecord_statesize < STATERECORD_STATE_SIZE)
+		staterecord_statesize = STATERECORD_STATE_SIZE;
+	len = sizeof (struct staterecord) + staterecord_statesize;
+	for (i = 0; i < STATERECORD_RAMS; i++) {
+		staterecord_ram (i, &ramsize[i]);
+		len += ramsize[i];
 	}
-	savestate_first_capture = false;
+	st = (struct staterecord*)xmalloc (uae_u8, len);
+	if (!st)
+		return NULL;
+	st->len = len;
+	st->inuse = 0;
+	st->data = (uae_u8*)(st + 1);
+	st->statesize = staterecord_statesize;
+	p = st->data + st->statesize;
+	for (i = 0; i < STATERECORD_RAMS; i++) {
+		st->ram[i] = p;
+		st->ramsize[i] = ramsize[i];
+		p += ramsize[i];
+	}
+	return st;
+}
+
+void savestate_record_free (struct staterecord *st)
+{
+	xfree (st);
+}
+
+/* Saves the emulated machine into an in-memory state record, allocating
+ * a new record if st is NULL or was laid out for a different machine. The
+ * record to use from now on is returned, NULL or with inuse cleared if the
+ * state could not be saved. */
+struct staterecord *savestate_record_save (struct staterecord *st)
+{
+	uae_u8 *p, *p2, *p3, *dst;
+	int i, len, tlen, retrycnt;
 
 	retrycnt = 0;
 retry2:
-	st = staterecords[replaycounter];
+	if (st && !staterecord_layout_ok (st)) {
+		xfree (st);
+		st = NULL;
+	}
 	if (st == NULL) {
-		st = (struct staterecord*)xmalloc (uae_u8, statefile_alloc);
-		st->len = statefile_alloc;
-	} else if (retrycnt > 0) {
-		write_log (_T("realloc %d -> %d\n"), st->len, st->len + STATEFILE_ALLOC_SIZE);
-		st->len += STATEFILE_ALLOC_SIZE;
-		st = (struct staterecord*)xrealloc (uae_u8, st, st->len);
-	}
-	if (st->len > statefile_alloc)
-		statefile_alloc = st->len;
+		st = staterecord_alloc ();
+		if (!st)
+			return NULL;
+	}
 	st->inuse = 0;
-	st->data = (uae_u8*)(st + 1);
-	staterecords[replaycounter] = st;
 	retrycnt++;
 	p = p2 = st->data;
 	tlen = 0;
@@ -1632,36 +1751,6 @@ retry2:
 	}
 #endif
 
-	dst = save_cram (&len);
-	if (bufcheck (st, p, len))
-		goto retry;
-	save_u32_func (&p, len);
-	memcpy (p, dst, len);
-	tlen += len + 4;
-	p += len;
-	dst = save_bram (&len);
-	if (bufcheck (st, p, len))
-		goto retry;
-	save_u32_func (&p, len);
-	memcpy (p, dst, len);
-	tlen += len + 4;
-	p += len;
-#ifdef AUTOCONFIG
-	dst = save_fram (&len, 0);
-	if (bufcheck (st, p, len))
-		goto retry;
-	save_u32_func (&p, len);
-	memcpy (p, dst, len);
-	tlen += len + 4;
-	p += len;
-	dst = save_zram (&len, 0);
-	if (bufcheck (st, p, len))
-		goto retry;
-	save_u32_func (&p, len);
-	memcpy (p, dst, len);
-	tlen += len + 4;
-	p += len;
-#endif
 #ifdef ACTION_REPLAY
 	if (bufcheck (st, p, 0))
 		goto retry;
@@ -1762,9 +1851,61 @@ retry2:
 			p += len;
 		}
 	}
+	if (bufcheck (st, p, 0))
+		goto retry;
 	save_u32_func (&p, tlen);
 	st->end = p;
+	for (i = 0; i < STATERECORD_RAMS; i++) {
+		dst = staterecord_ram (i, &len);
+		if (dst && len > 0)
+			memcpy (st->ram[i], dst, len);
+	}
 	st->inuse = 1;
+	return st;
+retry:
+	if (retrycnt < 10) {
+		staterecord_statesize *= 2;
+		write_log (_T("state record area grown to %d bytes\n"), staterecord_statesize);
+		goto retry2;
+	}
+	write_log (_T("can't save, too small capture buffer or out of memory\n"));
+	return st;
+}
+
+void savestate_capture (int force)
+{
+	int i;
+	struct staterecord *st;
+	bool firstcapture = false;
+
+#ifdef FILESYS
+	if (nr_units ())
+		return;
+#endif
+	if (!staterecords)
+		return;
+	if (!input_record)
+		return;
+	if (currprefs.statecapturerate && hsync_counter == 0 && input_record == INPREC_RECORD_START && savestate_first_capture > 0) {
+		// first capture
+		force = true;
+		firstcapture = true;
+	} else if (savestate_first_capture < 0) {
+		force = true;
+		firstcapture = false;
+	}
+	if (!force) {
+		if (currprefs.statecapturerate <= 0)
+			return;
+		if (hsync_counter % currprefs.statecapturerate)
+			return;
+	}
+	savestate_first_capture = false;
+
+	st = savestate_record_save (staterecords[replaycounter]);
+	staterecords[replaycounter] = st;
+	if (!st || !st->inuse)
+		return;
 	st->inprecoffset = inprec_getposition ();
 
 	replaycounter++;
@@ -1776,11 +1917,6 @@ retry2:
 			staterecords_first -= staterecords_max;
 	}
 
-	write_log (_T("state capture %d (%010ld/%03ld,%ld/%d) (%ld bytes, alloc %d)\n"),
-		replaycounter, hsync_counter, vsync_counter,
-		hsync_counter % current_maxvpos (), current_maxvpos (),
-		st->end - st->data, statefile_alloc);
-
 	if (firstcapture) {
 		savestate_memorysave ();
 		input_record++;
@@ -1793,12 +1929,6 @@ retry2:
 	}
 
 
-	return;
-retry:
-	if (retrycnt < 10)
-		goto retry2;
-	write_log (_T("can't save, too small capture buffer or out of memory\n"));
-	return;
 }
 
 void savestate_free (void)
@@ -1812,13 +1942,125 @@ void savestate_capture_request (void)
 	savestate_first_capture = -1;
 }
 
+static bool runahead_possible (void)
+{
+	if (currprefs.runahead <= 0)
+		return false;
+	if (input_record || input_play)
+		return false;
+#ifdef FILESYS
+	/* host file system changes can't be undone */
+	if (nr_units ())
+		return false;
+#endif
+	return true;
+}
+
+/* Called at the start of vertical blank, before the completed frame is
+ * drawn. Decides whether the completed frame is displayed and whether the
+ * next frame is drawn at all. */
+void savestate_runahead_vsync (void)
+{
+	int ended = runahead_frame;
+	int next;
+
+	if (currprefs.runahead != changed_prefs.runahead) {
+		currprefs.runahead = changed_prefs.runahead;
+		write_log (_T("run-ahead: %d frames\n"), currprefs.runahead);
+	}
+	runahead_show = ended < 0 || ended == runahead_frames;
+	runahead_events = ended <= 0;
+	runahead_action = RUNAHEAD_NONE;
+
+	if (ended > 0 && (ended == runahead_frames || !runahead_possible ())) {
+		runahead_action = RUNAHEAD_RESTORE;
+		next = 0;
+	} else if (ended == 0) {
+		runahead_action = RUNAHEAD_SAVE;
+		next = 1;
+	} else if (ended > 0) {
+		next = ended + 1;
+	} else {
+		next = 0;
+	}
+	if (next == 0) {
+		if (!runahead_possible ()) {
+			if (ended >= 0)
+				write_log (_T("run-ahead: stopped\n"));
+			next = -1;
+		} else {
+			runahead_frames = currprefs.runahead;
+		}
+	}
+	if (next < 0 && runahead_action == RUNAHEAD_RESTORE) {
+		/* the restore takes us back to a real frame */
+		next = 0;
+		runahead_frames = 0;
+	}
+	runahead_frame = next;
+	if (next >= 0 && next != runahead_frames)
+		set_inhibit_frame (IHF_RUNAHEAD);
+	else
+		clear_inhibit_frame (IHF_RUNAHEAD);
+}
+
+/* Whether host events (input, frame pacing) are handled this vsync */
+bool savestate_runahead_events (void)
+{
+	return runahead_events;
+}
+
+/* Whether the frame completed at this vsync is to be displayed */
+bool savestate_runahead_show (void)
+{
+	return runahead_show;
+}
+
+/* Whether a frame which will be discarded is being emulated */
+bool savestate_runahead_ahead (void)
+{
+	return runahead_frame > 0 || savestate_state == STATE_RUNAHEAD;
+}
+
+static void runahead_save (void)
+{
+	runahead_record = savestate_record_save (runahead_record);
+	runahead_keybufpos = keybuf_getreadpos ();
+	if (!runahead_record || !runahead_record->inuse) {
+		write_log (_T("run-ahead: could not save state, disabled\n"));
+		changed_prefs.runahead = currprefs.runahead = 0;
+		runahead_frame = -1;
+		clear_inhibit_frame (IHF_RUNAHEAD);
+	}
+}
+
+void savestate_runahead_free (void)
+{
+	savestate_record_free (runahead_record);
+	runahead_record = NULL;
+	runahead_frame = -1;
+}
+
+/* Called from the main loop, in place of restore_state */
+void savestate_runahead_restore (void)
+{
+	write_log_mute (1);
+	if (!savestate_record_restore (runahead_record)) {
+		write_log_mute (0);
+		changed_prefs.runahead = currprefs.runahead = 0;
+		runahead_frame = -1;
+		clear_inhibit_frame (IHF_RUNAHEAD);
+		return;
+	}
+	keybuf_setreadpos (runahead_keybufpos);
+}
+
 void savestate_init (void)
 {
 	savestate_free ();
 	replaycounter = 0;
 	staterecords_max = currprefs.statecapturebuffersize;
 	staterecords = xcalloc (struct staterecord*, staterecords_max);
-	statefile_alloc = STATEFILE_ALLOC_SIZE;
 	if (input_record && savestate_state != STATE_DORESTORE) {
 		zfile_fclose (staterecord_statefile);
 		staterecord_statefile = NULL;
@@ -1364,7 +1364,13 @@ void ncr80_rethink(void)
 	for (int i = 0; soft_scsi_devices[i]; i++) {
 		if (soft_scsi_devices[i]->irq && soft_scsi_devices[i]->intena) {
 			if (soft_scsi_devices[i] == x86_hd_data) {
+#ifdef WITH_X86
+				x86_bridge_sync_lock();
+#endif
 				x86_doirq(5);
+#ifdef WITH_X86
+				x86_bridge_sync_unlock();
+#endif
 			} else {
 				if (soft_scsi_devices[i]->level6)
 					INTREQ_0(0x8000 | 0x2000);
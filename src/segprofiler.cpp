@@ -0,0 +1,306 @@
+/*
+* UAE - The Un*x Amiga Emulator
+*
+* Guest Sampling Profiler
+*
+* Samples the 68k PC and the A5 frame pointer chain every N scanlines and
+* maps the addresses to SegmentTracker seglists/hunks (and symbols, if
+* debug info was loaded with 'Zf'). The result can be written in the
+* "folded stacks" format used by flamegraph.pl and speedscope.
+*/
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+#include "options.h"
+
+#include "uae/memory.h"
+#include "newcpu.h"
+#include "debug.h"
+#include "uae/debuginfo.h"
+#include "uae/segtracker.h"
+#include "uae/segprofiler.h"
+
+#define PROF_MAX_DEPTH 16
+#define PROF_NAME_LEN 128
+
+/* one unique call chain, frames are stored leaf first */
+typedef struct {
+    uae_u32 hash;
+    uae_u32 count;
+    int depth;
+    int frames[PROF_MAX_DEPTH];
+} prof_stack;
+
+int segprofiler_interval = 0;
+static int line_counter;
+static uae_u32 num_samples;
+
+/* interned frame names */
+static char **names;
+static int num_names;
+static int max_names;
+static int *name_hash; /* index + 1, 0 is empty */
+static int name_hash_size;
+
+/* open addressing hash table of call chains */
+static prof_stack *stacks;
+static int num_stacks;
+static int stack_hash_size;
+
+static uae_u32 hash_bytes(uae_u32 hash, const void *data, int len)
+{
+    const uae_u8 *p = (const uae_u8 *)data;
+    for(int i=0;i<len;i++) {
+        hash ^= p[i];
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+static uae_u32 hash_string(const char *str)
+{
+    return hash_bytes(2166136261u, str, strlen(str));
+}
+
+static void name_hash_insert(int index)
+{
+    int mask = name_hash_size - 1;
+    int pos = hash_string(names[index]) & mask;
+    while(name_hash[pos] != 0) {
+        pos = (pos + 1) & mask;
+    }
+    name_hash[pos] = index + 1;
+}
+
+static int intern_name(const char *name)
+{
+    if(name_hash_size == 0 || (num_names + 1) * 2 > name_hash_size) {
+        /* grow hash and rehash all names */
+        int new_size = name_hash_size ? name_hash_size * 2 : 256;
+        xfree(name_hash);
+        name_hash = xcalloc(int, new_size);
+        name_hash_size = new_size;
+        for(int i=0;i<num_names;i++) {
+            name_hash_insert(i);
+        }
+    }
+    int mask = name_hash_size - 1;
+    int pos = hash_string(name) & mask;
+    while(name_hash[pos] != 0) {
+        int index = name_hash[pos] - 1;
+        if(strcmp(names[index], name) == 0) {
+            return index;
+        }
+        pos = (pos + 1) & mask;
+    }
+    if(num_names == max_names) {
+        max_names = max_names ? max_names * 2 : 256;
+        names = xrealloc(char*, names, max_names);
+    }
+    names[num_names] = my_strdup(name);
+    name_hash[pos] = num_names + 1;
+    return num_names++;
+}
+
+/* the folded format uses ';' as frame separator and ' ' before the count */
+static void sanitize_name(char *name)
+{
+    for(char *p = name; *p; p++) {
+        if(*p == ';' || *p == ' ' || *p == '\n') {
+            *p = '_';
+        }
+    }
+}
+
+static int frame_for_address(uae_u32 addr)
+{
+    char name[PROF_NAME_LEN];
+    seglist *sl;
+    int num_seg;
+    if(segtracker_search_address(addr, &sl, &num_seg)) {
+        segment *seg = &sl->segments[num_seg];
+        debug_symbol *symbol;
+        uae_u32 reloff;
+        const char *sl_name = strrchr(sl->name, ':');
+        sl_name = sl_name ? sl_name + 1 : sl->name;
+        if(segtracker_find_symbol(seg, addr - seg->addr, &symbol, &reloff) == 1) {
+            snprintf(name, sizeof(name), "%s`%s", sl_name, symbol->name);
+        } else {
+            snprintf(name, sizeof(name), "%s`hunk%d", sl_name, num_seg);
+        }
+    } else if(addr >= 0xf80000 && addr < 0x1000000) {
+        snprintf(name, sizeof(name), "[kickstart]");
+    } else if(addr >= 0xe00000 && addr < 0xf80000) {
+        snprintf(name, sizeof(name), "[rom]");
+    } else {
+        snprintf(name, sizeof(name), "[unknown]");
+    }
+    sanitize_name(name);
+    return intern_name(name);
+}
+
+static void stack_insert(prof_stack *entry)
+{
+    int mask = stack_hash_size - 1;
+    int pos = entry->hash & mask;
+    while(stacks[pos].depth != 0) {
+        pos = (pos + 1) & mask;
+    }
+    stacks[pos] = *entry;
+}
+
+static void add_stack(const int *frames, int depth)
+{
+    if(stack_hash_size == 0 || (num_stacks + 1) * 2 > stack_hash_size) {
+        int old_size = stack_hash_size;
+        prof_stack *old = stacks;
+        stack_hash_size = old_size ? old_size * 2 : 1024;
+        stacks = xcalloc(prof_stack, stack_hash_size);
+        for(int i=0;i<old_size;i++) {
+            if(old[i].depth != 0) {
+                stack_insert(&old[i]);
+            }
+        }
+        xfree(old);
+    }
+
+    uae_u32 hash = hash_bytes(2166136261u, frames, depth * sizeof(int));
+    int mask = stack_hash_size - 1;
+    int pos = hash & mask;
+    while(stacks[pos].depth != 0) {
+        prof_stack *s = &stacks[pos];
+        if(s->hash == hash && s->depth == depth &&
+           memcmp(s->frames, frames, depth * sizeof(int)) == 0) {
+            s->count++;
+            return;
+        }
+        pos = (pos + 1) & mask;
+    }
+    prof_stack *s = &stacks[pos];
+    s->hash = hash;
+    s->count = 1;
+    s->depth = depth;
+    memcpy(s->frames, frames, depth * sizeof(int));
+    num_stacks++;
+}
+
+/* take one sample: current PC plus return addresses found by walking the
+   LINK A5 frame chain (saved A5 at (A5), return address at 4(A5)) */
+void segprofiler_sample(void)
+{
+    if(++line_counter < segprofiler_interval) {
+        return;
+    }
+    line_counter = 0;
+
+    uae_u32 addrs[PROF_MAX_DEPTH];
+    int depth = 0;
+    addrs[depth++] = m68k_getpc();
+
+    /* without MMU only, guest addresses are physical */
+    if(!currprefs.mmu_model) {
+        uae_u32 fp = m68k_areg(regs, 5);
+        while(depth < PROF_MAX_DEPTH) {
+            if((fp & 1) || !valid_address(fp, 8)) {
+                break;
+            }
+            uae_u32 next = get_long(fp);
+            uae_u32 ret = get_long(fp + 4);
+            if(ret & 1) {
+                break;
+            }
+            addrs[depth++] = ret;
+            /* frames must be at increasing addresses */
+            if(next <= fp) {
+                break;
+            }
+            fp = next;
+        }
+    }
+
+    int frames[PROF_MAX_DEPTH];
+    int num_frames = 0;
+    for(int i=0;i<depth;i++) {
+        int frame = frame_for_address(addrs[i]);
+        /* collapse adjacent frames in the same hunk/function */
+        if(num_frames > 0 && frames[num_frames - 1] == frame) {
+            continue;
+        }
+        frames[num_frames++] = frame;
+    }
+    add_stack(frames, num_frames);
+    num_samples++;
+}
+
+void segprofiler_clear(void)
+{
+    for(int i=0;i<num_names;i++) {
+        xfree(names[i]);
+    }
+    xfree(names);
+    names = NULL;
+    num_names = 0;
+    max_names = 0;
+    xfree(name_hash);
+    name_hash = NULL;
+    name_hash_size = 0;
+    xfree(stacks);
+    stacks = NULL;
+    num_stacks = 0;
+    stack_hash_size = 0;
+    num_samples = 0;
+    line_counter = 0;
+}
+
+void segprofiler_start(int interval)
+{
+    if(interval <= 0) {
+        segprofiler_stop();
+        return;
+    }
+    segprofiler_clear();
+    segprofiler_interval = interval;
+    if(!segtracker_enabled) {
+        console_out_f(_T("SegmentTracker is disabled, samples will not be mapped to seglists ('Ze 1').\n"));
+    }
+}
+
+void segprofiler_stop(void)
+{
+    segprofiler_interval = 0;
+}
+
+void segprofiler_status(void)
+{
+    if(segprofiler_interval) {
+        console_out_f(_T("Profiler is sampling every %d lines\n"), segprofiler_interval);
+    } else {
+        console_out_f(_T("Profiler is stopped\n"));
+    }
+    console_out_f(_T("%u samples, %d unique stacks, %d frames\n"),
+                  num_samples, num_stacks, num_names);
+}
+
+/* write samples in folded stacks format: "root;caller;leaf count" */
+int segprofiler_write_folded(const char *file_name)
+{
+    FILE *f = fopen(file_name, "w");
+    if(f == NULL) {
+        return -1;
+    }
+    for(int i=0;i<stack_hash_size;i++) {
+        prof_stack *s = &stacks[i];
+        if(s->depth == 0) {
+            continue;
+        }
+        for(int j=s->depth-1;j>=0;j--) {
+            fputs(names[s->frames[j]], f);
+            if(j > 0) {
+                fputc(';', f);
+            }
+        }
+        fprintf(f, " %u\n", s->count);
+    }
+    fclose(f);
+    return num_stacks;
+}
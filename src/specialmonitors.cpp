@@ -12,6 +12,7 @@
 #include "specialmonitors.h"
 #include "debug.h"
 #include "zfile.h"
+#include "rowworkers.h"
 
 static bool automatic;
 static int monitor;
@@ -210,6 +211,52 @@ static void blank_generic(struct vidbuffer *src, struct vidbuffer *dst, int oddl
 	}
 }
 
+/* Frame geometry of the decoders that process line bands on the row
+   workers. The lines of one band must not depend on other lines. */
+struct sm_rows
+{
+	struct vidbuffer *src, *dst;
+	bool doublelines;
+	int oddlines;
+	int ystart, yend;
+	int vdbl, hdbl;
+	int xadd, xaddpix;
+};
+
+#define SM_MINROWS 16
+
+static void sm_rows_init(struct sm_rows *r, struct vidbuffer *src, struct vidbuffer *dst, bool doublelines, int oddlines)
+{
+	int isntsc;
+
+	isntsc = (beamcon0 & 0x20) ? 0 : 1;
+	if (!(currprefs.chipset_mask & CSMASK_ECS_AGNUS))
+		isntsc = currprefs.ntscmode ? 1 : 0;
+
+	r->src = src;
+	r->dst = dst;
+	r->oddlines = oddlines;
+	r->vdbl = gfxvidinfo.ychange;
+	/* With vdbl == 2 the second line written by a row is the first line of
+	   the next row, which may belong to another band. Serially it was
+	   overwritten by that row anyway. */
+	r->doublelines = doublelines && r->vdbl == 1;
+	r->hdbl = gfxvidinfo.xchange;
+	r->xaddpix = (1 << 1) / r->hdbl;
+	r->xadd = r->xaddpix * src->pixbytes;
+	r->ystart = isntsc ? VBLANK_ENDLINE_NTSC : VBLANK_ENDLINE_PAL;
+	r->yend = isntsc ? MAXVPOS_NTSC : MAXVPOS_PAL;
+}
+
+/* Source line of y, -1 if outside of the source buffer */
+STATIC_INLINE int sm_yoff(struct sm_rows *r, int y)
+{
+	int yoff = (((y * 2 + r->oddlines) - r->src->yoffset) / r->vdbl);
+	if (yoff < 0 || yoff >= r->src->inheight)
+		return -1;
+	return yoff;
+}
+
 static const uae_u8 dctv_signature[] = {
 	0x93,0x0e,0x51,0xbc,0x22,0x17,0xdf,0xa4,0x19,0x1d,0x16,0x6a,0xb6,0xeb,0xd9,0x70,
 	0x52,0xd6,0x07,0xf2,0x57,0x68,0x69,0xdc,0xce,0x3c,0xf8,0x9e,0xa6,0xc6,0x2a
@@ -387,9 +434,22 @@ static const uae_u16 dctv_tables[] = {
 };
 
 #define DCTV_BUFFER_SIZE 1000
-static uae_s8 dctv_chroma[2 * DCTV_BUFFER_SIZE];
-static uae_u8 dctv_luma[2 * DCTV_BUFFER_SIZE];
 
+/* Chroma of each decoded line. Every line is decoded with the chroma of
+   the previous line of the other field parity, so the chroma of all lines
+   is computed first and the lines are then decoded independently. */
+static uae_s8 *dctv_chroma;
+static uae_u8 *dctv_chroma_valid;
+static int *dctv_chroma_prev;
+static int dctv_chroma_rows;
+static uae_s8 dctv_chroma_blank[DCTV_BUFFER_SIZE];
+
+struct dctv_rows
+{
+	struct sm_rows r;
+	int yfirst;
+	int signature;
+};
 
 STATIC_INLINE int minmax(int v, int min, int max)
 {
@@ -405,50 +465,22 @@ STATIC_INLINE int minmax(int v, int min, int max)
 static int signature_test_y = 0x93;
 #endif
 
-static bool dctv(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines, int oddlines)
+/* Returns the line that contains the DCTV signature, or -1 */
+static int dctv_find_signature(struct sm_rows *r, int *yfirst)
 {
-	int y, x, vdbl, hdbl;
-	int ystart, yend, isntsc;
-	int xadd;
-
-	isntsc = (beamcon0 & 0x20) ? 0 : 1;
-	if (!(currprefs.chipset_mask & CSMASK_ECS_AGNUS))
-		isntsc = currprefs.ntscmode ? 1 : 0;
-
-	vdbl = gfxvidinfo.ychange;
-	hdbl = gfxvidinfo.xchange;
-
-	xadd = ((1 << 1) / hdbl) * src->pixbytes;
-
-	ystart = isntsc ? VBLANK_ENDLINE_NTSC : VBLANK_ENDLINE_PAL;
-	yend = isntsc ? MAXVPOS_NTSC : MAXVPOS_PAL;
-
-	int signature_detected = -1;
+	struct vidbuffer *src = r->src;
 	int signature_cnt = 0;
-	bool dctv_enabled = false;
-	int ycnt = 0;
-	memset(dctv_luma, 64, sizeof DCTV_BUFFER_SIZE);
 
-	for (y = ystart; y < yend; y++) {
-		int yoff = (((y * 2 + oddlines) - src->yoffset) / vdbl);
+	*yfirst = -1;
+	for (int y = r->ystart; y < r->yend; y++) {
+		int yoff = (((y * 2 + r->oddlines) - src->yoffset) / r->vdbl);
 		if (yoff < 0)
 			continue;
 		if (yoff >= src->inheight)
 			continue;
 		uae_u8 *line = src->bufmem + yoff * src->rowbytes;
-		uae_u8 *dstline = dst->bufmem + (((y * 2 + oddlines) - dst->yoffset) / vdbl) * dst->rowbytes;
-
-		int firstnz = -1;
-		bool sign = false;
-		int oddeven = 0;
-		uae_u8 prev = 0;
-		uae_u8 vals[3] = { 0x40, 0x40, 0x40 };
-		int zigzagoffset = 0;
-		int prevtval = 0;
-		uae_s8 *chrbuf_w = NULL, *chrbuf_r1 = NULL, *chrbuf_r2 = NULL;
-		uae_u8 *lumabuf1 = dctv_luma, *lumabuf2 = dctv_luma;
-	
-		ycnt++;
+		if (*yfirst < 0)
+			*yfirst = y;
 
 #if DCTV_SIGNATURE_DEBUG
 		uae_u8 signx = 0;
@@ -457,21 +489,16 @@ static bool dctv(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines,
 			write_log(_T("\n"));
 #endif
 
-		for (x = 0; x < src->inwidth; x++) {
-			uae_u8 *s = line + ((x << 1) / hdbl) * src->pixbytes;
-			uae_u8 *d = dstline + ((x << 1) / hdbl) * dst->pixbytes + zigzagoffset;
-			uae_u8 *s2 = s + src->rowbytes;
-			uae_u8 *d2 = d + dst->rowbytes;
+		for (int x = 0; x < src->inwidth; x++) {
+			uae_u8 *s = line + ((x << 1) / r->hdbl) * src->pixbytes;
 			uae_u8 newval = DCTV_FIRBG(src, s);
 
 			int mask = 1 << (7 - (signature_cnt & 7));
 			int bitval = (newval & 0x40) ? mask : 0;
 			if ((dctv_signature[signature_cnt / 8] & mask) == bitval) {
 				signature_cnt++;
-				if (signature_cnt == sizeof (dctv_signature) * 8) {
-					dctv_enabled = true;
-					signature_detected = y;
-				}
+				if (signature_cnt == sizeof (dctv_signature) * 8)
+					return y;
 			} else {
 				signature_cnt = 0;
 			}
@@ -492,50 +519,85 @@ static bool dctv(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines,
 				}
 			}
 #endif
-			if (!dctv_enabled || signature_detected == y) {
-				PUT_AMIGARGB(d, s, d2, s2, dst, 0, doublelines, false);
-				continue;
-			}
+		}
+	}
+	return -1;
+}
 
-			uae_u8 val = prev | newval;
-			if (firstnz < 0 && newval) {
-				firstnz = 0;
-				if (ycnt & 1) {
-					zigzagoffset = 0;
-					oddeven = -1;
-					chrbuf_w = dctv_chroma + 8;
-					chrbuf_r1 = dctv_chroma + 8;
-					chrbuf_r2 = dctv_chroma + DCTV_BUFFER_SIZE + 8;
-				} else {
-					zigzagoffset = dst->pixbytes;
-					oddeven = -1;
-					chrbuf_w = dctv_chroma + DCTV_BUFFER_SIZE + 8;
-					chrbuf_r2 = dctv_chroma + 8;
-					chrbuf_r1 = dctv_chroma + DCTV_BUFFER_SIZE + 8;
-				}
-				sign = false;
+/* Without render only the chroma of the line is stored */
+static void dctv_line(struct dctv_rows *c, int y, bool render)
+{
+	struct vidbuffer *src = c->r.src;
+	struct vidbuffer *dst = c->r.dst;
+	int hdbl = c->r.hdbl;
+	bool doublelines = c->r.doublelines;
+	int row = y - c->yfirst;
+
+	int yoff = (((y * 2 + c->r.oddlines) - src->yoffset) / c->r.vdbl);
+	uae_u8 *line = src->bufmem + yoff * src->rowbytes;
+	uae_u8 *dstline = dst->bufmem + (((y * 2 + c->r.oddlines) - dst->yoffset) / c->r.vdbl) * dst->rowbytes;
+
+	int firstnz = -1;
+	bool sign = false;
+	int oddeven = 0;
+	uae_u8 prev = 0;
+	uae_u8 vals[3] = { 0x40, 0x40, 0x40 };
+	int zigzagoffset = 0;
+	uae_s8 *chrbuf_w = NULL, *chrbuf_r1 = NULL, *chrbuf_r2 = NULL;
+	uae_u8 lumabuf[DCTV_BUFFER_SIZE + 2];
+	uae_u8 *lumabuf1 = lumabuf + 2;
+
+	lumabuf[0] = lumabuf[1] = 64;
+
+	for (int x = 0; x < src->inwidth; x++) {
+		uae_u8 *s = line + ((x << 1) / hdbl) * src->pixbytes;
+		uae_u8 *d = dstline + ((x << 1) / hdbl) * dst->pixbytes + zigzagoffset;
+		uae_u8 *d2 = d + dst->rowbytes;
+		uae_u8 newval = DCTV_FIRBG(src, s);
+
+		uae_u8 val = prev | newval;
+		if (firstnz < 0 && newval) {
+			firstnz = 0;
+			// odd and even lines are offset by one pixel
+			zigzagoffset = (row & 1) ? dst->pixbytes : 0;
+			oddeven = -1;
+			chrbuf_w = dctv_chroma + row * DCTV_BUFFER_SIZE + 8;
+			chrbuf_r1 = chrbuf_w;
+			if (render) {
+				int prevrow = dctv_chroma_prev[row];
+				if (prevrow >= 0)
+					chrbuf_r2 = dctv_chroma + prevrow * DCTV_BUFFER_SIZE + 8;
+				else
+					chrbuf_r2 = dctv_chroma_blank + 8;
+			} else {
+				memset(chrbuf_w - 8, 0, 8);
+				dctv_chroma_valid[row] = 1;
 			}
+			sign = false;
+		}
 
-			if (oddeven > 0 && !firstnz) {
-				sign = !sign;
+		if (oddeven > 0 && !firstnz) {
+			sign = !sign;
 
-				if (val == 0)
-					val = 64;
+			if (val == 0)
+				val = 64;
 
-				vals[2] = vals[1];
-				vals[1] = vals[0];
-				vals[0] = val;
+			vals[2] = vals[1];
+			vals[1] = vals[0];
+			vals[0] = val;
 
-				int v0 = 2 * vals[1] - vals[2] - vals[0] + 2;
-				if (v0 < 0)
-					v0 += 3;
-				v0 /= 4;
-				int v1 = -v0;
-				if (sign)
-					v0 = -v0;
+			int v0 = 2 * vals[1] - vals[2] - vals[0] + 2;
+			if (v0 < 0)
+				v0 += 3;
+			v0 /= 4;
+			int v1 = -v0;
+			if (sign)
+				v0 = -v0;
+			if (!render)
 				*chrbuf_w = minmax(v0, -127, 127);
-				*lumabuf1 = minmax(vals[2] + v1, 64, 224);
+			*lumabuf1 = minmax(vals[2] + v1, 64, 224);
 
+			if (render) {
 				int ch1 = chrbuf_r1[0] + chrbuf_r1[-1];
 				int ch2 = chrbuf_r2[0] + chrbuf_r2[-1];
 				ch1 /= 2;
@@ -560,31 +622,95 @@ static bool dctv(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines,
 					PRGB(dst, d2 - dst->pixbytes, r, g, b);
 					PRGB(dst, d2, r, g, b);
 				}
+			}
 
-				chrbuf_r1++;
-				chrbuf_r2++;
-				chrbuf_w++;
-				lumabuf1++;
-
-			} else if (oddeven < 0) {
+			chrbuf_r1++;
+			chrbuf_r2++;
+			chrbuf_w++;
+			lumabuf1++;
 
-				uae_u8 r = 0, b = 0, g = 0;
-				PRGB(dst, d - dst->pixbytes, r, g, b);
-				PRGB(dst, d, r, g, b);
-				if (doublelines) {
-					PRGB(dst, d2 - dst->pixbytes, r, g, b);
-					PRGB(dst, d2, r, g, b);
-				}
+		} else if (oddeven < 0 && render) {
 
+			uae_u8 r = 0, b = 0, g = 0;
+			PRGB(dst, d - dst->pixbytes, r, g, b);
+			PRGB(dst, d, r, g, b);
+			if (doublelines) {
+				PRGB(dst, d2 - dst->pixbytes, r, g, b);
+				PRGB(dst, d2, r, g, b);
 			}
 
-			if (oddeven >= 0)
-				oddeven = oddeven ? 0 : 1;
-			else
-				oddeven++;
-			prev = newval << 1;
 		}
+
+		if (oddeven >= 0)
+			oddeven = oddeven ? 0 : 1;
+		else
+			oddeven++;
+		prev = newval << 1;
 	}
+}
+
+static void dctv_chroma_rows_func(void *v, int first, int last)
+{
+	struct dctv_rows *c = (struct dctv_rows*)v;
+	for (int y = c->r.ystart + first; y < c->r.ystart + last; y++) {
+		if (y <= c->signature || sm_yoff(&c->r, y) < 0)
+			continue;
+		dctv_line(c, y, false);
+	}
+}
+
+static void dctv_rows_func(void *v, int first, int last)
+{
+	struct dctv_rows *c = (struct dctv_rows*)v;
+	struct vidbuffer *src = c->r.src;
+	struct vidbuffer *dst = c->r.dst;
+	for (int y = c->r.ystart + first; y < c->r.ystart + last; y++) {
+		if (sm_yoff(&c->r, y) < 0)
+			continue;
+		if (c->signature >= 0 && y > c->signature) {
+			dctv_line(c, y, true);
+			continue;
+		}
+		uae_u8 *line = src->bufmem + sm_yoff(&c->r, y) * src->rowbytes;
+		uae_u8 *dstline = dst->bufmem + (((y * 2 + c->r.oddlines) - dst->yoffset) / c->r.vdbl) * dst->rowbytes;
+		for (int x = 0; x < src->inwidth; x++) {
+			uae_u8 *s = line + ((x << 1) / c->r.hdbl) * src->pixbytes;
+			uae_u8 *d = dstline + ((x << 1) / c->r.hdbl) * dst->pixbytes;
+			PUT_AMIGARGB(d, s, d + dst->rowbytes, s + src->rowbytes, dst, 0, c->r.doublelines, false);
+		}
+	}
+}
+
+static bool dctv(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines, int oddlines)
+{
+	struct dctv_rows c;
+	int rows;
+
+	sm_rows_init(&c.r, src, dst, doublelines, oddlines);
+	rows = c.r.yend - c.r.ystart;
+
+	c.signature = dctv_find_signature(&c.r, &c.yfirst);
+	if (c.yfirst < 0)
+		return false;
+
+	bool dctv_enabled = c.signature >= 0;
+	if (dctv_enabled) {
+		if (rows > dctv_chroma_rows) {
+			dctv_chroma = xrealloc(uae_s8, dctv_chroma, rows * DCTV_BUFFER_SIZE);
+			dctv_chroma_valid = xrealloc(uae_u8, dctv_chroma_valid, rows);
+			dctv_chroma_prev = xrealloc(int, dctv_chroma_prev, rows);
+			dctv_chroma_rows = rows;
+		}
+		memset(dctv_chroma_valid, 0, rows);
+		rowworkers_run(rows, SM_MINROWS, dctv_chroma_rows_func, &c);
+		int last[2] = { -1, -1 };
+		for (int row = 0; row < rows; row++) {
+			dctv_chroma_prev[row] = last[(row & 1) ^ 1];
+			if (dctv_chroma_valid[row])
+				last[row & 1] = row;
+		}
+	}
+	rowworkers_run(rows, SM_MINROWS, dctv_rows_func, &c);
 
 	if (dctv_enabled) {
 		dst->nativepositioning = true;
@@ -650,78 +776,33 @@ STATIC_INLINE uae_u8 MAKEFCOVERLAY(uae_u8 v)
 	return v;
 }
 
-static bool firecracker24(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines, int oddlines)
+struct fc24_rows
 {
-	int y, x, vdbl, hdbl;
-	int fc24_y, fc24_x, fc24_dx, fc24_xadd, fc24_xmult, fc24_xoffset;
-	int ystart, yend, isntsc;
-	int xadd, xaddfc;
+	struct sm_rows r;
+	int yfirst;
+	int fc24_dx, fc24_xadd, fc24_xoffset;
 	int bufferoffset;
+};
 
-	// FC disabled and Amiga enabled?
-	if (!(fc24_cr1 & 1) && !(fc24_cr0 & 1))
-		return false;
-
-	isntsc = (beamcon0 & 0x20) ? 0 : 1;
-	if (!(currprefs.chipset_mask & CSMASK_ECS_AGNUS))
-		isntsc = currprefs.ntscmode ? 1 : 0;
-
-	vdbl = gfxvidinfo.ychange;
-	hdbl = gfxvidinfo.xchange; // 4=lores,2=hires,1=shres
-
-	xaddfc = (1 << 1) / hdbl; // 0=lores,1=hires,2=shres
-	xadd = xaddfc * src->pixbytes;
-	
-
-	ystart = isntsc ? VBLANK_ENDLINE_NTSC : VBLANK_ENDLINE_PAL;
-	yend = isntsc ? MAXVPOS_NTSC : MAXVPOS_PAL;
-
-	switch (fc24_width)
-	{
-		case 384:
-		fc24_xmult = 0;
-		break;
-		case 512:
-		fc24_xmult = 1;
-		break;
-		case 768:
-		fc24_xmult = 1;
-		break;
-		case 1024:
-		fc24_xmult = 2;
-		break;
-		default:
-		return false;
-	}
-	
-	if (fc24_xmult >= xaddfc) {
-		fc24_xadd = fc24_xmult - xaddfc;
-		fc24_dx = 0;
-	} else {
-		fc24_xadd = 0;
-		fc24_dx = xaddfc - fc24_xmult;
-	}
-
-	fc24_xoffset = ((src->inwidth - ((fc24_width << fc24_dx) >> fc24_xadd)) / 2);
-	fc24_xadd = 1 << fc24_xadd;
-
-	bufferoffset = (fc24_cr0 & 2) ? 512 * SM_VRAM_BYTES: 0;
-
-	fc24_y = 0;
-	for (y = ystart; y < yend; y++) {
-		int oddeven = 0;
-		uae_u8 prev = 0;
-		int yoff = (((y * 2 + oddlines) - src->yoffset) / vdbl);
+static void fc24_rows_func(void *v, int first, int last)
+{
+	struct fc24_rows *c = (struct fc24_rows*)v;
+	struct vidbuffer *src = c->r.src;
+	struct vidbuffer *dst = c->r.dst;
+	int hdbl = c->r.hdbl;
+	int fc24_dx = c->fc24_dx, fc24_xoffset = c->fc24_xoffset;
+
+	for (int y = c->r.ystart + first; y < c->r.ystart + last; y++) {
+		int yoff = sm_yoff(&c->r, y);
 		if (yoff < 0)
 			continue;
-		if (yoff >= src->inheight)
-			continue;
+		int fc24_y = (y - c->yfirst) * 2;
 		uae_u8 *line = src->bufmem + yoff * src->rowbytes;
 		uae_u8 *line_genlock = row_map_genlock[yoff];
-		uae_u8 *dstline = dst->bufmem + (((y * 2 + oddlines) - dst->yoffset) / vdbl) * dst->rowbytes;
-		uae_u8 *vramline = sm_frame_buffer + (fc24_y + oddlines) * SM_VRAM_WIDTH * SM_VRAM_BYTES + bufferoffset;
-		fc24_x = 0;
-		for (x = 0; x < src->inwidth; x++) {
+		uae_u8 *dstline = dst->bufmem + (((y * 2 + c->r.oddlines) - dst->yoffset) / c->r.vdbl) * dst->rowbytes;
+		uae_u8 *vramline = sm_frame_buffer + (fc24_y + c->r.oddlines) * SM_VRAM_WIDTH * SM_VRAM_BYTES + c->bufferoffset;
+		int fc24_x = 0;
+		for (int x = 0; x < src->inwidth; x++) {
 			uae_u8 r = 0, g = 0, b = 0;
 			uae_u8 *s = line + ((x << 1) / hdbl) * src->pixbytes;
 			uae_u8 *s_genlock = line_genlock + ((x << 1) / hdbl);
@@ -744,10 +825,10 @@ static bool firecracker24(struct vidbuffer *src, struct vidbuffer *dst, bool dou
 			if (!(fc24_cr0 & 1) && (!(fc24_cr1 & 1) || (!is_transparent(s_genlock[0])))) {
 				uae_u8 *s2 = s + src->rowbytes;
 				uae_u8 *d2 = d + dst->rowbytes;
-				PUT_AMIGARGB(d, s, d2, s2, dst, xadd, doublelines, false);
+				PUT_AMIGARGB(d, s, d2, s2, dst, c->r.xadd, c->r.doublelines, false);
 			} else {
 				PUT_PRGB(d, NULL, dst, r, g, b, 0, false, false);
-				if (doublelines) {
+				if (c->r.doublelines) {
 					if (vramptr) {
 						vramptr += SM_VRAM_WIDTH * SM_VRAM_BYTES;
 						uae_u8 ax = vramptr[0];
@@ -764,10 +845,59 @@ static bool firecracker24(struct vidbuffer *src, struct vidbuffer *dst, bool dou
 					PUT_PRGB(d + dst->rowbytes, NULL, dst, r, g, b, 0, false, false);
 				}
 			}
-			fc24_x += fc24_xadd;
+			fc24_x += c->fc24_xadd;
 		}
-		fc24_y += 2;
 	}
+}
+
+static bool firecracker24(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines, int oddlines)
+{
+	struct fc24_rows c;
+	int fc24_xmult, xaddfc;
+
+	// FC disabled and Amiga enabled?
+	if (!(fc24_cr1 & 1) && !(fc24_cr0 & 1))
+		return false;
+
+	sm_rows_init(&c.r, src, dst, doublelines, oddlines);
+
+	xaddfc = c.r.xaddpix; // 0=lores,1=hires,2=shres
+
+	switch (fc24_width)
+	{
+		case 384:
+		fc24_xmult = 0;
+		break;
+		case 512:
+		fc24_xmult = 1;
+		break;
+		case 768:
+		fc24_xmult = 1;
+		break;
+		case 1024:
+		fc24_xmult = 2;
+		break;
+		default:
+		return false;
+	}
+	
+	if (fc24_xmult >= xaddfc) {
+		c.fc24_xadd = fc24_xmult - xaddfc;
+		c.fc24_dx = 0;
+	} else {
+		c.fc24_xadd = 0;
+		c.fc24_dx = xaddfc - fc24_xmult;
+	}
+
+	c.fc24_xoffset = ((src->inwidth - ((fc24_width << c.fc24_dx) >> c.fc24_xadd)) / 2);
+	c.fc24_xadd = 1 << c.fc24_xadd;
+
+	c.bufferoffset = (fc24_cr0 & 2) ? 512 * SM_VRAM_BYTES: 0;
+
+	c.yfirst = c.r.ystart;
+	while (c.yfirst < c.r.yend && sm_yoff(&c.r, c.yfirst) < 0)
+		c.yfirst++;
+	rowworkers_run(c.r.yend - c.r.ystart, SM_MINROWS, fc24_rows_func, &c);
 
 	dst->nativepositioning = true;
 	if (monitor != MONITOREMU_FIRECRACKER24) {
@@ -1101,64 +1231,26 @@ static int av24_writetovram[2];
 static int av24_mode[2];
 static int avideo_allowed;
 
-static bool avideo(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines, int oddlines, int lof)
+struct avideo_rows
 {
-	int y, x, vdbl, hdbl;
-	int ystart, yend, isntsc;
-	int xadd, xaddpix;
-	int mode;
-	int offset = -1;
-	bool writetovram;
-	bool av24;
-	int doublebuffer = -1;
+	struct sm_rows r;
+	int lof, mode, offset;
+	bool writetovram, av24;
 	uae_u16 fmode;
-	
-	fmode = avideo_previous_fmode[lof];
-
-	if (currprefs.monitoremu == MONITOREMU_AUTO) {
-		if (!avideo_allowed)
-			return false;
-		av24 = avideo_allowed == 24;
-	} else {
-		av24 = currprefs.monitoremu == MONITOREMU_AVIDEO24;
-	}
-
-	if (currprefs.chipset_mask & CSMASK_AGA)
-		return false;
-
-	if (av24) {
-		writetovram = av24_writetovram[lof] != 0;
-		mode = av24_mode[lof];
-	} else {
-		mode = fmode & 7;
-		if (mode == 1)
-			offset = 0;
-		else if (mode == 3)
-			offset = 1;
-		else if (mode == 2)
-			offset = 2;
-		writetovram = offset >= 0;
-	}
-
-	if (!mode)
-		return false;
-
-	sm_alloc_fb();
-
-	//write_log(_T("%04x %d %d %d\n"), avideo_previous_fmode[oddlines], mode, offset, writetovram);
-
-	isntsc = (beamcon0 & 0x20) ? 0 : 1;
-	if (!(currprefs.chipset_mask & CSMASK_ECS_AGNUS))
-		isntsc = currprefs.ntscmode ? 1 : 0;
-
-	vdbl = gfxvidinfo.ychange;
-	hdbl = gfxvidinfo.xchange;
-
-	xaddpix = (1 << 1) / hdbl;
-	xadd = ((1 << 1) / hdbl) * src->pixbytes;
+};
 
-	ystart = isntsc ? VBLANK_ENDLINE_NTSC : VBLANK_ENDLINE_PAL;
-	yend = isntsc ? MAXVPOS_NTSC : MAXVPOS_PAL;
+static void avideo_rows_func(void *v, int first, int last)
+{
+	struct avideo_rows *c = (struct avideo_rows*)v;
+	struct vidbuffer *src = c->r.src, *dst = c->r.dst;
+	int vdbl = c->r.vdbl, hdbl = c->r.hdbl, xaddpix = c->r.xaddpix;
+	int oddlines = c->r.oddlines;
+	bool doublelines = c->r.doublelines;
+	int lof = c->lof, mode = c->mode, offset = c->offset;
+	bool writetovram = c->writetovram, av24 = c->av24;
+	uae_u16 fmode = c->fmode;
+	int ystart = c->r.ystart + first, yend = c->r.ystart + last;
+	int y, x;
 
 	for (y = ystart; y < yend; y++) {
 		int oddeven = 0;
@@ -1343,6 +1435,59 @@ static bool avideo(struct vidbuffer *src, struct vidbuffer *dst, bool doubleline
 			}
 		}
 	}
+}
+
+static bool avideo(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines, int oddlines, int lof)
+{
+	struct avideo_rows c;
+	int mode;
+	int offset = -1;
+	bool writetovram;
+	bool av24;
+	uae_u16 fmode;
+	
+	fmode = avideo_previous_fmode[lof];
+
+	if (currprefs.monitoremu == MONITOREMU_AUTO) {
+		if (!avideo_allowed)
+			return false;
+		av24 = avideo_allowed == 24;
+	} else {
+		av24 = currprefs.monitoremu == MONITOREMU_AVIDEO24;
+	}
+
+	if (currprefs.chipset_mask & CSMASK_AGA)
+		return false;
+
+	if (av24) {
+		writetovram = av24_writetovram[lof] != 0;
+		mode = av24_mode[lof];
+	} else {
+		mode = fmode & 7;
+		if (mode == 1)
+			offset = 0;
+		else if (mode == 3)
+			offset = 1;
+		else if (mode == 2)
+			offset = 2;
+		writetovram = offset >= 0;
+	}
+
+	if (!mode)
+		return false;
+
+	sm_alloc_fb();
+
+	//write_log(_T("%04x %d %d %d\n"), avideo_previous_fmode[oddlines], mode, offset, writetovram);
+
+	sm_rows_init(&c.r, src, dst, doublelines, oddlines);
+	c.lof = lof;
+	c.mode = mode;
+	c.offset = offset;
+	c.writetovram = writetovram;
+	c.av24 = av24;
+	c.fmode = fmode;
+	rowworkers_run(c.r.yend - c.r.ystart, SM_MINROWS, avideo_rows_func, &c);
 
 	dst->nativepositioning = true;
 	if (monitor != MONITOREMU_AVIDEO12 && monitor != MONITOREMU_AVIDEO24) {
@@ -1425,35 +1570,24 @@ static bool do_avideo(struct vidbuffer *src, struct vidbuffer *dst)
 }
 
 
-static bool videodac18(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines, int oddlines)
+struct videodac18_rows
 {
-	int y, x, vdbl, hdbl;
-	int ystart, yend, isntsc;
-	int xadd, xaddpix;
-	uae_u16 hsstrt, hsstop, vsstrt, vsstop;
+	struct sm_rows r;
 	int xstart, xstop;
+	int vsstrt, vsstop;
+};
 
-	if ((beamcon0 & (0x80 | 0x100 | 0x200 | 0x10)) != 0x300)
-		return false;
-	getsyncregisters(&hsstrt, &hsstop, &vsstrt, &vsstop);
-
-	if (hsstop >= (maxhpos & ~1))
-		hsstrt = 0;
-	xstart = ((hsstrt * 2) << RES_MAX) - src->xoffset;
-	xstop = ((hsstop * 2) << RES_MAX) - src->xoffset;
-
-	isntsc = (beamcon0 & 0x20) ? 0 : 1;
-	if (!(currprefs.chipset_mask & CSMASK_ECS_AGNUS))
-		isntsc = currprefs.ntscmode ? 1 : 0;
-
-	vdbl = gfxvidinfo.ychange;
-	hdbl = gfxvidinfo.xchange;
-
-	xaddpix = (1 << 1) / hdbl;
-	xadd = ((1 << 1) / hdbl) * src->pixbytes;
-
-	ystart = isntsc ? VBLANK_ENDLINE_NTSC : VBLANK_ENDLINE_PAL;
-	yend = isntsc ? MAXVPOS_NTSC : MAXVPOS_PAL;
+static void videodac18_rows_func(void *v, int first, int last)
+{
+	struct videodac18_rows *c = (struct videodac18_rows*)v;
+	struct vidbuffer *src = c->r.src, *dst = c->r.dst;
+	int vdbl = c->r.vdbl, hdbl = c->r.hdbl, xaddpix = c->r.xaddpix;
+	int oddlines = c->r.oddlines;
+	bool doublelines = c->r.doublelines;
+	int xstart = c->xstart, xstop = c->xstop;
+	int vsstrt = c->vsstrt, vsstop = c->vsstop;
+	int ystart = c->r.ystart + first, yend = c->r.ystart + last;
+	int y, x;
 
 	uae_u8 r = 0, g = 0, b = 0;
 	for (y = ystart; y < yend; y++) {
@@ -1498,6 +1632,26 @@ static bool videodac18(struct vidbuffer *src, struct vidbuffer *dst, bool double
 			prev = val >> 4;
 		}
 	}
+}
+
+static bool videodac18(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines, int oddlines)
+{
+	struct videodac18_rows c;
+	uae_u16 hsstrt, hsstop, vsstrt, vsstop;
+
+	if ((beamcon0 & (0x80 | 0x100 | 0x200 | 0x10)) != 0x300)
+		return false;
+	getsyncregisters(&hsstrt, &hsstop, &vsstrt, &vsstop);
+
+	if (hsstop >= (maxhpos & ~1))
+		hsstrt = 0;
+	c.xstart = ((hsstrt * 2) << RES_MAX) - src->xoffset;
+	c.xstop = ((hsstop * 2) << RES_MAX) - src->xoffset;
+	c.vsstrt = vsstrt;
+	c.vsstop = vsstop;
+
+	sm_rows_init(&c.r, src, dst, doublelines, oddlines);
+	rowworkers_run(c.r.yend - c.r.ystart, SM_MINROWS, videodac18_rows_func, &c);
 
 	dst->nativepositioning = true;
 	if (monitor != MONITOREMU_VIDEODAC18) {
@@ -1910,9 +2064,76 @@ static bool graffiti(struct vidbuffer *src, struct vidbuffer *dst)
 
 /* A2024 information comes from US patent 4851826 */
 
+struct a2024_rows
+{
+	struct vidbuffer *src, *dst;
+	uae_u8 *srcbuf, *dstbuf;
+	int dbl;
+	int panel_width_draw;
+	bool hires;
+	uae_u8 dpl;
+};
+
+static void a2024_rows_func(void *v, int first, int last)
+{
+	struct a2024_rows *c = (struct a2024_rows*)v;
+	struct vidbuffer *src = c->src, *dst = c->dst;
+	int dbl = c->dbl, panel_width_draw = c->panel_width_draw;
+	bool hires = c->hires;
+	uae_u8 dpl = c->dpl;
+
+	for (int y = first; y < last; y++) {
+		uae_u8 *srcbuf = c->srcbuf + y * src->rowbytes * dbl;
+		uae_u8 *dstbuf = c->dstbuf + y * dst->rowbytes * dbl;
+		uae_u8 *srcp = srcbuf;
+		uae_u8 *dstp1 = dstbuf;
+		uae_u8 *dstp2 = dstbuf + dst->rowbytes;
+		int x;
+		for (x = 0; x < (panel_width_draw * 2) / gfxvidinfo.xchange; x++) {
+			uae_u8 c1 = 0, c2 = 0;
+			if (FR(src, srcp)) // R
+				c1 |= 2;
+			if (FG(src, srcp)) // G
+				c2 |= 2;
+			if (FB(src, srcp)) // B
+				c1 |= 1;
+			if (FI(src, srcp)) // I
+				c2 |= 1;
+			if (dpl == 0) {
+				c1 = c2 = 0;
+			} else if (dpl == 1) {
+				c1 &= 1;
+				c1 |= c1 << 1;
+				c2 &= 1;
+				c2 |= c2 << 1;
+			} else if (dpl == 2) {
+				c1 &= 2;
+				c1 |= c1 >> 1;
+				c2 &= 2;
+				c2 |= c2 >> 1;
+			}
+			if (dbl == 1) {
+				c1 = (c1 + c2 + 1) / 2;
+				c1 = (c1 << 6) | (c1 << 4) | (c1 << 2) | (c1 << 0);
+				PRGB(dst, dstp1, c1, c1, c1);
+			} else {
+				c1 = (c1 << 6) | (c1 << 4) | (c1 << 2) | (c1 << 0);
+				c2 = (c2 << 6) | (c2 << 4) | (c2 << 2) | (c2 << 0);
+				PRGB(dst, dstp1, c1, c1, c1);
+				PRGB(dst, dstp2, c2, c2, c2);
+				dstp2 += dst->pixbytes;
+			}
+			srcp += src->pixbytes;
+			if (!hires)
+				srcp += src->pixbytes;
+			dstp1 += dst->pixbytes;
+		}
+	}
+}
+
 static bool a2024(struct vidbuffer *src, struct vidbuffer *dst)
 {
-	int y;
+	struct a2024_rows c;
 	uae_u8 *srcbuf, *dstbuf;
 	uae_u8 *dataline;
 	int px, py, doff, pxcnt, dbl;
@@ -2028,57 +2249,15 @@ static bool a2024(struct vidbuffer *src, struct vidbuffer *dst)
 	srcbuf = src->bufmem + (((44 << VRES_MAX) - src->yoffset) / gfxvidinfo.ychange) * src->rowbytes + (((srcxoffset << RES_MAX) - src->xoffset) / gfxvidinfo.xchange) * src->pixbytes;
 	dstbuf = dst->bufmem + py * (panel_height / gfxvidinfo.ychange) * dst->rowbytes + px * ((panel_width * 2) / gfxvidinfo.xchange) * dst->pixbytes;
 
-	for (y = 0; y < (panel_height / (dbl == 1 ? 1 : 2)) / gfxvidinfo.ychange; y++) {
-#if 0
-		memcpy (dstbuf, srcbuf, ((panel_width * 2) / gfxvidinfo.xchange) * dst->pixbytes);
-#else
-		uae_u8 *srcp = srcbuf;
-		uae_u8 *dstp1 = dstbuf;
-		uae_u8 *dstp2 = dstbuf + dst->rowbytes;
-		int x;
-		for (x = 0; x < (panel_width_draw * 2) / gfxvidinfo.xchange; x++) {
-			uae_u8 c1 = 0, c2 = 0;
-			if (FR(src, srcp)) // R
-				c1 |= 2;
-			if (FG(src, srcp)) // G
-				c2 |= 2;
-			if (FB(src, srcp)) // B
-				c1 |= 1;
-			if (FI(src, srcp)) // I
-				c2 |= 1;
-			if (dpl == 0) {
-				c1 = c2 = 0;
-			} else if (dpl == 1) {
-				c1 &= 1;
-				c1 |= c1 << 1;
-				c2 &= 1;
-				c2 |= c2 << 1;
-			} else if (dpl == 2) {
-				c1 &= 2;
-				c1 |= c1 >> 1;
-				c2 &= 2;
-				c2 |= c2 >> 1;
-			}
-			if (dbl == 1) {
-				c1 = (c1 + c2 + 1) / 2;
-				c1 = (c1 << 6) | (c1 << 4) | (c1 << 2) | (c1 << 0);
-				PRGB(dst, dstp1, c1, c1, c1);
-			} else {
-				c1 = (c1 << 6) | (c1 << 4) | (c1 << 2) | (c1 << 0);
-				c2 = (c2 << 6) | (c2 << 4) | (c2 << 2) | (c2 << 0);
-				PRGB(dst, dstp1, c1, c1, c1);
-				PRGB(dst, dstp2, c2, c2, c2);
-				dstp2 += dst->pixbytes;
-			}
-			srcp += src->pixbytes;
-			if (!hires)
-				srcp += src->pixbytes;
-			dstp1 += dst->pixbytes;
-		}
-#endif
-		srcbuf += src->rowbytes * dbl;
-		dstbuf += dst->rowbytes * dbl;
-	}
+	c.src = src;
+	c.dst = dst;
+	c.srcbuf = srcbuf;
+	c.dstbuf = dstbuf;
+	c.dbl = dbl;
+	c.panel_width_draw = panel_width_draw;
+	c.hires = hires;
+	c.dpl = dpl;
+	rowworkers_run((panel_height / (dbl == 1 ? 1 : 2)) / gfxvidinfo.ychange, SM_MINROWS, a2024_rows_func, &c);
 
 	total_width /= 2;
 	total_width <<= currprefs.gfx_resolution;
@@ -2172,7 +2351,8 @@ bool specialmonitor_need_genlock(void)
 static uae_u8 *genlock_image;
 static int genlock_image_width, genlock_image_height, genlock_image_pitch;
 static uae_u8 noise_buffer[1024];
-static uae_u32 noise_seed, noise_add, noise_index;
+static uae_u32 noise_seed;
+static uae_u16 genlock_noise[MAXVPOS_PAL + 1][2];
 
 static uae_u32 quickrand(void)
 {
@@ -2188,11 +2368,11 @@ static void init_noise(void)
 	}
 }
 
-static uae_u8 get_noise(void)
+STATIC_INLINE uae_u8 get_noise(uae_u32 *noise_index, uae_u32 noise_add)
 {
-	noise_index += noise_add;
-	noise_index &= 1023;
-	return noise_buffer[noise_index];
+	*noise_index += noise_add;
+	*noise_index &= 1023;
+	return noise_buffer[*noise_index];
 }
 
 #include "png.h"
@@ -2305,9 +2485,85 @@ end:
 	xfree(bfree);
 }
 
+struct genlock_rows
+{
+	struct vidbuffer *src, *dst;
+	bool doublelines;
+	int oddlines;
+	int ystart, vdbl;
+	int gl_vdbl_l, gl_vdbl_r;
+	int gl_hdbl_l, gl_hdbl_r;
+	int gl_hcenter, gl_vcenter;
+	int mix1, mix2;
+};
+
+static void genlock_rows_func(void *v, int first, int last)
+{
+	struct genlock_rows *c = (struct genlock_rows*)v;
+	struct vidbuffer *src = c->src, *dst = c->dst;
+	bool doublelines = c->doublelines;
+	int oddlines = c->oddlines, vdbl = c->vdbl;
+	int gl_vdbl_l = c->gl_vdbl_l, gl_vdbl_r = c->gl_vdbl_r;
+	int gl_hdbl_l = c->gl_hdbl_l, gl_hdbl_r = c->gl_hdbl_r;
+	int gl_hcenter = c->gl_hcenter, gl_vcenter = c->gl_vcenter;
+	int mix1 = c->mix1, mix2 = c->mix2;
+	int ystart = c->ystart + first, yend = c->ystart + last;
+	int x;
+
+	uae_u8 r = 0, g = 0, b = 0;
+	for (int y = ystart; y < yend; y++) {
+		int yoff = (((y * 2 + oddlines) - src->yoffset) >> vdbl);
+		if (yoff < 0)
+			continue;
+		if (yoff >= src->inheight)
+			continue;
+
+		uae_u8 *line = src->bufmem + yoff * src->rowbytes;
+		uae_u8 *dstline = dst->bufmem + (((y * 2 + oddlines) - dst->yoffset) >> vdbl) * dst->rowbytes;
+		uae_u8 *line_genlock = row_map_genlock[yoff];
+		int gy = ((((y * 2 + oddlines) - dst->yoffset) << gl_vdbl_l) >> gl_vdbl_r) + gl_vcenter;
+		uae_u8 *image_genlock = genlock_image + gy * genlock_image_pitch;
+		uae_u32 noise_index = genlock_noise[y - c->ystart][0];
+		uae_u32 noise_add = genlock_noise[y - c->ystart][1];
+		r = g = b = 0;
+		for (x = 0; x < src->inwidth; x++) {
+			uae_u8 *s = line + x * src->pixbytes;
+			uae_u8 *d = dstline + x * dst->pixbytes;
+			uae_u8 *s_genlock = line_genlock + x;
+			uae_u8 *s2 = s + src->rowbytes;
+			uae_u8 *d2 = d + dst->rowbytes;
+
+			if (is_transparent(*s_genlock)) {
+				if (genlock_image) {
+					int gx = (((x + gl_hcenter) << gl_hdbl_l) >> gl_hdbl_r);
+					if (gx >= 0 && gx < genlock_image_width && gy >= 0 && gy < genlock_image_height) {
+						uae_u8 *s_genlock_image = image_genlock + gx * 4;
+						r = s_genlock_image[0];
+						g = s_genlock_image[1];
+						b = s_genlock_image[2];
+					} else {
+						r = g = b = 0;
+					}
+				} else {
+					r = g = b = get_noise(&noise_index, noise_add);
+				}
+				if (mix2) {
+					r = (mix1 * r + mix2 * FVR(src, s)) / 256;
+					g = (mix1 * g + mix2 * FVG(src, s)) / 256;
+					b = (mix1 * b + mix2 * FVB(src, s)) / 256;
+				}
+				PUT_PRGB(d, d2, dst, r, g, b, 0, doublelines, false);
+			} else {
+				PUT_AMIGARGB(d, s, d2, s2, dst, 0, doublelines, false);
+			}
+		}
+	}
+}
+
 static bool do_genlock(struct vidbuffer *src, struct vidbuffer *dst, bool doublelines, int oddlines)
 {
-	int y, x, vdbl, hdbl;
+	struct genlock_rows c;
+	int vdbl, hdbl;
 	int ystart, yend, isntsc;
 	int gl_vdbl_l, gl_vdbl_r;
 	int gl_hdbl_l, gl_hdbl_r, gl_hdbl;
@@ -2368,53 +2624,28 @@ static bool do_genlock(struct vidbuffer *src, struct vidbuffer *dst, bool double
 		mix2 = currprefs.genlock_mix;
 	}
 
-	uae_u8 r = 0, g = 0, b = 0;
-	for (y = ystart; y < yend; y++) {
-		int yoff = (((y * 2 + oddlines) - src->yoffset) >> vdbl);
-		if (yoff < 0)
-			continue;
-		if (yoff >= src->inheight)
-			continue;
-
-		uae_u8 *line = src->bufmem + yoff * src->rowbytes;
-		uae_u8 *dstline = dst->bufmem + (((y * 2 + oddlines) - dst->yoffset) >> vdbl) * dst->rowbytes;
-		uae_u8 *line_genlock = row_map_genlock[yoff];
-		int gy = ((((y * 2 + oddlines) - dst->yoffset) << gl_vdbl_l) >> gl_vdbl_r) + gl_vcenter;
-		uae_u8 *image_genlock = genlock_image + gy * genlock_image_pitch;
-		r = g = b = 0;
-		noise_add = (quickrand() & 15) | 1;
-		for (x = 0; x < src->inwidth; x++) {
-			uae_u8 *s = line + x * src->pixbytes;
-			uae_u8 *d = dstline + x * dst->pixbytes;
-			uae_u8 *s_genlock = line_genlock + x;
-			uae_u8 *s2 = s + src->rowbytes;
-			uae_u8 *d2 = d + dst->rowbytes;
-
-			if (is_transparent(*s_genlock)) {
-				if (genlock_image) {
-					int gx = (((x + gl_hcenter) << gl_hdbl_l) >> gl_hdbl_r);
-					if (gx >= 0 && gx < genlock_image_width && gy >= 0 && gy < genlock_image_height) {
-						uae_u8 *s_genlock_image = image_genlock + gx * 4;
-						r = s_genlock_image[0];
-						g = s_genlock_image[1];
-						b = s_genlock_image[2];
-					} else {
-						r = g = b = 0;
-					}
-				} else {
-					r = g = b = get_noise();
-				}
-				if (mix2) {
-					r = (mix1 * r + mix2 * FVR(src, s)) / 256;
-					g = (mix1 * g + mix2 * FVG(src, s)) / 256;
-					b = (mix1 * b + mix2 * FVB(src, s)) / 256;
-				}
-				PUT_PRGB(d, d2, dst, r, g, b, 0, doublelines, false);
-			} else {
-				PUT_AMIGARGB(d, s, d2, s2, dst, 0, doublelines, false);
-			}
-		}
-	}
+	// lines are rendered in parallel, each one gets its own noise sequence
+	for (int y = ystart; y < yend; y++) {
+		genlock_noise[y - ystart][0] = quickrand() & 1023;
+		genlock_noise[y - ystart][1] = (quickrand() & 15) | 1;
+	}
+
+	c.src = src;
+	c.dst = dst;
+	// see sm_rows_init()
+	c.doublelines = doublelines && !vdbl;
+	c.oddlines = oddlines;
+	c.ystart = ystart;
+	c.vdbl = vdbl;
+	c.gl_vdbl_l = gl_vdbl_l;
+	c.gl_vdbl_r = gl_vdbl_r;
+	c.gl_hdbl_l = gl_hdbl_l;
+	c.gl_hdbl_r = gl_hdbl_r;
+	c.gl_hcenter = gl_hcenter;
+	c.gl_vcenter = gl_vcenter;
+	c.mix1 = mix1;
+	c.mix2 = mix2;
+	rowworkers_run(yend - ystart, SM_MINROWS, genlock_rows_func, &c);
 
 	dst->nativepositioning = true;
 	return true;
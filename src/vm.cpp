@@ -15,6 +15,9 @@
 
 #else
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 #ifdef HAVE_SYS_PARAM_H
 #include <sys/param.h>
@@ -460,3 +463,101 @@ bool uae_vm_decommit(void *address, uae_u32 size)
     return result != MAP_FAILED;
 #endif
 }
+
+#ifndef _WIN32
+
+static bool file_has_contents(int fd, void *data, uae_u32 size)
+{
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size != (off_t) size) {
+		return false;
+	}
+	void *file_data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (file_data == MAP_FAILED) {
+		return false;
+	}
+	bool result = memcmp(file_data, data, size) == 0;
+	munmap(file_data, size);
+	return result;
+}
+
+static bool write_shared_file(const TCHAR *path, void *data, uae_u32 size)
+{
+	/* Write to a temporary file and rename it into place, so other
+	 * processes never see a partial file, and existing mappings of an
+	 * older file with the same name are left untouched. */
+	TCHAR temp_path[MAX_DPATH];
+	_sntprintf(temp_path, MAX_DPATH, _T("%s.%d.tmp"), path, (int) getpid());
+	int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		uae_log("VM: Could not create %s (%d)\n", temp_path, errno);
+		return false;
+	}
+	uae_u8 *p = (uae_u8 *) data;
+	uae_u32 left = size;
+	while (left > 0) {
+		ssize_t written = write(fd, p, left);
+		if (written <= 0) {
+			uae_log("VM: Error writing %s (%d)\n", temp_path, errno);
+			close(fd);
+			unlink(temp_path);
+			return false;
+		}
+		p += written;
+		left -= written;
+	}
+	close(fd);
+	if (rename(temp_path, path) != 0) {
+		uae_log("VM: Could not rename %s (%d)\n", temp_path, errno);
+		unlink(temp_path);
+		return false;
+	}
+	return true;
+}
+
+#endif
+
+bool uae_vm_share_pages(void *address, uae_u32 size, const TCHAR *path)
+{
+#ifdef _WIN32
+	return false;
+#else
+	if ((uintptr_t) address % uae_vm_page_size() != 0 ||
+			size % uae_vm_page_size() != 0) {
+		uae_log("VM: Cannot share %p (0x%x bytes), not page aligned\n",
+				address, size);
+		return false;
+	}
+	int fd = open(path, O_RDONLY);
+	if (fd != -1 && !file_has_contents(fd, address, size)) {
+		close(fd);
+		fd = -1;
+	}
+	if (fd == -1) {
+		if (!write_shared_file(path, address, size)) {
+			return false;
+		}
+		fd = open(path, O_RDONLY);
+		if (fd == -1) {
+			return false;
+		}
+		if (!file_has_contents(fd, address, size)) {
+			/* Should not happen unless someone else wrote a different
+			 * file with the same name concurrently. */
+			close(fd);
+			return false;
+		}
+	}
+	/* A private mapping does not need write access to the file; writes to
+	 * the memory only create private copies of the affected pages. */
+	void *result = mmap(address, size, PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_FIXED, fd, 0);
+	close(fd);
+	if (result == MAP_FAILED) {
+		uae_log("VM: Could not map %s at %p (%d)\n", path, address, errno);
+		return false;
+	}
+	uae_log("VM: Share    0x%-8x bytes at %p with %s\n", size, address, path);
+	return true;
+#endif
+}
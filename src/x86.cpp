@@ -39,6 +39,7 @@
 #include "idecontrollers.h"
 #include "fake86_cpu.h"
 #include "gfxboard.h"
+#include "threaddep/thread.h"
 
 #include "dosbox/dosbox.h"
 #include "dosbox/mem.h"
@@ -73,6 +74,26 @@ static int x86_instruction_count;
 static bool x86_turbo_allowed;
 static bool x86_turbo_enabled;
 bool x86_turbo_on;
+
+/* Optional x86 CPU thread. The emulation thread hands the x86 thread
+ * cpu_x86_thread scanlines worth of work at a time and waits for the
+ * previous batch to complete first, so the PC side lags at most one
+ * quantum behind. The x86 thread only executes x86 instructions, floppy
+ * delays, the DOSBox timer and the x86 IDE interrupts stay on the
+ * emulation thread. Bridge state is protected by x86_thread_lock, the
+ * x86 thread holds it while executing a scanline, the emulation thread
+ * when accessing the shared memory window, bridge I/O registers, floppy
+ * drives or x86 IDE (x86_bridge_sync_lock). */
+static volatile int x86_thread_running;
+static volatile bool x86_thread_rethink;
+static uae_sem_t x86_thread_lock;
+static uae_sem_t x86_thread_go;
+static uae_sem_t x86_thread_done;
+static int x86_thread_lines;
+static int x86_thread_pending;
+static bool x86_thread_idle;
+static int x86_lock_depth;
+static void x86_thread_stop(void);
 bool x86_cpu_active;
 
 void CPU_JMP(bool use32, Bitu selector, Bitu offset, Bitu oldeip);
@@ -2758,12 +2779,37 @@ static uaecptr get_x86_address(struct x86_bridge *xb, uaecptr addr, int *mode)
 	return addr;
 }
 
+static void x86_bridge_lock(void)
+{
+	if (x86_lock_depth++ == 0 && x86_thread_running > 0)
+		uae_sem_wait(&x86_thread_lock);
+}
+
+static void x86_bridge_unlock(void)
+{
+	if (--x86_lock_depth == 0 && x86_thread_running > 0)
+		uae_sem_post(&x86_thread_lock);
+}
+
+// Called by other emulation thread code changing state the x86 CPU uses
+void x86_bridge_sync_lock(void)
+{
+	if (uae_is_emulation_thread())
+		x86_bridge_lock();
+}
+
+void x86_bridge_sync_unlock(void)
+{
+	if (uae_is_emulation_thread())
+		x86_bridge_unlock();
+}
+
 static struct x86_bridge *get_x86_bridge(uaecptr addr)
 {
 	return bridges[0];
 }
 
-static uae_u32 REGPARAM2 x86_bridge_wget(uaecptr addr)
+static uae_u32 x86_bridge_wget_2(uaecptr addr)
 {
 	uae_u16 v = 0;
 	struct x86_bridge *xb = get_x86_bridge(addr);
@@ -2786,6 +2832,13 @@ static uae_u32 REGPARAM2 x86_bridge_wget(uaecptr addr)
 #endif
 	return v;
 }
+static uae_u32 REGPARAM2 x86_bridge_wget(uaecptr addr)
+{
+	x86_bridge_lock();
+	uae_u32 v = x86_bridge_wget_2(addr);
+	x86_bridge_unlock();
+	return v;
+}
 static uae_u32 REGPARAM2 x86_bridge_lget(uaecptr addr)
 {
 	uae_u32 v;
@@ -2793,7 +2846,7 @@ static uae_u32 REGPARAM2 x86_bridge_lget(uaecptr addr)
 	v |= x86_bridge_wget(addr + 2);
 	return v;
 }
-static uae_u32 REGPARAM2 x86_bridge_bget(uaecptr addr)
+static uae_u32 x86_bridge_bget_2(uaecptr addr)
 {
 	uae_u8 v = 0;
 	struct x86_bridge *xb = get_x86_bridge(addr);
@@ -2820,7 +2873,15 @@ static uae_u32 REGPARAM2 x86_bridge_bget(uaecptr addr)
 	return v;
 }
 
-static void REGPARAM2 x86_bridge_wput(uaecptr addr, uae_u32 b)
+static uae_u32 REGPARAM2 x86_bridge_bget(uaecptr addr)
+{
+	x86_bridge_lock();
+	uae_u32 v = x86_bridge_bget_2(addr);
+	x86_bridge_unlock();
+	return v;
+}
+
+static void x86_bridge_wput_2(uaecptr addr, uae_u32 b)
 {
 	struct x86_bridge *xb = get_x86_bridge(addr);
 	if (!xb)
@@ -2851,12 +2912,18 @@ static void REGPARAM2 x86_bridge_wput(uaecptr addr, uae_u32 b)
 		xb->pc_ram[a + 0] = b >> 8;
 	}
 }
+static void REGPARAM2 x86_bridge_wput(uaecptr addr, uae_u32 b)
+{
+	x86_bridge_lock();
+	x86_bridge_wput_2(addr, b);
+	x86_bridge_unlock();
+}
 static void REGPARAM2 x86_bridge_lput(uaecptr addr, uae_u32 b)
 {
 	x86_bridge_wput(addr, b >> 16);
 	x86_bridge_wput(addr + 2, b);
 }
-static void REGPARAM2 x86_bridge_bput(uaecptr addr, uae_u32 b)
+static void x86_bridge_bput_2(uaecptr addr, uae_u32 b)
 {
 	struct x86_bridge *xb = get_x86_bridge(addr);
 	if (!xb)
@@ -2899,6 +2966,13 @@ static void REGPARAM2 x86_bridge_bput(uaecptr addr, uae_u32 b)
 	}
 }
 
+static void REGPARAM2 x86_bridge_bput(uaecptr addr, uae_u32 b)
+{
+	x86_bridge_lock();
+	x86_bridge_bput_2(addr, b);
+	x86_bridge_unlock();
+}
+
 addrbank x86_bridge_bank = {
 	x86_bridge_lget, x86_bridge_wget, x86_bridge_bget,
 	x86_bridge_lput, x86_bridge_wput, x86_bridge_bput,
@@ -2912,6 +2986,12 @@ void x86_bridge_rethink(void)
 	struct x86_bridge *xb = bridges[0];
 	if (!xb)
 		return;
+	if (x86_thread_running > 0 && !uae_is_emulation_thread()) {
+		// Amiga interrupts can only be raised by the emulation thread
+		x86_thread_rethink = true;
+		return;
+	}
+	x86_bridge_lock();
 	if (!(xb->amiga_io[IO_CONTROL_REGISTER] & 1)) {
 		xb->amiga_io[IO_AMIGA_INTERRUPT_STATUS] |= xb->delayed_interrupt;
 		xb->delayed_interrupt = 0;
@@ -2921,6 +3001,7 @@ void x86_bridge_rethink(void)
 		if (status)
 			INTREQ_0(0x8000 | 0x0008);
 	}
+	x86_bridge_unlock();
 }
 
 void x86_bridge_free(void)
@@ -2931,6 +3012,7 @@ void x86_bridge_free(void)
 
 void x86_bridge_reset(void)
 {
+	x86_thread_stop();
 	x86_xrom_start[0] = x86_xrom_end[0] = 0;
 	x86_xrom_start[1] = x86_xrom_end[1] = 0;
 	for (int i = 0; i < X86_BRIDGE_MAX; i++) {
@@ -3007,7 +3089,8 @@ static void x86_cpu_execute(int cnt)
 	}
 
 	// BIOS has CPU loop delays in floppy driver...
-	check_floppy_delay();
+	if (x86_thread_running <= 0)
+		check_floppy_delay();
 }
 
 void x86_bridge_execute_until(int until)
@@ -3017,6 +3100,8 @@ void x86_bridge_execute_until(int until)
 		return;
 	if (!x86_turbo_allowed)
 		return;
+	if (x86_thread_running > 0)
+		return;
 	for (;;) {
 		x86_cpu_execute(until ? 10 : 1);
 		if (until == 0)
@@ -3033,9 +3118,11 @@ void x86_bridge_sync_change(void)
 	if (!xb)
 		return;
 
+	x86_bridge_lock();
 	xb->dosbox_vpos_tick = maxvpos * vblank_hz / 1000;
 	if (xb->dosbox_vpos_tick >= xb->dosbox_vpos_tick)
 		xb->dosbox_tick_vpos_cnt -= xb->dosbox_vpos_tick;
+	x86_bridge_unlock();
 }
 
 void x86_bridge_vsync(void)
@@ -3049,21 +3136,24 @@ void x86_bridge_vsync(void)
 	}
 }
 
-void x86_bridge_hsync(void)
+// Per scanline floppy and timer work, always on the emulation thread
+static void x86_bridge_line_timers(struct x86_bridge *xb)
 {
-	struct x86_bridge *xb = bridges[0];
-	if (!xb)
-		return;
-
 	check_floppy_delay();
 
+	if (!xb->x86_reset && xb->dosbox_cpu) {
+		xb->dosbox_tick_vpos_cnt++;
+		if (xb->dosbox_tick_vpos_cnt >= xb->dosbox_vpos_tick) {
+			TIMER_AddTick();
+			xb->dosbox_tick_vpos_cnt -= xb->dosbox_vpos_tick;
+		}
+	}
+}
+
+static void x86_bridge_line(struct x86_bridge *xb)
+{
 	if (!xb->x86_reset) {
 		if (xb->dosbox_cpu) {
-			xb->dosbox_tick_vpos_cnt++;
-			if (xb->dosbox_tick_vpos_cnt >= xb->dosbox_vpos_tick) {
-				TIMER_AddTick();
-				xb->dosbox_tick_vpos_cnt -= xb->dosbox_vpos_tick;
-			}
 			x86_cpu_execute(x86_instruction_count);
 		} else {
 			for (int i = 0; i < 3; i++) {
@@ -3072,6 +3162,99 @@ void x86_bridge_hsync(void)
 			}
 		}
 	}
+}
+
+static void *x86_cpu_thread(void *v)
+{
+	x86_thread_running = 1;
+	uae_sem_post(&x86_thread_done);
+	for (;;) {
+		uae_sem_wait(&x86_thread_go);
+		if (x86_thread_running < 0)
+			break;
+		for (int i = 0; i < x86_thread_lines; i++) {
+			uae_sem_wait(&x86_thread_lock);
+			x86_bridge_line(bridges[0]);
+			uae_sem_post(&x86_thread_lock);
+		}
+		uae_sem_post(&x86_thread_done);
+	}
+	x86_thread_running = 0;
+	uae_sem_post(&x86_thread_done);
+	return NULL;
+}
+
+// Waits until the x86 thread has finished the previous quantum
+static void x86_thread_wait(void)
+{
+	if (x86_thread_idle)
+		return;
+	// bridge I/O register access can wait for scanlines (IO_NEGATE_PC_RESET)
+	if (x86_lock_depth)
+		uae_sem_post(&x86_thread_lock);
+	uae_sem_wait(&x86_thread_done);
+	if (x86_lock_depth)
+		uae_sem_wait(&x86_thread_lock);
+	x86_thread_idle = true;
+}
+
+static void x86_thread_start(void)
+{
+	uae_sem_init(&x86_thread_lock, 0, 1);
+	uae_sem_init(&x86_thread_go, 0, 0);
+	uae_sem_init(&x86_thread_done, 0, 0);
+	x86_thread_pending = 0;
+	x86_thread_rethink = false;
+	uae_start_thread(_T("x86"), x86_cpu_thread, NULL, NULL);
+	uae_sem_wait(&x86_thread_done);
+	x86_thread_idle = true;
+	write_log(_T("x86 CPU thread started, quantum %d lines\n"), currprefs.x86_thread_quantum);
+}
+
+static void x86_thread_stop(void)
+{
+	if (x86_thread_running <= 0)
+		return;
+	x86_thread_wait();
+	x86_thread_running = -1;
+	uae_sem_post(&x86_thread_go);
+	uae_sem_wait(&x86_thread_done);
+	uae_sem_destroy(&x86_thread_lock);
+	uae_sem_destroy(&x86_thread_go);
+	uae_sem_destroy(&x86_thread_done);
+	x86_thread_rethink = false;
+	write_log(_T("x86 CPU thread stopped\n"));
+}
+
+void x86_bridge_hsync(void)
+{
+	struct x86_bridge *xb = bridges[0];
+	if (!xb)
+		return;
+
+	if (currprefs.x86_thread_quantum > 0 && x86_thread_running <= 0 && !x86_lock_depth)
+		x86_thread_start();
+
+	if (x86_thread_running > 0) {
+		if (x86_thread_rethink) {
+			x86_thread_rethink = false;
+			x86_bridge_rethink();
+		}
+		x86_bridge_lock();
+		x86_bridge_line_timers(xb);
+		x86_bridge_unlock();
+		x86_thread_pending++;
+		if (x86_thread_pending >= currprefs.x86_thread_quantum) {
+			x86_thread_wait();
+			x86_thread_lines = x86_thread_pending;
+			x86_thread_pending = 0;
+			x86_thread_idle = false;
+			uae_sem_post(&x86_thread_go);
+		}
+	} else {
+		x86_bridge_line_timers(xb);
+		x86_bridge_line(xb);
+	}
 
 	if (currprefs.x86_speed_throttle != changed_prefs.x86_speed_throttle) {
 		currprefs.x86_speed_throttle = changed_prefs.x86_speed_throttle;
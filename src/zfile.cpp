@@ -24,6 +24,7 @@
 #include "diskutil.h"
 #include "fdi2raw.h"
 #include "uae/io.h"
+#include "threaddep/thread.h"
 
 #include "archivers/zip/unzip.h"
 #include "archivers/dms/pfile.h"
@@ -37,6 +38,23 @@
 #endif
 
 static struct zfile *zlist = 0;
+/* floppy images are opened on a background thread (disk.cpp) */
+static uae_sem_t zlist_sem;
+static bool zlist_sem_init;
+
+static void zlist_lock (void)
+{
+	if (!zlist_sem_init) {
+		uae_sem_init (&zlist_sem, 0, 1);
+		zlist_sem_init = true;
+	}
+	uae_sem_wait (&zlist_sem);
+}
+
+static void zlist_unlock (void)
+{
+	uae_sem_post (&zlist_sem);
+}
 
 const TCHAR *uae_archive_extensions[] = { _T("zip"), _T("rar"), _T("7z"), _T("lha"), _T("lzh"), _T("lzx"), _T("tar"), NULL };
 
@@ -170,8 +188,10 @@ static struct zfile *zfile_create (struct zfile *prev, const TCHAR *originalname
 	if (!z)
 		return 0;
 	memset (z, 0, sizeof *z);
+	zlist_lock ();
 	z->next = zlist;
 	zlist = z;
+	zlist_unlock ();
 	z->opencnt = 1;
 	if (prev && prev->originalname)
 		z->originalname = my_strdup(prev->originalname);
@@ -231,25 +251,23 @@ void zfile_fclose (struct zfile *f)
 		f->archiveparent = NULL;
 	}
 	struct zfile *pl = NULL;
-	struct zfile *nxt;
+	zlist_lock ();
 	struct zfile *l  = zlist;
 	while (l != f) {
 		if (l == 0) {
+			zlist_unlock ();
 			write_log (_T("zfile: tried to free already freed or nonexisting filehandle!\n"));
 			return;
 		}
 		pl = l;
 		l = l->next;
 	}
-	if (l)
-		nxt = l->next;
-	zfile_free (f);
-	if (l == 0)
-		return;
 	if(!pl)
-		zlist = nxt;
+		zlist = l->next;
 	else
-		pl->next = nxt;
+		pl->next = l->next;
+	zlist_unlock ();
+	zfile_free (f);
 }
 
 static void removeext (TCHAR *s, const TCHAR *ext)